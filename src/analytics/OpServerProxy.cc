@@ -11,6 +11,7 @@
 #include "base/util.h"
 #include "base/logging.h"
 #include "base/parse_object.h"
+#include "base/timer.h"
 #include <cstdlib>
 #include <utility>
 #include "hiredis/hiredis.h"
@@ -24,6 +25,7 @@
 
 #include "redis_connection.h"
 #include "redis_processor_vizd.h"
+#include "uve_update_coalescer.h"
 #include "viz_sandesh.h"
 #include "viz_collector.h"
 
@@ -113,6 +115,8 @@ class OpServerProxy::OpServerImpl {
         void FillRedisUVEInfo(RedisUveInfo& redis_uve_info) {
             tbb::mutex::scoped_lock lock(rac_mutex_); 
             redis_uve_info = redis_uve_.rinfo_;
+            redis_uve_info.set_update_coalesced(uve_coalescer_.coalesced());
+            redis_uve_info.set_update_flushed(uve_coalescer_.flushed());
             if (to_ops_conn_) {
                 redis_uve_info.set_conn_call_disconnected(to_ops_conn_->CallDisconnected());
                 redis_uve_info.set_conn_call_failed(to_ops_conn_->CallFailed());
@@ -276,6 +280,111 @@ class OpServerProxy::OpServerImpl {
             collector_->SendRemote(destination, dec_sandesh);
         }
 
+        static const int kUVEUpdateFlushIntervalMsec = 100;
+
+        bool UVEUpdateSend(const UVEUpdateCoalescer::Key &ukey,
+                           const UVEUpdateCoalescer::Value &uvalue) {
+            shared_ptr<RedisAsyncConnection> prac = to_ops_conn();
+            if (!prac) {
+                redis_uve_.RedisUveUpdateNoConn();
+                return false;
+            }
+            bool ret = RedisProcessorExec::UVEUpdate(prac.get(), NULL,
+                ukey.type, ukey.attr, ukey.source, ukey.node_type,
+                ukey.module, ukey.instance_id, ukey.key, uvalue.message,
+                uvalue.seq, uvalue.agg, uvalue.atyp, uvalue.ts);
+            ret ? redis_uve_.RedisUveUpdate() :
+                  redis_uve_.RedisUveUpdateFail();
+            return ret;
+        }
+
+        bool UVEUpdate(const UVEUpdateCoalescer::Key &ukey,
+                       const UVEUpdateCoalescer::Value &uvalue) {
+            if (uve_coalesce_interval_msec_ == 0 ||
+                !UVEUpdateCoalescer::IsCoalescable(uvalue)) {
+                return UVEUpdateSend(ukey, uvalue);
+            }
+            shared_ptr<RedisAsyncConnection> prac = to_ops_conn();
+            if (!(prac && prac->IsConnUp())) {
+                redis_uve_.RedisUveUpdateNoConn();
+                return false;
+            }
+            uve_coalescer_.Update(ukey, uvalue);
+            return true;
+        }
+
+        bool UVEDeleteSend(const std::string &type, const std::string &source,
+                           const std::string &node_type,
+                           const std::string &module,
+                           const std::string &instance_id,
+                           const std::string &key, int32_t seq) {
+            shared_ptr<RedisAsyncConnection> prac = to_ops_conn();
+            if (!prac) {
+                redis_uve_.RedisUveDeleteNoConn();
+                return false;
+            }
+            bool ret = RedisProcessorExec::UVEDelete(prac.get(), NULL, type,
+                source, node_type, module, instance_id, key, seq);
+            ret ? redis_uve_.RedisUveDelete() :
+                  redis_uve_.RedisUveDeleteFail();
+            return ret;
+        }
+
+        bool UVEDelete(const std::string &type, const std::string &source,
+                       const std::string &node_type,
+                       const std::string &module,
+                       const std::string &instance_id,
+                       const std::string &key, int32_t seq) {
+            return uve_coalescer_.Delete(source, node_type, module,
+                instance_id, key, type,
+                boost::bind(&OpServerImpl::UVEDeleteSend, this, type, source,
+                            node_type, module, instance_id, key, seq));
+        }
+
+        bool DeleteUVEsSend(const std::string &source,
+                            const std::string &node_type,
+                            const std::string &module,
+                            const std::string &instance_id) {
+            shared_ptr<RedisAsyncConnection> prac = to_ops_conn();
+            if  (!(prac && prac->IsConnUp())) return false;
+
+            return RedisProcessorExec::SyncDeleteUVEs(redis_uve_.GetIp(),
+                    redis_uve_.GetPort(), source, node_type,
+                    module, instance_id);
+        }
+
+        bool DeleteUVEs(const std::string &source,
+                        const std::string &node_type,
+                        const std::string &module,
+                        const std::string &instance_id) {
+            return uve_coalescer_.Delete(source, node_type, module,
+                instance_id, "", "",
+                boost::bind(&OpServerImpl::DeleteUVEsSend, this, source,
+                            node_type, module, instance_id));
+        }
+
+        bool UVEUpdateFlushTimerExpired() {
+            uve_coalescer_.Flush();
+            return true;
+        }
+
+        void UVEUpdateFlushTimerErrorHandler(string name, string error) {
+            LOG(ERROR, name + " error: " + error);
+        }
+
+        void set_uve_coalesce_interval_msec(int msec) {
+            uve_flush_timer_->Cancel();
+            uve_coalesce_interval_msec_ = msec;
+            uve_coalescer_.Flush();
+            if (msec > 0) {
+                uve_flush_timer_->Start(msec,
+                    boost::bind(&OpServerImpl::UVEUpdateFlushTimerExpired,
+                                this),
+                    boost::bind(&OpServerImpl::UVEUpdateFlushTimerErrorHandler,
+                                this, _1, _2));
+            }
+        }
+
         shared_ptr<RedisAsyncConnection> to_ops_conn() {
             tbb::mutex::scoped_lock lock(rac_mutex_);
             return to_ops_conn_;
@@ -294,7 +403,12 @@ class OpServerProxy::OpServerImpl {
             collector_(collector),
             started_(false),
             analytics_cb_proc_fn(NULL),
-            processor_cb_proc_fn(NULL) {
+            processor_cb_proc_fn(NULL),
+            uve_coalescer_(boost::bind(&OpServerImpl::UVEUpdateSend, this,
+                                       _1, _2)),
+            uve_flush_timer_(TimerManager::CreateTimer(*evm->io_service(),
+                "OpServerProxy UVE update flush timer")) {
+            uve_coalesce_interval_msec_ = 0;
             to_ops_conn_.reset(new RedisAsyncConnection(evm_, 
                 redis_uve_ip, redis_uve_port, 
                 boost::bind(&OpServerProxy::OpServerImpl::ToOpsConnUp, this),
@@ -305,9 +419,12 @@ class OpServerProxy::OpServerImpl {
                 boost::bind(&OpServerProxy::OpServerImpl::FromOpsConnUp, this),
                 boost::bind(&OpServerProxy::OpServerImpl::FromOpsConnDown, this)));
             from_ops_conn_.get()->RAC_Connect();
+            set_uve_coalesce_interval_msec(kUVEUpdateFlushIntervalMsec);
         }
 
         ~OpServerImpl() {
+            TimerManager::DeleteTimer(uve_flush_timer_);
+            uve_flush_timer_ = NULL;
         }
 
         RedisInfo redis_uve_;
@@ -321,6 +438,10 @@ class OpServerProxy::OpServerImpl {
         RedisAsyncConnection::ClientAsyncCmdCbFn analytics_cb_proc_fn;
         RedisAsyncConnection::ClientAsyncCmdCbFn processor_cb_proc_fn;
         tbb::mutex rac_mutex_;
+        // UVE updates held for uve_coalesce_interval_msec_
+        UVEUpdateCoalescer uve_coalescer_;
+        tbb::atomic<int> uve_coalesce_interval_msec_;
+        Timer *uve_flush_timer_;
 };
 
 OpServerProxy::OpServerProxy(EventManager *evm, VizCollector *collector,
@@ -343,16 +464,10 @@ OpServerProxy::UVEUpdate(const std::string &type, const std::string &attr,
                        int32_t seq, const std::string& agg, 
                        const std::string& atyp, int64_t ts) {
 
-    shared_ptr<RedisAsyncConnection> prac = impl_->to_ops_conn();
-    if (!prac) {
-        impl_->redis_uve_.RedisUveUpdateNoConn();
-        return false;
-    }
-
-    bool ret = RedisProcessorExec::UVEUpdate(prac.get(), NULL, type, attr,
-            source, node_type, module, instance_id, key, message, seq, agg, atyp, ts);
-    ret ? impl_->redis_uve_.RedisUveUpdate() : impl_->redis_uve_.RedisUveUpdateFail(); 
-    return ret;
+    return impl_->UVEUpdate(
+        UVEUpdateCoalescer::Key(source, node_type, module, instance_id,
+                                key, type, attr),
+        UVEUpdateCoalescer::Value(message, seq, agg, atyp, ts));
 }
 
 bool
@@ -362,16 +477,8 @@ OpServerProxy::UVEDelete(const std::string &type,
                        const std::string &instance_id,
                        const std::string &key, int32_t seq) {
 
-    shared_ptr<RedisAsyncConnection> prac = impl_->to_ops_conn();
-    if (!prac) {
-        impl_->redis_uve_.RedisUveDeleteNoConn();
-        return false;
-    }
-
-    bool ret = RedisProcessorExec::UVEDelete(prac.get(), NULL, type, source, 
-            node_type, module, instance_id, key, seq);
-    ret ? impl_->redis_uve_.RedisUveDelete() : impl_->redis_uve_.RedisUveDeleteFail(); 
-    return ret;
+    return impl_->UVEDelete(type, source, node_type, module, instance_id,
+                            key, seq);
 }
 
 bool 
@@ -393,12 +500,12 @@ bool
 OpServerProxy::DeleteUVEs(const string &source, const string &module,
                           const string &node_type, const string &instance_id) {
 
-    shared_ptr<RedisAsyncConnection> prac = impl_->to_ops_conn();
-    if  (!(prac && prac->IsConnUp())) return false;
+    return impl_->DeleteUVEs(source, node_type, module, instance_id);
+}
 
-    return RedisProcessorExec::SyncDeleteUVEs(impl_->redis_uve_.GetIp(), 
-            impl_->redis_uve_.GetPort(), source, node_type, 
-            module, instance_id);
+void
+OpServerProxy::SetUVECoalesceInterval(int msec) {
+    impl_->set_uve_coalesce_interval_msec(msec);
 }
 
 void 
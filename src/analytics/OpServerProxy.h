@@ -52,6 +52,11 @@ public:
                             const std::string &module, 
                             const std::string &instance_id);
     
+    // Non-"stats" UVE attribute updates are coalesced per
+    // (generator, key, type, attr) and flushed to redis every msec
+    // milliseconds. A value of 0 sends every update immediately.
+    void SetUVECoalesceInterval(int msec);
+
     void FillRedisUVEInfo(RedisUveInfo& redis_uve_info);
 private:
     class OpServerImpl;
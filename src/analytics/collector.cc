@@ -533,11 +533,10 @@ public:
             return true;
         }
         // Socket statistics
-        TcpServerSocketStats rx_socket_stats;
-        vsc->Analytics()->GetCollector()->GetRxSocketStats(rx_socket_stats);
+        TcpServerSocketStats rx_socket_stats, tx_socket_stats;
+        vsc->Analytics()->GetCollector()->GetRxTxSocketStats(rx_socket_stats,
+                                                             tx_socket_stats);
         resp->set_rx_socket_stats(rx_socket_stats);
-        TcpServerSocketStats tx_socket_stats;
-        vsc->Analytics()->GetCollector()->GetTxSocketStats(tx_socket_stats);
         resp->set_tx_socket_stats(tx_socket_stats);
         // Collector statistics
         resp->set_stats(vsc->Analytics()->GetCollector()->GetStats());
@@ -119,11 +119,9 @@ bool CollectorSummaryLogger(Collector *collector, const string & hostname,
     state.set_generator_infos(infos);
 
     // Get socket stats
-    TcpServerSocketStats rx_stats;
-    collector->GetRxSocketStats(rx_stats);
+    TcpServerSocketStats rx_stats, tx_stats;
+    collector->GetRxTxSocketStats(rx_stats, tx_stats);
     state.set_rx_socket_stats(rx_stats);
-    TcpServerSocketStats tx_stats;
-    collector->GetTxSocketStats(tx_stats);
     state.set_tx_socket_stats(tx_stats);
 
     CollectorInfo::Send(state);
@@ -263,6 +261,8 @@ int main(int argc, char *argv[])
             options.syslog_port(),
             options.dup(),
             options.analytics_data_ttl());
+    analytics.GetOsp()->SetUVECoalesceInterval(
+        options.redis_uve_coalesce_interval());
 
 #if 0
     // initialize python/c++ API
@@ -116,6 +116,10 @@ void Options::Initialize(EventManager &evm,
              "Port of Redis-uve server")
         ("REDIS.server", opt::value<string>()->default_value("127.0.0.1"),
              "IP address of Redis Server")
+        ("REDIS.uve_coalesce_interval",
+             opt::value<int>()->default_value(100),
+             "Interval(msec) over which UVE attribute updates are coalesced, "
+             "0 to send every update")
         ;
 
     config_file_options_.add(config);
@@ -189,4 +193,6 @@ void Options::Process(int argc, char *argv[],
 
     GetOptValue<uint16_t>(var_map, redis_port_, "REDIS.port");
     GetOptValue<string>(var_map, redis_server_, "REDIS.server");
+    GetOptValue<int>(var_map, redis_uve_coalesce_interval_,
+                     "REDIS.uve_coalesce_interval");
 }
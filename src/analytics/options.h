@@ -23,6 +23,9 @@ public:
     const uint16_t discovery_port() const { return discovery_port_; }
     const std::string redis_server() const { return redis_server_; }
     const uint16_t redis_port() const { return redis_port_; }
+    const int redis_uve_coalesce_interval() const {
+        return redis_uve_coalesce_interval_;
+    }
     const std::string hostname() const { return hostname_; }
     const std::string host_ip() const { return host_ip_; }
     const uint16_t http_server_port() const { return http_server_port_; }
@@ -55,6 +58,7 @@ private:
     uint16_t discovery_port_;
     std::string redis_server_;
     uint16_t redis_port_;
+    int redis_uve_coalesce_interval_;
     std::string hostname_;
     std::string host_ip_;
     uint16_t http_server_port_;
@@ -11,12 +11,8 @@
 #include <boost/bind.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/asio.hpp>
-#include <boost/spirit/include/qi.hpp>
-#include <boost/spirit/include/phoenix.hpp>
-#include <boost/spirit/include/phoenix_core.hpp>
-#include <boost/spirit/include/phoenix_operator.hpp>
-#include <boost/spirit/include/phoenix_stl.hpp>
-#include <boost/spirit/home/phoenix/object/construct.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/uuid/uuid.hpp>
 #if __GNUC_PREREQ(4, 6)
 #pragma GCC diagnostic push
@@ -27,8 +23,9 @@
 #pragma GCC diagnostic pop
 #endif
 #include <boost/assign/list_of.hpp>
-#include <boost/fusion/adapted/std_pair.hpp>
 #include <boost/ptr_container/ptr_map.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <tbb/mutex.h>
 
 #include <base/util.h>
 #include <base/logging.h>
@@ -49,10 +46,7 @@
 
 using boost::asio::ip::udp;
 using namespace boost::asio;
-namespace qi = boost::spirit::qi;
-namespace ascii = boost::spirit::ascii;
 namespace bt = boost::posix_time;
-namespace phx = boost::phoenix;
 
 
 class SyslogQueueEntry;
@@ -108,49 +102,91 @@ class UDPSyslogQueueEntry : public SyslogQueueEntry
 };
 
 
+// Fields of a syslog message. String fields point into the receive buffer
+// and are only valid until the SyslogQueueEntry is freed; nothing is copied
+// while tokenising.
+struct SyslogField
+{
+    SyslogField () : ptr (NULL), len (0) { }
+    SyslogField (const char *p, size_t l) : ptr (p), len (l) { }
+    bool empty () const { return len == 0; }
+    const char *begin () const { return ptr; }
+    const char *end () const { return ptr + len; }
+    std::string str () const { return std::string (ptr, len); }
+
+    const char *ptr;
+    size_t      len;
+};
+
+struct SyslogFields
+{
+    SyslogFields () : facsev (0), year (-1), month (-1), day (-1), hour (-1), min (-1),
+        sec (-1), usec (0), utc_offset (0), rfc5424 (false), pid (-1),
+        timestamp (0), facility (0), severity (0)
+    { }
+
+    int              facsev;
+    // Timestamp as received, -1 when absent
+    int              year;
+    int              month;
+    int              day;
+    int              hour;
+    int              min;
+    int              sec;
+    int              usec;
+    int              utc_offset;
+    bool             rfc5424;
+    SyslogField      hostname;
+    SyslogField      prog;
+    int              pid;
+    SyslogField      body;
+
+    // Filled in by PostParsing
+    std::string      ip;
+    int64_t          timestamp;
+    int              facility;
+    int              severity;
+};
+
 class SyslogParser
 {
     // http://www.ietf.org/rfc/rfc3164.txt
+    // http://www.ietf.org/rfc/rfc5424.txt
     public:
-        SyslogParser (SyslogListeners *syslog):
-             work_queue_(TaskScheduler::GetInstance()->GetTaskId(
-                         "vizd::syslog"), 0, boost::bind(
-                             &SyslogParser::ClientParse, this, _1)),
+        static const int kDefaultShards = 4;
+
+        SyslogParser (SyslogListeners *syslog, int shards = kDefaultShards):
             syslog_(syslog)
         {
-            facilitynames_ = boost::assign::list_of ("auth") ("authpriv")
-                ("cron") ("daemon") ("ftp") ("kern") ("lpr") ("mail") ("mark")
-                ("news") ("security") ("syslog") ("user") ("uucp") ("local0")
-                ("local1") ("local2") ("local3") ("local4") ("local5")
-                ("local6") ("local7");
+            Init (shards);
         }
         virtual ~SyslogParser ()
         {
-            genarators_.erase (genarators_.begin (), genarators_.end ());
         }
+
+        // Messages from the same source always land on the same shard so
+        // that per-source ordering is kept and each generator is only
+        // touched from a single task instance.
         void Parse (SyslogQueueEntry *sqe) {
-            work_queue_.Enqueue (sqe);
+            size_t idx = boost::hash_value (sqe->ip) % shards_.size ();
+            shards_[idx].work_queue_.Enqueue (sqe);
         }
 
         void Shutdown ()
         {
             WaitForIdle (15); // wait for 15 sec..
-            work_queue_.Shutdown ();
+            for (boost::ptr_vector<ParserShard>::iterator it =
+                    shards_.begin (); it != shards_.end (); ++it) {
+                it->work_queue_.Shutdown ();
+            }
             LOG(DEBUG, __func__ << " Syslog parser shutdown done");
         }
     protected:
 
         SyslogParser ():
-             work_queue_(TaskScheduler::GetInstance()->GetTaskId(
-                         "vizd::syslog"), 0, boost::bind(
-                             &SyslogParser::ClientParse, this, _1)),
             syslog_(0)
         {
-            facilitynames_ = boost::assign::list_of ("auth") ("authpriv")
-                ("cron") ("daemon") ("ftp") ("kern") ("lpr") ("mail") ("mark")
-                ("news") ("security") ("syslog") ("user") ("uucp") ("local0")
-                ("local1") ("local2") ("local3") ("local4") ("local5")
-                ("local6") ("local7");
+            Init (1);
         }
         void WaitForIdle (int max_wait)
         {
@@ -165,226 +201,315 @@ class SyslogParser
                     scheduler->IsEmpty() << ":" << i << "/" << max_wait);
         }
 
-        enum dtype {
-            int_type = 42,
-            str_type
-        };
-        struct Holder {
-            std::string       key;
-            dtype             type;
-            int64_t           i_val;
-            std::string       s_val;
-
-            Holder (std::string k, std::string v):
-                key(k), type(str_type), s_val(v)
-            { }
-            Holder (std::string k, int64_t v):
-                key(k), type(int_type), i_val(v)
-            { }
+        // Tokeniser state over [cur_, end_)
+        class Scanner
+        {
+          public:
+            Scanner (const char *start, const char *end) :
+                cur_ (start), end_ (end) { }
 
-            std::string repr()
-            {
-                std::ostringstream s;
-                s << "{ \"" << key << "\": ";
-                if (type == int_type)
-                    s << i_val << "}";
-                else if (type == str_type)
-                    s << "\"" << s_val << "\"}";
-                else
-                    s << "**bad type**}";
-                return s.str();
-            }
+            bool AtEnd () const { return cur_ >= end_; }
+            const char *Pos () const { return cur_; }
+            void SetPos (const char *p) { cur_ = p; }
 
-            void print ()
-            {
-                LOG(DEBUG, "{ \"" << key << "\": ");
-                if (type == int_type)
-                    LOG(DEBUG, i_val << "}");
-                else if (type == str_type)
-                    LOG(DEBUG, "\"" << s_val << "\"}");
-                else
-                    LOG(DEBUG, "**bad type**}");
+            void SkipSpaces () {
+                while (cur_ < end_ && isspace ((unsigned char)*cur_))
+                    cur_++;
+            }
+            bool Lit (char c) {
+                if (cur_ < end_ && *cur_ == c) {
+                    cur_++;
+                    return true;
+                }
+                return false;
+            }
+            bool Int (int &val, int max_digits = 9) {
+                const char *p = cur_;
+                bool neg = false;
+                if (p < end_ && (*p == '-' || *p == '+')) {
+                    neg = (*p == '-');
+                    p++;
+                }
+                const char *digits = p;
+                int v = 0;
+                while (p < end_ && isdigit ((unsigned char)*p) &&
+                        p - digits < max_digits) {
+                    v = v * 10 + (*p - '0');
+                    p++;
+                }
+                if (p == digits)
+                    return false;
+                val = neg ? -v : v;
+                cur_ = p;
+                return true;
+            }
+            // Word up to a space or any of the stop characters
+            SyslogField Word (const char *stop = "") {
+                const char *p = cur_;
+                while (p < end_ && *p != ' ' && !strchr (stop, *p))
+                    p++;
+                SyslogField f (cur_, p - cur_);
+                cur_ = p;
+                return f;
             }
+            SyslogField Rest () {
+                SyslogField f (cur_, end_ - cur_);
+                cur_ = end_;
+                return f;
+            }
+            int Month () {
+                static const char *months[] = { "Jan", "Feb", "Mar", "Apr",
+                    "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+                if (end_ - cur_ < 3)
+                    return -1;
+                for (int i = 0; i < 12; i++) {
+                    if (!strncmp (cur_, months[i], 3)) {
+                        cur_ += 3;
+                        return i + 1;
+                    }
+                }
+                return -1;
+            }
+          private:
+            const char *cur_;
+            const char *end_;
         };
 
-        typedef std::map<std::string, Holder>  syslog_m_t;
-
-
-        template <typename Iterator>
-        bool parse_syslog (Iterator start, Iterator end, syslog_m_t &v)
+        // RFC 3164:
+        //   <PRI>Mmm dd hh:mm:ss [HOSTNAME ]TAG[PID]: BODY
+        bool parse_rfc3164 (Scanner &s, SyslogFields &v)
         {
-            using qi::int_;
-            using qi::_1;
-            using ascii::space;
-            using phx::insert;
-            using qi::eps;
-            using qi::char_;
-            using qi::lit;
-            using qi::lexeme;
-
-            qi::rule<Iterator, std::string(), ascii::space_type> word = lexeme[ +(char_ - ' ') ] ;
-            qi::rule<Iterator, std::string(), ascii::space_type> word2 = lexeme[ +(char_ - ':' - ' ') ] ;
-            qi::rule<Iterator, std::string(), ascii::space_type> word3 = lexeme[ +(char_ - '[' - ' ' - ':') ] ;
-            qi::rule<Iterator, std::string(), ascii::space_type> word4 = lexeme[ +(char_ - '[' - ' ' - ':') >> " " ] ;
-            qi::rule<Iterator, std::string(), ascii::space_type> body = lexeme[ *char_ ] ;
-            qi::int_parser<int, 10, 1, 3> int3_p;
-            qi::int_parser<int, 10, 1, 2> int2_p;
-            qi::int_parser<int, 10, 1, 1> int1_p;
-            struct months_: qi::symbols<char, int>
-            {
-                months_()
-                {
-                    add
-                        ("Jan", 1)
-                        ("Feb", 2)
-                        ("Mar", 3)
-                        ("Apr", 4)
-                        ("May", 5)
-                        ("Jun", 6)
-                        ("Jul", 7)
-                        ("Aug", 8)
-                        ("Sep", 9)
-                        ("Oct", 10)
-                        ("Nov", 11)
-                        ("Dec", 12)
-                    ;
+            s.SkipSpaces ();
+            if ((v.month = s.Month ()) < 0)
+                return false;
+            s.SkipSpaces ();
+            if (!s.Int (v.day))
+                return false;
+            s.SkipSpaces ();
+            if (!(s.Int (v.hour) && s.Lit (':') && s.Int (v.min) &&
+                  s.Lit (':') && s.Int (v.sec)))
+                return false;
+            s.SkipSpaces ();
+
+            // Optional hostname: a word terminated by a space
+            const char *mark = s.Pos ();
+            SyslogField host = s.Word ("[:");
+            if (!host.empty () && s.Lit (' ')) {
+                v.hostname = host;
+                s.SkipSpaces ();
+            } else {
+                s.SetPos (mark);
+            }
+
+            // tag=prog[pid]: or tag=prog:
+            mark = s.Pos ();
+            SyslogField prog = s.Word ("[:");
+            int pid;
+            if (!prog.empty () && s.Lit ('[') && s.Int (pid) && s.Lit (']') &&
+                    s.Lit (':')) {
+                v.prog = prog;
+                v.pid = pid;
+            } else {
+                s.SetPos (mark);
+                prog = s.Word (":");
+                if (!prog.empty () && s.Lit (':')) {
+                    v.prog = prog;
+                } else {
+                    // body w/ no tag
+                    s.SetPos (mark);
                 }
-            } months;
-
-            bool r = qi::phrase_parse(start, end,
-                    // Begin grammer
-                                       //facility severity
-                    (  '<' >> int_     [insert(phx::ref(v),
-                phx::construct<std::pair<std::string, Holder> >("facsev",
-                          phx::construct<Holder>("facsev", _1)))] >> '>'
-                                       //month
-                       >> months       [insert(phx::ref(v),
-                phx::construct<std::pair<std::string, Holder> >("month",
-                                  phx::construct<Holder>("month", _1)))]
-                                       //day
-                       >> int_         [insert(phx::ref(v),
-                phx::construct<std::pair<std::string, Holder> >("day",
-                                  phx::construct<Holder>("day", _1)))]
-                                       //hour
-                       >> int_         [insert(phx::ref(v),
-                phx::construct<std::pair<std::string, Holder> >("hour",
-                          phx::construct<Holder>("hour", _1)))] >> lit(":")
-                                       //min
-                       >> int_         [insert(phx::ref(v),
-                phx::construct<std::pair<std::string, Holder> >("min",
-                          phx::construct<Holder>("min", _1)))] >> lit(":")
-                                       //sec
-                       >> int_         [insert(phx::ref(v),
-                phx::construct<std::pair<std::string, Holder> >("sec",
-                                  phx::construct<Holder>("sec", _1)))]
-                                       //hostname
-                       >> -word4       [insert(phx::ref(v),
-            phx::construct<std::pair<std::string, Holder> >("hostname",
-                                  phx::construct<Holder>("hostname", _1)))]
-                                       //tag body
-                                       //  tag=prog[pid]:
-                       >> ( ( word3    [insert(phx::ref(v),
-            phx::construct<std::pair<std::string, Holder> >("prog",
-                          phx::construct<Holder>("prog", _1)))] >> lit("[")
-                              >> int_  [insert(phx::ref(v),
-            phx::construct<std::pair<std::string, Holder> >("pid",
-                          phx::construct<Holder>("pid", _1)))] >> lit("]:")
-                                       //  tag=prog:
-                              |word2   [insert(phx::ref(v),
-            phx::construct<std::pair<std::string, Holder> >("prog",
-                              phx::construct<Holder>("prog", _1))),
-                                        insert(phx::ref(v),
-            phx::construct<std::pair<std::string, Holder> >("pid",
-                          phx::construct<Holder>("pid", -1)))] >> lit(":")
-                                       //  body
-                            ) >>body   [insert(phx::ref(v),
-            phx::construct<std::pair<std::string, Holder> >("body",
-                                      phx::construct<Holder>("body", _1)))]
-                                       //body w/ no tag
-                            |body      [insert(phx::ref(v),
-            phx::construct<std::pair<std::string, Holder> >("prog",
-                                  phx::construct<Holder>("prog", ""))),
-                                        insert(phx::ref(v),
-            phx::construct<std::pair<std::string, Holder> >("pid",
-                                  phx::construct<Holder>("pid", -1))),
-                                        insert(phx::ref(v),
-            phx::construct<std::pair<std::string, Holder> >("body",
-                                  phx::construct<Holder>("body", _1)))]
-                          )
-                    )
-                    //end grammer
-                    , space);
-            return (start == end) && r;
+            }
+            s.SkipSpaces ();
+            v.body = s.Rest ();
+            return true;
         }
 
-        std::string GetMapVals (syslog_m_t v, std::string key,
-                std::string def = "")
+        // RFC 5424:
+        //   <PRI>VERSION TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD [MSG]
+        // Nil values ("-") are left empty.
+        bool parse_rfc5424 (Scanner &s, SyslogFields &v)
         {
-            std::map<std::string, Holder>::iterator i = v.find (key);
-            if (i == v.end())
-                return def;
-            return i->second.s_val;
+            int version;
+            if (!(s.Int (version) && s.Lit (' ')))
+                return false;
+            v.rfc5424 = true;
+            if (!s.Lit ('-')) {
+                if (!(s.Int (v.year, 4) && s.Lit ('-') &&
+                      s.Int (v.month, 2) && s.Lit ('-') &&
+                      s.Int (v.day, 2) && s.Lit ('T') &&
+                      s.Int (v.hour, 2) && s.Lit (':') &&
+                      s.Int (v.min, 2) && s.Lit (':') && s.Int (v.sec, 2)))
+                    return false;
+                if (s.Lit ('.')) {
+                    const char *frac = s.Pos ();
+                    int usec;
+                    if (!s.Int (usec, 6))
+                        return false;
+                    for (long digits = s.Pos () - frac; digits < 6; digits++)
+                        usec *= 10;
+                    v.usec = usec;
+                }
+                if (!s.Lit ('Z')) {
+                    const char *sign = s.Pos ();
+                    int hh, mm;
+                    if (!(s.Int (hh, 2) && s.Lit (':') && s.Int (mm, 2)))
+                        return false;
+                    v.utc_offset = (abs (hh) * 60 + mm) * 60;
+                    if (*sign == '-')
+                        v.utc_offset = -v.utc_offset;
+                }
+            }
+            if (!s.Lit (' '))
+                return false;
+            SyslogField host = s.Word ();
+            if (!(host.len == 1 && *host.ptr == '-'))
+                v.hostname = host;
+            if (!s.Lit (' '))
+                return false;
+            SyslogField app = s.Word ();
+            if (!(app.len == 1 && *app.ptr == '-'))
+                v.prog = app;
+            if (!s.Lit (' '))
+                return false;
+            const char *mark = s.Pos ();
+            int pid;
+            if (!(s.Int (pid) && (s.AtEnd () || *s.Pos () == ' '))) {
+                s.SetPos (mark);
+                s.Word ();
+            } else {
+                v.pid = pid;
+            }
+            if (!s.Lit (' '))
+                return false;
+            s.Word (); // MSGID
+            if (!s.Lit (' '))
+                return false;
+            // STRUCTURED-DATA: "-" or one or more [SD-ELEMENT]
+            if (!s.Lit ('-')) {
+                const char *p = s.Pos ();
+                SyslogField rest = s.Rest ();
+                const char *end = rest.end ();
+                if (p >= end || *p != '[')
+                    return false;
+                bool quoted = false;
+                while (p < end) {
+                    if (quoted) {
+                        if (*p == '\\')
+                            p++;
+                        else if (*p == '"')
+                            quoted = false;
+                    } else if (*p == '"') {
+                        quoted = true;
+                    } else if (*p == ']' && (p + 1 >= end || p[1] != '[')) {
+                        p++;
+                        break;
+                    }
+                    p++;
+                }
+                s.SetPos (p);
+            }
+            if (s.Lit (' ')) {
+                SyslogField msg = s.Rest ();
+                if (msg.len >= 3 && !memcmp (msg.ptr, "\xEF\xBB\xBF", 3)) {
+                    msg.ptr += 3;
+                    msg.len -= 3;
+                }
+                v.body = msg;
+            }
+            return s.AtEnd ();
         }
 
-        int64_t GetMapVal (syslog_m_t v, std::string key, int def = 0)
+        bool parse_syslog (const char *start, const char *end,
+                SyslogFields &v)
         {
-            std::map<std::string, Holder>::iterator i = v.find (key);
-            if (i == v.end())
-                return def;
-            return i->second.i_val;
+            Scanner s (start, end);
+            s.SkipSpaces ();
+            if (!(s.Lit ('<') && s.Int (v.facsev, 3) && s.Lit ('>')))
+                return false;
+            if (!s.AtEnd () && isdigit ((unsigned char)*s.Pos ()))
+                return parse_rfc5424 (s, v);
+            return parse_rfc3164 (s, v);
         }
 
-        void GetFacilitySeverity (syslog_m_t v, int& facility, int& severity)
+        void GetFacilitySeverity (const SyslogFields &v, int& facility,
+                int& severity)
         {
-            int fs = GetMapVal (v, "facsev");
+            int fs = v.facsev;
             severity = fs & 0x7;
             facility = fs >> 3;
         }
 
-        void GetTimestamp (syslog_m_t v, time_t& timestamp)
+        static int FieldOr (int val, int def) {
+            return val < 0 ? def : val;
+        }
+
+        // The fields come straight off the network; boost::gregorian
+        // throws on a date that does not exist.
+        static bool ValidTimestamp (int year, int month, int day, int hour,
+                int min, int sec)
+        {
+            if (year < 1400 || year > 9999 || month < 1 || month > 12 ||
+                    day < 1 || day > boost::gregorian::gregorian_calendar::
+                        end_of_month_day (year, month))
+                return false;
+            return hour >= 0 && hour < 24 && min >= 0 && min < 60 &&
+                sec >= 0 && sec <= 60;
+        }
+
+        // Falls back to the receive time when the message has no valid
+        // timestamp.
+        void GetTimestamp (const SyslogFields &v, time_t& timestamp)
         {
+            bt::ptime epoch(boost::gregorian::date(1970,1,1));
+            if (v.rfc5424 && v.year >= 0) {
+                if (!ValidTimestamp (v.year, v.month, v.day, v.hour, v.min,
+                        v.sec)) {
+                    timestamp = UTCTimestampUsec ();
+                    return;
+                }
+                bt::ptime p(boost::gregorian::date (v.year, v.month, v.day),
+                    bt::time_duration(v.hour, v.min, v.sec));
+                timestamp = (p - epoch).total_microseconds() + v.usec
+                                - v.utc_offset * 1000000LL;
+                return;
+            }
             bt::ptime lt(bt::microsec_clock::local_time());
             bt::ptime ut(bt::microsec_clock::universal_time());
             bt::time_duration diff = lt - ut;
             tm pt_tm = bt::to_tm(lt);
-            bt::ptime p(boost::gregorian::date (pt_tm.tm_year+1900,
-                GetMapVal (v, "month", pt_tm.tm_mon),
-                GetMapVal (v, "day", pt_tm.tm_mday)), bt::time_duration(
-                    GetMapVal (v, "hour", pt_tm.tm_hour),
-                    GetMapVal (v, "min", pt_tm.tm_min),
-                    GetMapVal (v, "sec", pt_tm.tm_sec)));
-            bt::ptime epoch(boost::gregorian::date(1970,1,1));
+            int year = pt_tm.tm_year + 1900;
+            int month = FieldOr (v.month, pt_tm.tm_mon + 1);
+            int day = FieldOr (v.day, pt_tm.tm_mday);
+            int hour = FieldOr (v.hour, pt_tm.tm_hour);
+            int min = FieldOr (v.min, pt_tm.tm_min);
+            int sec = FieldOr (v.sec, pt_tm.tm_sec);
+            if (!ValidTimestamp (year, month, day, hour, min, sec)) {
+                timestamp = UTCTimestampUsec ();
+                return;
+            }
+            bt::ptime p(boost::gregorian::date (year, month, day),
+                bt::time_duration(hour, min, sec));
             timestamp = (p - epoch).total_microseconds()
                             - diff.total_microseconds();
-            /*
-            time_t _timestamp = UTCTimestampUsec ();
-            std::cout << "ts diff " << timestamp - _timestamp  << std::endl
-                << timestamp << std::endl <<  _timestamp << std::endl;
-            */
         }
 
-        void PostParsing (syslog_m_t &v) {
+        void PostParsing (SyslogFields &v) {
           time_t timestamp;
           GetTimestamp (v, timestamp);
-          v.insert(std::pair<std::string, Holder>("timestamp",
-                Holder("timestamp", timestamp)));
-          int f, s;
-          GetFacilitySeverity (v, f, s);
-          v.insert(std::pair<std::string, Holder>("facility",
-                Holder("facility", f)));
-          v.insert(std::pair<std::string, Holder>("severity",
-                Holder("severity", s)));
+          v.timestamp = timestamp;
+          GetFacilitySeverity (v, v.facility, v.severity);
         }
 
-        SyslogGenerator *GetGenerator (std::string ip)
+        SyslogGenerator *GetGenerator (int shard, const std::string &ip)
         {
+            boost::ptr_map<std::string, SyslogGenerator> &genarators =
+                shards_[shard].genarators_;
             boost::ptr_map<std::string, SyslogGenerator>::iterator i =
-                                                genarators_.find (ip);
-            if (i == genarators_.end()) {
-
-                genarators_.insert (ip, new SyslogGenerator(syslog_, ip,
-                                        "syslog"));
-                i = genarators_.find (ip);
+                                                genarators.find (ip);
+            if (i == genarators.end()) {
+                std::string key (ip);
+                i = genarators.insert (key, new SyslogGenerator(syslog_, ip,
+                                        "syslog")).first;
             }
             return i->second;
         }
@@ -396,98 +521,63 @@ class SyslogParser
             return "";
         }
 
-        std::string EscapeXmlTags (std::string text)
+        std::string EscapeXmlTags (const SyslogField &text)
         {
-            std::ostringstream s;
-#ifdef SYSLOG_DEBUG
-            std::ostringstream ff, bb, ft;
-            int i = 0;
-
-            ft << "|" << text << "|\n";
-#endif
-
-            for (std::string::const_iterator it = text.begin();
-                                             it != text.end(); ++it) {
+            std::string s;
+            s.reserve (text.len);
+            for (const char *it = text.begin(); it != text.end(); ++it) {
                 switch(*it) {
-                    case '&':  s << "&amp;";  continue;
-                    //case '"':  s << "&quot;"; continue;
-                    case '\'': s << "&apos;"; continue;
-                    case '<':  s << "&lt;";   continue;
-                    case '>':  s << "&gt;";   continue;
-                    default:   if (!(0x80 & *it))
-                                    s << *it;
-                               else
-                                    s << "&#" << (int)((uint8_t)*it) << ";";
+                    case '&':  s.append ("&amp;");  continue;
+                    //case '"':  s.append ("&quot;"); continue;
+                    case '\'': s.append ("&apos;"); continue;
+                    case '<':  s.append ("&lt;");   continue;
+                    case '>':  s.append ("&gt;");   continue;
+                    default:   if (!(0x80 & *it)) {
+                                    s.push_back (*it);
+                               } else {
+                                    char esc[8];
+                                    snprintf (esc, sizeof (esc), "&#%d;",
+                                        (int)((uint8_t)*it));
+                                    s.append (esc);
+                               }
                 }
-#ifdef SYSLOG_DEBUG
-                if (!(i % 16)) {
-                    ft << std::endl << ff.str() + "    " + bb.str();
-                    ff.str("");
-                    bb.str("");
-                    ff << std::setfill('0') << std::setw(4) << std::hex << i << "  ";
-                    ff << std::setfill('0') << std::setw(2) << std::hex << (int) ((uint8_t) *it) << " ";
-                    if (isprint(*it)) {
-                        bb << *it;
-                    } else {
-                        bb << '.';
-                    }
-                } else {
-                    ff << std::setfill('0') << std::setw(2) << std::hex << (int) ((uint8_t) *it) << " ";
-                    if (!((i+1) % 8)) {
-                        ff << " ";
-                    }
-                    if (isprint(*it)) {
-                        bb << *it;
-                    } else {
-                        bb << '.';
-                    }
-                }
-                i++;
-#endif
             }
 #ifdef SYSLOG_DEBUG
-            int j, r = i % 16;
-            ft << std::endl << ff.str();
-            for (j = r; j < 16; j++)
-                ft << "   ";
-            if (r < 7)
-                ft << " ";
-            if (r < 15)
-                ft << " ";
-            ft << "    " + bb.str() + "\n[" + s.str() + "]";
-            LOG(ERROR, __func__ << ft.str());
+            LOG(ERROR, __func__ << " |" << text.str () << "|\n[" << s << "]");
 #endif
+            return s;
+        }
 
-            return s.str();
+        std::string GetMsgBody (const SyslogFields &v) {
+            return EscapeXmlTags (v.body);
         }
 
-        std::string GetMsgBody (syslog_m_t v) {
-            return EscapeXmlTags (GetMapVals (v, "body", ""));
+        std::string GetModule(const SyslogFields &v) {
+            return v.prog.empty () ? "UNKNOWN" : v.prog.str ();
         }
 
-        std::string GetModule(syslog_m_t v) {
-            return GetMapVals(v, "prog", "UNKNOWN");
+        std::string GetHostname(const SyslogFields &v) {
+            return v.hostname.empty () ? v.ip : v.hostname.str ();
         }
 
-        std::string GetFacility(syslog_m_t v) {
-            return GetSyslogFacilityName(GetMapVal(v, "facility"));
+        std::string GetFacility(const SyslogFields &v) {
+            return GetSyslogFacilityName(v.facility);
         }
 
-        int GetPID(syslog_m_t v) {
-            return GetMapVal (v, "pid", -1);
+        int GetPID(const SyslogFields &v) {
+            return v.pid;
         }
 
-        virtual void MakeSandesh (syslog_m_t v) {
+        virtual void MakeSandesh (int shard, const SyslogFields &v) {
             SandeshHeader hdr;
-            std::string   ip(GetMapVals(v, "ip"));
 
-            hdr.set_Timestamp(GetMapVal(v, "timestamp"));
+            hdr.set_Timestamp(v.timestamp);
             hdr.set_Module(GetModule(v));
-            hdr.set_Source(GetMapVals(v, "hostname", ip));
+            hdr.set_Source(GetHostname(v));
             hdr.set_Type(SandeshType::SYSLOG);
-            hdr.set_Level(GetMapVal(v, "severity"));
+            hdr.set_Level(v.severity);
             hdr.set_Category(GetFacility(v));
-            hdr.set_IPAddress(ip);
+            hdr.set_IPAddress(v.ip);
 
             int pid = GetPID(v);
             if (pid >= 0)
@@ -499,49 +589,40 @@ class SyslogParser
             SandeshSyslogMessage *smessage =
                 static_cast<SandeshSyslogMessage *>(xmessage);
             smessage->SetHeader(hdr);
-            VizMsg vmsg(smessage, umn_gen_());
-            GetGenerator (ip)->ReceiveSandeshMsg (&vmsg, false);
+            VizMsg vmsg(smessage, shards_[shard].umn_gen_());
+            SyslogGenerator *gen = GetGenerator (shard, v.ip);
+            {
+                // The DbHandler is shared by the generators of all shards
+                tbb::mutex::scoped_lock lock (db_mutex_);
+                gen->ReceiveSandeshMsg (&vmsg, false);
+            }
             vmsg.msg = NULL;
             delete smessage;
         }
 
-        bool ClientParse (SyslogQueueEntry *sqe) {
-          std::string ip = sqe->ip;
-          const uint8_t *p = buffer_cast<const uint8_t *>(sqe->data);
+        bool ClientParse (int shard, SyslogQueueEntry *sqe) {
+          const char *p = buffer_cast<const char *>(sqe->data);
 #ifdef SYSLOG_DEBUG
           LOG(DEBUG, "cnt parser " << sqe->length << " bytes from (" <<
-              ip << ":" << sqe->port << ")[");
-
-          {
-              std::string str (p, p + sqe->length);
-              LOG(DEBUG, str << "]\n");
-          }
+              sqe->ip << ":" << sqe->port << ")[" <<
+              std::string (p, p + sqe->length) << "]\n");
 #endif
 
-          syslog_m_t v;
+          SyslogFields v;
           bool r = parse_syslog (p, p + sqe->length, v);
 #ifdef SYSLOG_DEBUG
           LOG(DEBUG, "parsed " << r << ".");
 #endif
 
-          v.insert(std::pair<std::string, Holder>("ip",
-                Holder("ip", ip)));
-          PostParsing (v);
-
-          MakeSandesh (v);
+          if (r) {
+              v.ip = sqe->ip;
+              PostParsing (v);
+              MakeSandesh (shard, v);
+          }
 
 #ifdef SYSLOG_DEBUG
-          LOG(DEBUG, __func__ << " syslog msg from " << ip << ":" <<
-                GetMapVals (v, "body", "**EMPTY**"));
-
-          int i = 0;
-          while (!v.empty()) {
-              Holder d = v.begin()->second;
-              LOG(DEBUG, i++ << ": " << d.repr());
-              v.erase(v.begin());
-          }
-#else
-          v.clear ();
+          LOG(DEBUG, __func__ << " syslog msg from " << v.ip << ":" <<
+                (v.body.empty () ? "**EMPTY**" : v.body.str ()));
 #endif
           sqe->free ();
           delete sqe;
@@ -551,9 +632,33 @@ class SyslogParser
           return r;
         }
     private:
-        WorkQueue<SyslogQueueEntry*>                 work_queue_;
-        boost::uuids::random_generator               umn_gen_;
-        boost::ptr_map<std::string, SyslogGenerator> genarators_;
+        // Each shard runs as its own instance of the vizd::syslog task and
+        // owns the generators for the sources hashed to it.
+        struct ParserShard {
+            ParserShard (SyslogParser *parser, int shard) :
+                work_queue_(TaskScheduler::GetInstance()->GetTaskId(
+                         "vizd::syslog"), shard, boost::bind(
+                             &SyslogParser::ClientParse, parser, shard, _1))
+            { }
+            WorkQueue<SyslogQueueEntry*>                 work_queue_;
+            boost::uuids::random_generator               umn_gen_;
+            boost::ptr_map<std::string, SyslogGenerator> genarators_;
+        };
+
+        void Init (int shards)
+        {
+            facilitynames_ = boost::assign::list_of ("auth") ("authpriv")
+                ("cron") ("daemon") ("ftp") ("kern") ("lpr") ("mail") ("mark")
+                ("news") ("security") ("syslog") ("user") ("uucp") ("local0")
+                ("local1") ("local2") ("local3") ("local4") ("local5")
+                ("local6") ("local7");
+            for (int i = 0; i < std::max (shards, 1); i++)
+                shards_.push_back (new ParserShard (this, i));
+        }
+
+        boost::ptr_vector<ParserShard>               shards_;
+        // Serializes the calls into the DbHandler
+        tbb::mutex                                   db_mutex_;
         SyslogListeners                             *syslog_;
         std::vector<std::string>                     facilitynames_;
 };
@@ -596,6 +701,7 @@ void SyslogUDPListener::Start (std::string ipaddress, int port)
       Initialize (port);
     else
       Initialize (ipaddress, port);
+    SetReceiveBatchSize (kMaxReceiveBatch);
     StartReceive ();
     LOG(DEBUG, __func__ << " Initialization of UDP syslog listener done!");
 }
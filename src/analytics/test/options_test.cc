@@ -52,6 +52,7 @@ TEST_F(OptionsTest, NoArguments) {
                      options_.cassandra_server_list());
     EXPECT_EQ(options_.redis_server(), "127.0.0.1");
     EXPECT_EQ(options_.redis_port(), default_redis_port);
+    EXPECT_EQ(options_.redis_uve_coalesce_interval(), 100);
     EXPECT_EQ(options_.collector_server(), "0.0.0.0");
     EXPECT_EQ(options_.collector_port(), default_collector_port);
     EXPECT_EQ(options_.config_file(), "/etc/contrail/collector.conf");
@@ -87,6 +88,7 @@ TEST_F(OptionsTest, DefaultConfFile) {
                      options_.cassandra_server_list());
     EXPECT_EQ(options_.redis_server(), "127.0.0.1");
     EXPECT_EQ(options_.redis_port(), default_redis_port);
+    EXPECT_EQ(options_.redis_uve_coalesce_interval(), 100);
     EXPECT_EQ(options_.collector_server(), "0.0.0.0");
     EXPECT_EQ(options_.collector_port(), default_collector_port);
     EXPECT_EQ(options_.config_file(),
@@ -125,6 +127,7 @@ TEST_F(OptionsTest, OverrideStringFromCommandLine) {
                      options_.cassandra_server_list());
     EXPECT_EQ(options_.redis_server(), "127.0.0.1");
     EXPECT_EQ(options_.redis_port(), default_redis_port);
+    EXPECT_EQ(options_.redis_uve_coalesce_interval(), 100);
     EXPECT_EQ(options_.collector_server(), "0.0.0.0");
     EXPECT_EQ(options_.collector_port(), default_collector_port);
     EXPECT_EQ(options_.config_file(),
@@ -163,6 +166,7 @@ TEST_F(OptionsTest, OverrideBooleanFromCommandLine) {
                      options_.cassandra_server_list());
     EXPECT_EQ(options_.redis_server(), "127.0.0.1");
     EXPECT_EQ(options_.redis_port(), default_redis_port);
+    EXPECT_EQ(options_.redis_uve_coalesce_interval(), 100);
     EXPECT_EQ(options_.collector_server(), "0.0.0.0");
     EXPECT_EQ(options_.collector_port(), default_collector_port);
     EXPECT_EQ(options_.config_file(),
@@ -215,6 +219,7 @@ TEST_F(OptionsTest, CustomConfigFile) {
         "[REDIS]\n"
         "server=1.2.3.4\n"
         "port=200\n"
+        "uve_coalesce_interval=50\n"
         "\n"
     ;
 
@@ -241,6 +246,7 @@ TEST_F(OptionsTest, CustomConfigFile) {
 
     EXPECT_EQ(options_.redis_server(), "1.2.3.4");
     EXPECT_EQ(options_.redis_port(), 200);
+    EXPECT_EQ(options_.redis_uve_coalesce_interval(), 50);
     EXPECT_EQ(options_.collector_server(), "3.4.5.6");
     EXPECT_EQ(options_.collector_port(), 100);
     EXPECT_EQ(options_.config_file(),
@@ -294,6 +300,7 @@ TEST_F(OptionsTest, CustomConfigFileAndOverrideFromCommandLine) {
         "[REDIS]\n"
         "server=1.2.3.4\n"
         "port=200\n"
+        "uve_coalesce_interval=50\n"
         "\n"
     ;
 
@@ -331,6 +338,7 @@ TEST_F(OptionsTest, CustomConfigFileAndOverrideFromCommandLine) {
                      options_.cassandra_server_list());
     EXPECT_EQ(options_.redis_server(), "1.2.3.4");
     EXPECT_EQ(options_.redis_port(), 200);
+    EXPECT_EQ(options_.redis_uve_coalesce_interval(), 50);
     EXPECT_EQ(options_.collector_server(), "3.4.5.6");
     EXPECT_EQ(options_.collector_port(), 1000);
     EXPECT_EQ(options_.config_file(),
@@ -19,29 +19,25 @@ class SyslogParserTestHelper : public SyslogParser
 {
     public:
         SyslogParserTestHelper() {}
-        virtual void MakeSandesh (syslog_m_t v) {
-            for (syslog_m_t::iterator i = v.begin(); i != v.end(); ++i) {
-                v_.insert(std::pair<std::string, Holder>(i->first,
-                    i->second));
-            }
-            ip_ = GetMapVals(v, "ip");
-            ts_ = GetMapVal(v, "timestamp");
+        virtual void MakeSandesh (int shard, const SyslogFields &v) {
+            ip_ = v.ip;
+            ts_ = v.timestamp;
             module_ = GetModule(v);
-            hostname_ = GetMapVals(v, "hostname", ip_);
-            severity_ = GetMapVal(v, "severity");
+            hostname_ = GetHostname(v);
+            severity_ = v.severity;
             facility_ = GetFacility(v);
             pid_ = GetPID(v);
             body_ = "<Syslog>" + GetMsgBody (v) + "</Syslog>";
         }
 
         bool TestParse(std::string s) {
-            syslog_m_t v;
-            bool r = parse_syslog (s.begin(), s.end(), v);
-            v.insert(std::pair<std::string, Holder>("ip",
-                  Holder("ip", "10.0.0.42")));
-            PostParsing (v);
-
-            MakeSandesh (v);
+            SyslogFields v;
+            bool r = parse_syslog (s.data(), s.data() + s.size(), v);
+            if (r) {
+                v.ip = "10.0.0.42";
+                PostParsing (v);
+                MakeSandesh (0, v);
+            }
             return r;
         }
 
@@ -54,7 +50,6 @@ class SyslogParserTestHelper : public SyslogParser
         int         pid() { return pid_; }
         std::string body() { return body_; }
     private:
-        syslog_m_t  v_;
         std::string ip_;
         int64_t     ts_;
         std::string module_;
@@ -113,6 +108,7 @@ class SyslogCollectorTest : public ::testing::Test
     }
     protected:
     virtual void SetUp() {
+        received_ = 0;
         evm_.reset(new EventManager());
         db_handler_.reset(new DbHandlerMock(evm_.get()));
         listener_ = new SyslogListeners(evm_.get(),
@@ -128,6 +124,11 @@ class SyslogCollectorTest : public ::testing::Test
         thread_->Start();
     }
 
+    void CountVizMsg(const VizMsg *vmsgp) {
+        AssertVizMsg(vmsgp);
+        received_++;
+    }
+
     bool myTestCb(const VizMsg *v, bool b, DbHandler *d) {
         EXPECT_STREQ(v->msg->GetMessageType().c_str(), "Syslog");
         return true;
@@ -149,6 +150,7 @@ class SyslogCollectorTest : public ::testing::Test
         }
         Sandesh::Uninit();
     }
+    tbb::atomic<int>               received_;
     SyslogMsgGen                  *gen_;
     SyslogListeners               *listener_;
     std::auto_ptr<DbHandlerMock>   db_handler_;
@@ -201,6 +203,75 @@ TEST_F(SyslogParserTest, ParseWithHostOne)
     EXPECT_TRUE(0 == strncmp ("a3s45", hostname().c_str(), 5));
 }
 
+TEST_F(SyslogParserTest, ParseRfc5424)
+{
+    bool r = Parse("<165>1 2003-10-11T22:14:15.003Z mymachine.example.com evntslog - ID47 [exampleSDID@32473 iut=\"3\" eventSource=\"Application\" eventID=\"1011\"] An application event log entry...");
+    EXPECT_TRUE(r);
+    EXPECT_EQ("mymachine.example.com", hostname());
+    EXPECT_EQ("evntslog", module());
+    EXPECT_EQ(-1, pid());
+    EXPECT_EQ(5, severity());
+    EXPECT_EQ(1065910455003000LL, ts());
+    EXPECT_EQ("<Syslog>An application event log entry...</Syslog>", body());
+}
+
+TEST_F(SyslogParserTest, ParseRfc5424NilSD)
+{
+    bool r = Parse("<34>1 2003-10-11T22:14:15.003-07:00 mymachine su 1234 - - 'su root' failed for lonvick on /dev/pts/8");
+    EXPECT_TRUE(r);
+    EXPECT_EQ("mymachine", hostname());
+    EXPECT_EQ("su", module());
+    EXPECT_EQ(1234, pid());
+    EXPECT_EQ(2, severity());
+    EXPECT_EQ(1065935655003000LL, ts());
+    EXPECT_EQ("<Syslog>&apos;su root&apos; failed for lonvick on /dev/pts/8</Syslog>",
+        body());
+}
+
+// A timestamp that is not a valid date is replaced by the receive time.
+TEST_F(SyslogParserTest, ParseRfc5424BadDate)
+{
+    const char *msgs[] = {
+        "<34>1 2003-13-11T22:14:15.003Z mymachine su - - - bad month",
+        "<34>1 2003-00-11T22:14:15.003Z mymachine su - - - bad month",
+        "<34>1 2003-10-00T22:14:15.003Z mymachine su - - - bad day",
+        "<34>1 2003-02-30T22:14:15.003Z mymachine su - - - bad day",
+        "<34>1 0000-10-11T22:14:15.003Z mymachine su - - - bad year",
+        "<34>1 2003-10-11T25:14:15.003Z mymachine su - - - bad hour",
+    };
+    for (size_t i = 0; i < sizeof(msgs) / sizeof(msgs[0]); i++) {
+        int64_t start = UTCTimestampUsec();
+        EXPECT_TRUE(Parse(msgs[i]));
+        EXPECT_LE(start, ts());
+        EXPECT_GE(UTCTimestampUsec(), (uint64_t)ts());
+        EXPECT_EQ("mymachine", hostname());
+    }
+}
+
+TEST_F(SyslogParserTest, ParseRfc3164BadDate)
+{
+    int64_t start = UTCTimestampUsec();
+    EXPECT_TRUE(Parse("<84>Feb 31 13:44:21 a3s45 sudo: bad day"));
+    EXPECT_LE(start, ts());
+    EXPECT_GE(UTCTimestampUsec(), (uint64_t)ts());
+    EXPECT_EQ("a3s45", hostname());
+}
+
+TEST_F(SyslogParserTest, DISABLED_ParseFlood)
+{
+    const int kMessages = 100000;
+    std::string msg("<150>Feb 25 13:44:36 a3s45 haproxy[3535]: 127.0.0.1:43566 [25/Feb/2014:13:44:36.630] contrail-discovery contrail-discovery-backend/10.84.9.45 0/0/0/121/121 200 180 - - ---- 1/1/0/1/0 0/0 \"POST /subscribe HTTP/1.1\"");
+    uint64_t start = UTCTimestampUsec();
+    int parsed = 0;
+    for (int i = 0; i < kMessages; i++) {
+        parsed += Parse(msg) ? 1 : 0;
+    }
+    uint64_t elapsed = UTCTimestampUsec() - start;
+    EXPECT_EQ(kMessages, parsed);
+    LOG(DEBUG, "Parsed " << kMessages << " messages in " << elapsed <<
+        " usec (" << (kMessages * 1000000ULL) / (elapsed + 1) << " msgs/sec)");
+}
+
 TEST_F(SyslogCollectorTest, End2End)
 {
     EXPECT_CALL(*db_handler_.get(), MessageTableInsert(_))
@@ -210,6 +281,30 @@ TEST_F(SyslogCollectorTest, End2End)
     task_util::WaitForIdle();
 }
 
+TEST_F(SyslogCollectorTest, End2EndFlood)
+{
+    const int kMessages = 1000;
+    EXPECT_CALL(*db_handler_.get(), MessageTableInsert(_))
+            .WillRepeatedly(Invoke(this, &SyslogCollectorTest::CountVizMsg));
+    const int kBurst = 100;
+    uint64_t start = UTCTimestampUsec();
+    // Bursts stay well within the socket receive buffer, so that nothing
+    // is dropped.
+    for (int i = 0; i < kMessages; i++) {
+        std::ostringstream ss;
+        ss << "<84>Feb 25 13:44:21 a3s45 sudo: flood message " << i;
+        SendLog(ss.str());
+        if ((i + 1) % kBurst == 0) {
+            TASK_UTIL_EXPECT_EQ(i + 1, received_);
+        }
+    }
+    task_util::WaitForIdle();
+    EXPECT_EQ(kMessages, received_);
+    uint64_t elapsed = UTCTimestampUsec() - start;
+    LOG(DEBUG, "Received " << received_ << "/" << kMessages <<
+        " messages in " << elapsed << " usec");
+}
+
 int
 main(int argc, char **argv)
 {
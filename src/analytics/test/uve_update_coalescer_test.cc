@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "testing/gunit.h"
+
+#include <vector>
+#include <boost/bind.hpp>
+
+#include <base/logging.h>
+
+#include "../uve_update_coalescer.h"
+
+using std::string;
+using std::vector;
+
+class UVEUpdateCoalescerTest : public ::testing::Test {
+protected:
+    typedef UVEUpdateCoalescer::Key Key;
+    typedef UVEUpdateCoalescer::Value Value;
+
+    UVEUpdateCoalescerTest()
+        : coalescer_(boost::bind(&UVEUpdateCoalescerTest::Send, this, _1, _2),
+                     8) {
+    }
+
+    bool Send(const Key &key, const Value &value) {
+        sent_.push_back(std::make_pair(key, value));
+        events_.push_back("update " + key.key + " " + key.attr);
+        return true;
+    }
+
+    bool DeleteFn(const string &what) {
+        events_.push_back("delete " + what);
+        return true;
+    }
+
+    static Key MakeKey(const string &source, const string &key,
+                       const string &attr) {
+        return Key(source, "Compute", "VRouterAgent", "0", key,
+                   "UveVirtualNetworkAgent", attr);
+    }
+
+    static Value MakeValue(const string &message, int32_t seq) {
+        return Value(message, seq, "", "", seq);
+    }
+
+    bool Delete(const string &source, const string &key) {
+        return coalescer_.Delete(source, "Compute", "VRouterAgent", "0", key,
+            key.empty() ? "" : "UveVirtualNetworkAgent",
+            boost::bind(&UVEUpdateCoalescerTest::DeleteFn, this,
+                        source + ":" + key));
+    }
+
+    UVEUpdateCoalescer coalescer_;
+    vector<std::pair<Key, Value> > sent_;
+    vector<string> events_;
+};
+
+// Only the latest value of an attribute is sent on flush.
+TEST_F(UVEUpdateCoalescerTest, Coalesce) {
+    coalescer_.Update(MakeKey("a1", "vn1", "in_bytes"), MakeValue("1", 1));
+    coalescer_.Update(MakeKey("a1", "vn1", "in_bytes"), MakeValue("2", 2));
+    coalescer_.Update(MakeKey("a1", "vn1", "out_bytes"), MakeValue("3", 3));
+    coalescer_.Update(MakeKey("a1", "vn1", "in_bytes"), MakeValue("4", 4));
+    EXPECT_EQ(2, coalescer_.pending());
+    EXPECT_TRUE(sent_.empty());
+
+    coalescer_.Flush();
+    ASSERT_EQ(2, sent_.size());
+    EXPECT_EQ("in_bytes", sent_[0].first.attr);
+    EXPECT_EQ("4", sent_[0].second.message);
+    EXPECT_EQ(4, sent_[0].second.seq);
+    EXPECT_EQ("out_bytes", sent_[1].first.attr);
+    EXPECT_EQ("3", sent_[1].second.message);
+    EXPECT_EQ(2, coalescer_.coalesced());
+    EXPECT_EQ(1, coalescer_.flushed());
+    EXPECT_EQ(0, coalescer_.pending());
+
+    // Nothing is held, so the flush sends nothing.
+    coalescer_.Flush();
+    EXPECT_EQ(2, sent_.size());
+    EXPECT_EQ(1, coalescer_.flushed());
+}
+
+TEST_F(UVEUpdateCoalescerTest, Coalescable) {
+    EXPECT_TRUE(UVEUpdateCoalescer::IsCoalescable(Value("", 0, "", "", 0)));
+    EXPECT_TRUE(UVEUpdateCoalescer::IsCoalescable(
+        Value("", 0, "union", "", 0)));
+    EXPECT_FALSE(UVEUpdateCoalescer::IsCoalescable(
+        Value("", 0, "stats", "", 0)));
+    EXPECT_FALSE(UVEUpdateCoalescer::IsCoalescable(
+        Value("", 0, "", "histogram", 0)));
+}
+
+// Holding max_pending attributes flushes them inline.
+TEST_F(UVEUpdateCoalescerTest, MaxPending) {
+    for (int i = 0; i < 7; i++) {
+        coalescer_.Update(MakeKey("a1", "vn1", string(1, 'a' + i)),
+                          MakeValue("1", i));
+    }
+    EXPECT_EQ(7, coalescer_.pending());
+    EXPECT_TRUE(sent_.empty());
+    coalescer_.Update(MakeKey("a1", "vn1", "h"), MakeValue("1", 7));
+    EXPECT_EQ(0, coalescer_.pending());
+    EXPECT_EQ(8, sent_.size());
+    EXPECT_EQ(1, coalescer_.flushed());
+}
+
+// A delete drops the held updates of the UVE, so that a later flush does
+// not resurrect it, and leaves the other UVEs alone.
+TEST_F(UVEUpdateCoalescerTest, Delete) {
+    coalescer_.Update(MakeKey("a1", "vn1", "in_bytes"), MakeValue("1", 1));
+    coalescer_.Update(MakeKey("a1", "vn1", "out_bytes"), MakeValue("2", 2));
+    coalescer_.Update(MakeKey("a1", "vn2", "in_bytes"), MakeValue("3", 3));
+    coalescer_.Update(MakeKey("a2", "vn1", "in_bytes"), MakeValue("4", 4));
+
+    EXPECT_TRUE(Delete("a1", "vn1"));
+    EXPECT_EQ(2, coalescer_.pending());
+    coalescer_.Flush();
+
+    ASSERT_EQ(3, events_.size());
+    EXPECT_EQ("delete a1:vn1", events_[0]);
+    EXPECT_EQ("update vn2 in_bytes", events_[1]);
+    EXPECT_EQ("update vn1 in_bytes", events_[2]);
+    EXPECT_EQ("a2", sent_[1].first.source);
+}
+
+// A delete of all the UVEs of a generator drops all its held updates.
+TEST_F(UVEUpdateCoalescerTest, DeleteGenerator) {
+    coalescer_.Update(MakeKey("a1", "vn1", "in_bytes"), MakeValue("1", 1));
+    coalescer_.Update(MakeKey("a1", "vn2", "in_bytes"), MakeValue("2", 2));
+    coalescer_.Update(MakeKey("a2", "vn1", "in_bytes"), MakeValue("3", 3));
+    coalescer_.Update(MakeKey("a3", "vn1", "in_bytes"), MakeValue("4", 4));
+
+    EXPECT_TRUE(Delete("a2", ""));
+    EXPECT_EQ(3, coalescer_.pending());
+    coalescer_.Flush();
+
+    ASSERT_EQ(3, sent_.size());
+    EXPECT_EQ("a1", sent_[0].first.source);
+    EXPECT_EQ("a1", sent_[1].first.source);
+    EXPECT_EQ("a3", sent_[2].first.source);
+}
+
+// Updates after a delete are held and sent as usual.
+TEST_F(UVEUpdateCoalescerTest, UpdateAfterDelete) {
+    coalescer_.Update(MakeKey("a1", "vn1", "in_bytes"), MakeValue("1", 1));
+    EXPECT_TRUE(Delete("a1", "vn1"));
+    coalescer_.Update(MakeKey("a1", "vn1", "in_bytes"), MakeValue("2", 2));
+    coalescer_.Flush();
+
+    ASSERT_EQ(1, sent_.size());
+    EXPECT_EQ("2", sent_[0].second.message);
+    ASSERT_EQ(2, events_.size());
+    EXPECT_EQ("delete a1:vn1", events_[0]);
+    EXPECT_EQ("update vn1 in_bytes", events_[1]);
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
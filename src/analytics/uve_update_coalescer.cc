@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "analytics/uve_update_coalescer.h"
+
+#include "base/util.h"
+
+using std::string;
+
+UVEUpdateCoalescer::Key::Key(const string &source, const string &node_type,
+        const string &module, const string &instance_id, const string &key,
+        const string &type, const string &attr) :
+    source(source), node_type(node_type), module(module),
+    instance_id(instance_id), key(key), type(type), attr(attr) {
+}
+
+int UVEUpdateCoalescer::Key::CompareTo(const Key &rhs) const {
+    KEY_COMPARE(source, rhs.source);
+    KEY_COMPARE(node_type, rhs.node_type);
+    KEY_COMPARE(module, rhs.module);
+    KEY_COMPARE(instance_id, rhs.instance_id);
+    KEY_COMPARE(key, rhs.key);
+    KEY_COMPARE(type, rhs.type);
+    KEY_COMPARE(attr, rhs.attr);
+    return 0;
+}
+
+UVEUpdateCoalescer::UVEUpdateCoalescer(SendFn send_fn, size_t max_pending)
+    : send_fn_(send_fn), max_pending_(max_pending) {
+    coalesced_ = 0;
+    flushed_ = 0;
+}
+
+void UVEUpdateCoalescer::Update(const Key &key, const Value &value) {
+    bool flush;
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        std::pair<UpdateMap::iterator, bool> ret =
+            pending_.insert(std::make_pair(key, value));
+        if (!ret.second) {
+            ret.first->second = value;
+            coalesced_++;
+        }
+        flush = pending_.size() >= max_pending_;
+    }
+    if (flush) {
+        Flush();
+    }
+}
+
+void UVEUpdateCoalescer::Flush() {
+    tbb::mutex::scoped_lock flush_lock(flush_mutex_);
+    UpdateMap updates;
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        updates.swap(pending_);
+    }
+    if (updates.empty()) {
+        return;
+    }
+    for (UpdateMap::const_iterator it = updates.begin();
+         it != updates.end(); ++it) {
+        send_fn_(it->first, it->second);
+    }
+    flushed_++;
+}
+
+void UVEUpdateCoalescer::PurgeLocked(const string &source,
+        const string &node_type, const string &module,
+        const string &instance_id, const string &key, const string &type) {
+    UpdateMap::iterator it = pending_.lower_bound(
+        Key(source, node_type, module, instance_id, key, type, ""));
+    while (it != pending_.end()) {
+        const Key &ukey = it->first;
+        if (ukey.source != source || ukey.node_type != node_type ||
+            ukey.module != module || ukey.instance_id != instance_id) {
+            break;
+        }
+        if (!key.empty() && (ukey.key != key || ukey.type != type)) {
+            break;
+        }
+        pending_.erase(it++);
+        coalesced_++;
+    }
+}
+
+bool UVEUpdateCoalescer::Delete(const string &source, const string &node_type,
+        const string &module, const string &instance_id, const string &key,
+        const string &type, DeleteFn delete_fn) {
+    tbb::mutex::scoped_lock flush_lock(flush_mutex_);
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        PurgeLocked(source, node_type, module, instance_id, key, type);
+    }
+    return delete_fn();
+}
+
+size_t UVEUpdateCoalescer::pending() const {
+    tbb::mutex::scoped_lock lock(mutex_);
+    return pending_.size();
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ANALYTICS_UVE_UPDATE_COALESCER_H_
+#define ANALYTICS_UVE_UPDATE_COALESCER_H_
+
+#include <map>
+#include <string>
+
+#include <boost/function.hpp>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+
+//
+// Holds the latest value of each UVE attribute between flushes, so that an
+// attribute that is updated several times within a flush interval costs a
+// single redis update.
+//
+// Aggregates that accumulate history in redis ("stats" and histogram bins)
+// must see every sample and are never held; the caller sends them directly.
+//
+// The pending map is swapped out under mutex_ and sent without it, so the
+// updaters are not serialized behind redis. flush_mutex_ orders the sends
+// of a flush against deletes, so that a flush can not resurrect a UVE that
+// is deleted while it is in progress.
+//
+class UVEUpdateCoalescer {
+public:
+    // Identifies a single UVE attribute of a generator.
+    struct Key {
+        Key(const std::string &source, const std::string &node_type,
+            const std::string &module, const std::string &instance_id,
+            const std::string &key, const std::string &type,
+            const std::string &attr);
+        int CompareTo(const Key &rhs) const;
+        bool operator<(const Key &rhs) const {
+            return CompareTo(rhs) < 0;
+        }
+
+        std::string source;
+        std::string node_type;
+        std::string module;
+        std::string instance_id;
+        std::string key;
+        std::string type;
+        std::string attr;
+    };
+
+    struct Value {
+        Value(const std::string &message, int32_t seq, const std::string &agg,
+              const std::string &atyp, int64_t ts) :
+            message(message), seq(seq), agg(agg), atyp(atyp), ts(ts) {
+        }
+
+        std::string message;
+        int32_t seq;
+        std::string agg;
+        std::string atyp;
+        int64_t ts;
+    };
+
+    typedef boost::function<bool(const Key &, const Value &)> SendFn;
+    typedef boost::function<bool(void)> DeleteFn;
+
+    static const size_t kMaxPending = 16 * 1024;
+
+    explicit UVEUpdateCoalescer(SendFn send_fn,
+                                size_t max_pending = kMaxPending);
+
+    static bool IsCoalescable(const Value &value) {
+        return value.agg != "stats" && value.atyp.empty();
+    }
+
+    // Holds a coalescable update until the next flush. Flushes inline when
+    // max_pending updates are held.
+    void Update(const Key &key, const Value &value);
+
+    // Sends the held updates.
+    void Flush();
+
+    // Drops the held updates of the UVE, or of all the UVEs of the generator
+    // when key is empty, and runs delete_fn before any later flush sends.
+    bool Delete(const std::string &source, const std::string &node_type,
+                const std::string &module, const std::string &instance_id,
+                const std::string &key, const std::string &type,
+                DeleteFn delete_fn);
+
+    size_t pending() const;
+    uint64_t coalesced() const { return coalesced_; }
+    uint64_t flushed() const { return flushed_; }
+
+private:
+    typedef std::map<Key, Value> UpdateMap;
+
+    void PurgeLocked(const std::string &source, const std::string &node_type,
+                     const std::string &module, const std::string &instance_id,
+                     const std::string &key, const std::string &type);
+
+    SendFn send_fn_;
+    size_t max_pending_;
+    mutable tbb::mutex mutex_;
+    tbb::mutex flush_mutex_;
+    UpdateMap pending_;
+    tbb::atomic<uint64_t> coalesced_;
+    tbb::atomic<uint64_t> flushed_;
+};
+
+#endif  // ANALYTICS_UVE_UPDATE_COALESCER_H_
@@ -5,6 +5,7 @@
 #include "base/bitset.h"
 #include "base/util.h"
 
+#include <algorithm>
 #include <cassert>
 #include <sstream>
 #include <string>
@@ -17,56 +18,16 @@ using namespace std;
 // on all platforms. Note that the positions are numbered 1 through 64, with
 // a return value of 0 indicating that there are no set bits.
 //
-static int find_first_set64(uint64_t value) {
-    int bit;
-
-    int lower = value;
-    if ((bit = ffs(lower)) > 0)
-        return bit;
-
-    int upper = value >> 32;
-    if ((bit = ffs(upper)) > 0)
-        return 32 + bit;
-
-    return 0;
-}
-
-static int find_first_clear64(uint64_t value) {
-    return find_first_set64(~value);
-}
-
-//
-// Provides the same functionality as fls.  Needed as fls is not supported
-// on all platforms. Note that the positions are numbered 1 through 32, with
-// a return value of 0 indicating that there are no set bits.
+// The compiler builtin turns into a single bit scan instruction.
 //
-static int find_last_set32(uint32_t value) {
+static inline int find_first_set64(uint64_t value) {
     if (value == 0)
         return 0;
+    return __builtin_ctzll(value) + 1;
+}
 
-    int bit = 32;
-    if ((value & 0xFFFF0000U) == 0) {
-        value <<= 16;
-        bit -= 16;
-    }
-    if ((value & 0xFF000000U) == 0) {
-        value <<= 8;
-        bit -= 8;
-    }
-    if ((value & 0xF0000000U) == 0) {
-        value <<= 4;
-        bit -= 4;
-    }
-    if ((value & 0xC0000000U) == 0) {
-        value <<= 2;
-        bit -= 2;
-    }
-    if ((value & 0x80000000U) == 0) {
-        value <<= 1;
-        bit -= 1;
-    }
-
-    return bit;
+static inline int find_first_clear64(uint64_t value) {
+    return find_first_set64(~value);
 }
 
 //
@@ -74,34 +35,22 @@ static int find_last_set32(uint32_t value) {
 // on all platforms. Note that the positions are numbered 1 through 64, with
 // a return value of 0 indicating that there are no set bits.
 //
-static int find_last_set64(uint64_t value) {
-    int bit;
-
-    int upper = value >> 32;
-    if ((bit = find_last_set32(upper)) > 0)
-        return 32 + bit;
-
-    int lower = value;
-    if ((bit = find_last_set32(lower)) > 0)
-        return bit;
-
-    return 0;
+static inline int find_last_set64(uint64_t value) {
+    if (value == 0)
+        return 0;
+    return 64 - __builtin_clzll(value);
 }
 
 //
-// Return the number of set bits. K&R method.
+// Return the number of set bits.  The builtin uses the popcnt instruction
+// when the target supports it and a table free bit twiddle otherwise.
 //
-static int num_bits_set(uint64_t value) {
-    int count = 0;
-    while (value != 0) {
-        value &= value - 1;
-        count++;
-    }
-    return count;
+static inline int num_bits_set(uint64_t value) {
+    return __builtin_popcountll(value);
 }
 
 // Position pos is w.r.t the entire bitset, starts at 0.
-// Index    idx is the block number i.e. the index in the vector, starts at 0.
+// Index    idx is the block number i.e. the index in the array, starts at 0.
 // Offset   offset is w.r.t a given 64 bit block, starts at 0.
 static inline size_t block_index(size_t pos) {
     return pos / 64;
@@ -116,25 +65,73 @@ static inline size_t bit_position(size_t idx, size_t offset) {
 }
 
 const size_t BitSet::npos;
+const uint32_t BitSet::kInlineBlocks;
+
+BitSet::BitSet() : size_(0), capacity_(kInlineBlocks) {
+}
 
 //
-// Set bit at given position, growing the vector if needed.
+// Allocate only as many blocks as are in use in rhs. A small copy of a
+// bitset that used to be large stays inline.
+//
+BitSet::BitSet(const BitSet &rhs) : size_(0), capacity_(kInlineBlocks) {
+    resize(rhs.size_);
+    memcpy(blocks(), rhs.blocks(), rhs.size_ * sizeof(uint64_t));
+}
+
+BitSet::~BitSet() {
+    if (!is_inline())
+        delete [] storage_.heap_;
+}
+
+BitSet &BitSet::operator=(const BitSet &rhs) {
+    if (this == &rhs)
+        return *this;
+    size_ = 0;
+    resize(rhs.size_);
+    memcpy(blocks(), rhs.blocks(), rhs.size_ * sizeof(uint64_t));
+    return *this;
+}
+
+//
+// Change the number of blocks in use.  New blocks are always zeroed. The
+// storage is never shrunk, same as with a vector, so a bitset that keeps
+// growing and shrinking does not reallocate every time.
+//
+void BitSet::resize(size_t size) {
+    if (size > capacity_) {
+        uint32_t capacity = std::max(size, 2 * (size_t) capacity_);
+        uint64_t *heap = new uint64_t[capacity];
+        memcpy(heap, blocks(), size_ * sizeof(uint64_t));
+        if (!is_inline())
+            delete [] storage_.heap_;
+        storage_.heap_ = heap;
+        capacity_ = capacity;
+    }
+    if (size > size_) {
+        memset(blocks() + size_, 0, (size - size_) * sizeof(uint64_t));
+    }
+    size_ = size;
+}
+
+//
+// Set bit at given position, growing the storage if needed.
 //
 BitSet &BitSet::set(size_t pos) {
     size_t idx = block_index(pos);
-    if (idx >= blocks_.size())
-        blocks_.resize(idx + 1);
-    blocks_[idx] |= 1LL << block_offset(pos);
+    if (idx >= size_)
+        resize(idx + 1);
+    blocks()[idx] |= 1LL << block_offset(pos);
     return *this;
 }
 
 //
-// Reset bit at given position, shrinking the vector if possible.
+// Reset bit at given position, shrinking the bitset if possible.
 //
 BitSet &BitSet::reset(size_t pos) {
     size_t idx = block_index(pos);
-    if (idx < blocks_.size()) {
-        blocks_[idx] &= ~(1LL << block_offset(pos));
+    if (idx < size_) {
+        blocks()[idx] &= ~(1LL << block_offset(pos));
         compact();
     }
     return *this;
@@ -143,8 +140,8 @@ BitSet &BitSet::reset(size_t pos) {
 // Test bit at given position.
 bool BitSet::test(size_t pos) const {
     size_t idx = block_index(pos);
-    if (idx < blocks_.size()) {
-        return ((blocks_[idx] & (1LL << block_offset(pos))) != 0);
+    if (idx < size_) {
+        return ((blocks()[idx] & (1LL << block_offset(pos))) != 0);
     } else {
         return false;
     }
@@ -154,73 +151,59 @@ bool BitSet::test(size_t pos) const {
 // Shortcut to reset all bits in the bitset.
 //
 void BitSet::clear() {
-    blocks_.resize(0);
+    size_ = 0;
 }
 
 //
 // Return true if there are no bits in the bitset.
 //
 bool BitSet::empty() const {
-    return (blocks_.size() == 0);
+    return (size_ == 0);
 }
 
 //
 // Return true if no bits are set.
 //
 bool BitSet::none() const {
-    return (blocks_.size() == 0);
+    return (size_ == 0);
 }
 
 //
 // Return true at least one bit is set.
 //
 bool BitSet::any() const {
-    return (blocks_.size() != 0);
+    return (size_ != 0);
 }
 
 //
 // Return the raw number of bits in the bitset. Simply depends on the number
-// of blocks in the vector.
+// of blocks in use.
 //
 size_t BitSet::size() const {
-    return blocks_.size() * 64;
+    return size_ * 64;
 }
 
 //
 // Return total number of set bits.
 //
 size_t BitSet::count() const {
+    const uint64_t *data = blocks();
     size_t count = 0;
-    for (size_t idx = 0; idx < blocks_.size(); idx++) {
-        count += num_bits_set(blocks_[idx]);
+    for (size_t idx = 0; idx < size_; idx++) {
+        count += num_bits_set(data[idx]);
     }
     return count;
 }
 
 //
-// Shrink the underlying vector as much as possible.  All trailing blocks
-// that are 0 can be removed.
-//
-// Note that the for loop does not handle idx 0 since the loop  variable
-// is unsigned.
+// Shrink the bitset as much as possible.  All trailing blocks that are 0
+// can be removed.
 //
 void BitSet::compact() {
-    if (blocks_.size() == 0)
-        return;
-
-    for (size_t idx = blocks_.size() - 1; idx > 0; idx--) {
-        if (blocks_[idx] != 0) {
-            blocks_.resize(idx + 1);
-            return;
-        }
+    const uint64_t *data = blocks();
+    while (size_ > 0 && data[size_ - 1] == 0) {
+        size_--;
     }
-
-    if (blocks_[0] != 0) {
-        blocks_.resize(1);
-        return;
-    }
-
-    blocks_.clear();
 }
 
 //
@@ -228,9 +211,8 @@ void BitSet::compact() {
 // after any compaction is done or in cases where no compaction is needed.
 //
 void BitSet::check_invariants() {
-    size_t mysize = blocks_.size();
-    if (mysize != 0)
-        assert(blocks_[mysize -1] != 0);
+    if (size_ != 0)
+        assert(blocks()[size_ - 1] != 0);
 }
 
 //
@@ -238,8 +220,9 @@ void BitSet::check_invariants() {
 // return value convention used by find_first_set64.
 //
 size_t BitSet::find_first() const {
-    for (size_t idx = 0; idx < blocks_.size(); idx++) {
-        int bit = find_first_set64(blocks_[idx]);
+    const uint64_t *data = blocks();
+    for (size_t idx = 0; idx < size_; idx++) {
+        int bit = find_first_set64(data[idx]);
         if (bit > 0)
             return bit_position(idx, bit - 1);
     }
@@ -251,16 +234,17 @@ size_t BitSet::find_first() const {
 // return value convention used by find_first_set64.
 //
 size_t BitSet::find_next(size_t pos) const {
+    const uint64_t *data = blocks();
     size_t idx = block_index(pos);
 
-    // If the block index is beyond the vector, we're done.
-    if (idx >= blocks_.size())
+    // If the block index is beyond the bitset, we're done.
+    if (idx >= size_)
         return BitSet::npos;
 
     // If the offset is not 63, clear out the bits from 0 through offset
     // and look for the first set bit.
     if (block_offset(pos) < 63) {
-        uint64_t temp = blocks_[idx] & ~((1LL << (block_offset(pos) + 1)) - 1);
+        uint64_t temp = data[idx] & ~((1LL << (block_offset(pos) + 1)) - 1);
         int bit = find_first_set64(temp);
         if (bit > 0)
             return bit_position(idx, bit - 1);
@@ -268,8 +252,8 @@ size_t BitSet::find_next(size_t pos) const {
 
     // Go through all blocks after the start block for the pos and see if
     // there's a set bit.
-    for (idx++; idx < blocks_.size(); idx++) {
-        int bit = find_first_set64(blocks_[idx]);
+    for (idx++; idx < size_; idx++) {
+        int bit = find_first_set64(data[idx]);
         if (bit > 0)
             return bit_position(idx, bit - 1);
     }
@@ -284,11 +268,11 @@ size_t BitSet::find_next(size_t pos) const {
 // at least one bit set.
 //
 size_t BitSet::find_last() const {
-    if (blocks_.size() == 0)
+    if (size_ == 0)
         return BitSet::npos;
 
-    size_t idx = blocks_.size() - 1;
-    int bit = find_last_set64(blocks_[idx]);
+    size_t idx = size_ - 1;
+    int bit = find_last_set64(blocks()[idx]);
     if (bit > 0)
         return bit_position(idx, bit - 1);
 
@@ -297,14 +281,15 @@ size_t BitSet::find_last() const {
 
 //
 // Return the position of the first clear bit.  It could be beyond the last
-// block in the vector. This is fine as we automatically grow the vector if
-// needed from set().
+// block in use. This is fine as we automatically grow the bitset if needed
+// from set().
 //
 // Need to compensate for return value convention used by find_first_clear64.
 //
 size_t BitSet::find_first_clear() const {
-    for (size_t idx = 0; idx < blocks_.size(); idx++) {
-        int bit = find_first_clear64(blocks_[idx]);
+    const uint64_t *data = blocks();
+    for (size_t idx = 0; idx < size_; idx++) {
+        int bit = find_first_clear64(data[idx]);
         if (bit > 0) {
             return bit_position(idx, bit - 1);
         }
@@ -314,22 +299,23 @@ size_t BitSet::find_first_clear() const {
 
 //
 // Return the position of the next clear bit.  It could be beyond the last
-// block in the vector. This is fine as we automatically grow the vector if
-// needed from set().
+// block in use. This is fine as we automatically grow the bitset if needed
+// from set().
 //
 // Need to compensate for return value convention used by find_first_clear64.
 //
 size_t BitSet::find_next_clear(size_t pos) const {
+    const uint64_t *data = blocks();
     size_t idx = block_index(pos);
 
-    // If the block index is beyond the vector, we're done.
-    if (idx >= blocks_.size())
+    // If the block index is beyond the bitset, we're done.
+    if (idx >= size_)
         return pos + 1;
 
     // If the offset is not 63, set all the bits from 0 through offset and
     // look for the first clear bit.
     if (block_offset(pos) < 63) {
-        uint64_t temp = blocks_[idx] | ((1LL << (block_offset(pos) + 1)) - 1);
+        uint64_t temp = data[idx] | ((1LL << (block_offset(pos) + 1)) - 1);
         int bit = find_first_clear64(temp);
         if (bit > 0)
             return bit_position(idx, bit - 1);
@@ -337,8 +323,8 @@ size_t BitSet::find_next_clear(size_t pos) const {
 
     // Go through all blocks after the start block for the pos and see if
     // there's a clear bit.
-    for (idx++; idx < blocks_.size(); idx++) {
-        int bit = find_first_clear64(blocks_[idx]);
+    for (idx++; idx < size_; idx++) {
+        int bit = find_first_clear64(data[idx]);
         if (bit > 0) {
             return bit_position(idx, bit - 1);
         }
@@ -350,9 +336,11 @@ size_t BitSet::find_next_clear(size_t pos) const {
 // Return (*this & rhs != 0).
 //
 bool BitSet::intersects(const BitSet &rhs) const {
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
+    const uint64_t *data = blocks();
+    const uint64_t *rhs_data = rhs.blocks();
+    size_t minsize = std::min(size_, rhs.size_);
     for (size_t idx = 0; idx < minsize; idx++) {
-        if (blocks_[idx] & rhs.blocks_[idx])
+        if (data[idx] & rhs_data[idx])
             return true;
     }
     return false;
@@ -361,17 +349,13 @@ bool BitSet::intersects(const BitSet &rhs) const {
 //
 // Return (*this == rhs).
 //
-// Note that it's fine to first compare the number of blocks in the vectors
-// since we always shrink the vectors whenever possible.
+// Note that it's fine to first compare the number of blocks since we always
+// shrink the bitsets whenever possible.
 //
 bool BitSet::operator==(const BitSet &rhs) const {
-    if (blocks_.size() != rhs.blocks_.size())
+    if (size_ != rhs.size_)
         return false;
-    for (size_t idx = 0; idx < blocks_.size(); idx++) {
-        if (blocks_[idx] != rhs.blocks_[idx])
-            return false;
-    }
-    return true;
+    return (memcmp(blocks(), rhs.blocks(), size_ * sizeof(uint64_t)) == 0);
 }
 
 //
@@ -395,44 +379,27 @@ BitSet BitSet::operator&(const BitSet &rhs) const {
 // Return (*this | rhs).
 //
 BitSet BitSet::operator|(const BitSet &rhs) const {
-    BitSet temp;
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
-    size_t maxsize = std::max(blocks_.size(), rhs.blocks_.size());
-    temp.blocks_.resize(maxsize);
-
-    // Process common blocks.
-    for (size_t idx = 0; idx < minsize; idx++) {
-        temp.blocks_[idx] = blocks_[idx] | rhs.blocks_[idx];
-    }
-
-    // Process blocks that exist in LHS only. It's a noop if RHS is bigger.
-    for (size_t idx = minsize; idx < blocks_.size(); idx++) {
-        temp.blocks_[idx] = blocks_[idx];
-    }
-
-    // Process blocks that exist in RHS only. It's a noop if LHS is bigger.
-    for (size_t idx = minsize; idx < rhs.blocks_.size(); idx++) {
-        temp.blocks_[idx] = rhs.blocks_[idx];
-    }
-
-    temp.check_invariants();
+    const BitSet &large = (size_ >= rhs.size_) ? *this : rhs;
+    const BitSet &small = (size_ >= rhs.size_) ? rhs : *this;
+    BitSet temp(large);
+    temp |= small;
     return temp;
 }
 
 //
 // Implement (*this &= rhs).
 //
-// Note that we can't simply resize the vector to minsize since we may be
-// able to shrink it even more depending on the values in the blocks.
+// Note that we can't simply shrink to minsize since we may be able to shrink
+// even more depending on the values in the blocks.
 //
 BitSet &BitSet::operator&=(const BitSet &rhs) {
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
+    uint64_t *data = blocks();
+    const uint64_t *rhs_data = rhs.blocks();
+    size_t minsize = std::min(size_, rhs.size_);
     for (size_t idx = 0; idx < minsize; idx++) {
-        blocks_[idx] &= rhs.blocks_[idx];
-    }
-    for (size_t idx = minsize; idx < blocks_.size(); idx++) {
-        blocks_[idx] = 0;
+        data[idx] &= rhs_data[idx];
     }
+    size_ = minsize;
     compact();
     check_invariants();
     return *this;
@@ -441,14 +408,16 @@ BitSet &BitSet::operator&=(const BitSet &rhs) {
 //
 // Implement (*this |= rhs).
 //
-// Note that we grow the vector only once instead of doing it multiple
+// Note that we grow the bitset only once instead of doing it multiple
 // times.
 //
 BitSet &BitSet::operator|=(const BitSet &rhs) {
-    if (blocks_.size() < rhs.blocks_.size())
-        blocks_.resize(rhs.blocks_.size());
-    for (size_t idx = 0; idx < rhs.blocks_.size(); idx++) {
-        blocks_[idx] |= rhs.blocks_[idx];
+    if (size_ < rhs.size_)
+        resize(rhs.size_);
+    uint64_t *data = blocks();
+    const uint64_t *rhs_data = rhs.blocks();
+    for (size_t idx = 0; idx < rhs.size_; idx++) {
+        data[idx] |= rhs_data[idx];
     }
     check_invariants();
     return *this;
@@ -466,9 +435,11 @@ void BitSet::Set(const BitSet &rhs) {
 // Implement (*this &= ~rhs).
 //
 void BitSet::Reset(const BitSet &rhs) {
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
+    uint64_t *data = blocks();
+    const uint64_t *rhs_data = rhs.blocks();
+    size_t minsize = std::min(size_, rhs.size_);
     for (size_t idx = 0; idx < minsize; idx++) {
-        blocks_[idx] &= ~rhs.blocks_[idx];
+        data[idx] &= ~rhs_data[idx];
     }
     compact();
     check_invariants();
@@ -481,15 +452,20 @@ void BitSet::Reset(const BitSet &rhs) {
 // than rhs.  Need to compact only for this case, but it is cheap enough to
 // try (and do nothing) when lhs is bigger than rhs.
 //
+// The result is built in place, so lhs and rhs must not be *this.
+//
 void BitSet::BuildComplement(const BitSet &lhs, const BitSet &rhs) {
-    blocks_.clear();
-    blocks_.resize(lhs.blocks_.size());
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
+    size_ = 0;
+    resize(lhs.size_);
+    uint64_t *data = blocks();
+    const uint64_t *lhs_data = lhs.blocks();
+    const uint64_t *rhs_data = rhs.blocks();
+    size_t minsize = std::min(size_, rhs.size_);
     for (size_t idx = 0; idx < minsize; idx++) {
-        blocks_[idx] = lhs.blocks_[idx] & ~rhs.blocks_[idx];
+        data[idx] = lhs_data[idx] & ~rhs_data[idx];
     }
-    for (size_t idx = minsize; idx < lhs.blocks_.size(); idx++) {
-        blocks_[idx] = lhs.blocks_[idx];
+    for (size_t idx = minsize; idx < lhs.size_; idx++) {
+        data[idx] = lhs_data[idx];
     }
     compact();
     check_invariants();
@@ -498,33 +474,19 @@ void BitSet::BuildComplement(const BitSet &lhs, const BitSet &rhs) {
 //
 // Implement (*this = lhs & rhs).
 //
-// We avoid the need to compact or to resize multiple times by building
-// the blocks in reverse order.
-//
-// Note that the for loop does not handle idx 0 since the loop  variable
-// is unsigned.
+// The result is built in place, so lhs and rhs must not be *this.
 //
 void BitSet::BuildIntersection(const BitSet &lhs, const BitSet &rhs) {
-    blocks_.clear();
-    size_t minsize = std::min(lhs.blocks_.size(), rhs.blocks_.size());
-
-    if (minsize == 0)
-        return;
-
-    for (size_t idx = minsize - 1; idx > 0; idx--) {
-        if (lhs.blocks_[idx] & rhs.blocks_[idx]) {
-            if (blocks_.size() == 0)
-                blocks_.resize(idx + 1);
-            blocks_[idx] = lhs.blocks_[idx] & rhs.blocks_[idx];
-        }
-    }
-
-    if (lhs.blocks_[0] & rhs.blocks_[0]) {
-        if (blocks_.size() == 0)
-            blocks_.resize(1);
-        blocks_[0] = lhs.blocks_[0] & rhs.blocks_[0];
+    size_ = 0;
+    size_t minsize = std::min(lhs.size_, rhs.size_);
+    resize(minsize);
+    uint64_t *data = blocks();
+    const uint64_t *lhs_data = lhs.blocks();
+    const uint64_t *rhs_data = rhs.blocks();
+    for (size_t idx = 0; idx < minsize; idx++) {
+        data[idx] = lhs_data[idx] & rhs_data[idx];
     }
-
+    compact();
     check_invariants();
 }
 
@@ -532,10 +494,12 @@ void BitSet::BuildIntersection(const BitSet &lhs, const BitSet &rhs) {
 // Return true if *this contains rhs.  Implemented as (rhs & ~*this != 0).
 //
 bool BitSet::Contains(const BitSet &rhs) const {
-    if (blocks_.size() < rhs.blocks_.size())
+    if (size_ < rhs.size_)
         return false;
-    for (size_t idx = 0; idx < rhs.blocks_.size(); idx++) {
-        if (rhs.blocks_[idx] & ~blocks_[idx])
+    const uint64_t *data = blocks();
+    const uint64_t *rhs_data = rhs.blocks();
+    for (size_t idx = 0; idx < rhs.size_; idx++) {
+        if (rhs_data[idx] & ~data[idx])
             return false;
     }
     return true;
@@ -568,7 +532,7 @@ string BitSet::ToString() const {
 // is unsigned.
 //
 void BitSet::FromString(string str) {
-    blocks_.clear();
+    clear();
 
     if (str.length() == 0)
         return;
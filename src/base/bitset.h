@@ -7,17 +7,26 @@
 
 #include <inttypes.h>
 #include <string>
-#include <vector>
 
 //
 // BitSet automatically resizes the bit set when needed and allows for
 // logical operations between bitsets of different sizes.  Implemented
-// using a vector of uint64_t as the underlying storage.
+// using an array of uint64_t blocks as the underlying storage.
+//
+// Most bitsets have only a few bits set, so the first kInlineBlocks blocks
+// are stored inline in the object itself.  The storage moves to the heap
+// only when a bit beyond that is set.  Copies of small bitsets therefore
+// never allocate, and the object is no bigger than a std::vector.
 //
 class BitSet {
 public:
     static const size_t npos = static_cast<size_t>(-1);
 
+    BitSet();
+    BitSet(const BitSet &rhs);
+    ~BitSet();
+    BitSet &operator=(const BitSet &rhs);
+
     BitSet &set(size_t pos);
     BitSet &reset(size_t pos);
     bool test(size_t pos) const;
@@ -53,10 +62,25 @@ public:
 private:
     friend class BitSetTest;
 
+    static const uint32_t kInlineBlocks = 2;
+
+    bool is_inline() const { return capacity_ == kInlineBlocks; }
+    uint64_t *blocks() {
+        return is_inline() ? storage_.inline_ : storage_.heap_;
+    }
+    const uint64_t *blocks() const {
+        return is_inline() ? storage_.inline_ : storage_.heap_;
+    }
+    void resize(size_t size);
     void compact();
     void check_invariants();
 
-    std::vector<uint64_t> blocks_;
+    union {
+        uint64_t inline_[kInlineBlocks];
+        uint64_t *heap_;
+    } storage_;
+    uint32_t size_;
+    uint32_t capacity_;
 };
 
 #endif
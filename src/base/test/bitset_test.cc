@@ -10,8 +10,24 @@ using namespace std;
 
 class BitSetTest : public ::testing::Test {
 protected:
-    vector<uint64_t> &get_blocks(BitSet &bitset) {
-        return bitset.blocks_;
+    // Live view of the blocks in use in a bitset.
+    class Blocks {
+    public:
+        explicit Blocks(const BitSet &bitset) : bitset_(bitset) { }
+        size_t size() const { return bitset_.size_; }
+        uint64_t operator[](size_t idx) const {
+            return bitset_.blocks()[idx];
+        }
+    private:
+        const BitSet &bitset_;
+    };
+
+    Blocks get_blocks(const BitSet &bitset) {
+        return Blocks(bitset);
+    }
+
+    bool is_inline(const BitSet &bitset) {
+        return bitset.is_inline();
     }
 };
 
@@ -26,7 +42,7 @@ static int num_bits_set(uint64_t value) {
 
 TEST_F(BitSetTest, Basic) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    Blocks blocks = get_blocks(bitset);
     EXPECT_EQ(bitset.size(), 0);
     EXPECT_EQ(blocks.size(), 0);
 }
@@ -35,7 +51,7 @@ TEST_F(BitSetTest, Basic) {
 TEST_F(BitSetTest, set1) {
     for (int pos = 0; pos <= 63; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        Blocks blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 1);
         EXPECT_EQ(blocks[0],  1LL << pos);
@@ -47,7 +63,7 @@ TEST_F(BitSetTest, set1) {
 TEST_F(BitSetTest, set2) {
     for (int pos = 128; pos <= 191; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        Blocks blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 3);
         EXPECT_EQ(blocks[0], 0 );
@@ -61,7 +77,7 @@ TEST_F(BitSetTest, set2) {
 TEST_F(BitSetTest, set3)  {
     for (int pos = 0; pos <= 1023; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        Blocks blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), pos / 64 + 1);
         EXPECT_EQ(blocks[pos / 64], 1LL << (pos % 64));
@@ -72,7 +88,7 @@ TEST_F(BitSetTest, set3)  {
 // Set all bits within block idx 1 and verify.
 TEST_F(BitSetTest, set4) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    Blocks blocks = get_blocks(bitset);
     for (int pos = 64; pos <= 127; pos++) {
         bitset.set(pos);
     }
@@ -85,7 +101,7 @@ TEST_F(BitSetTest, set4) {
 TEST_F(BitSetTest, reset1) {
     for (int pos = 0; pos <= 63; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        Blocks blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 1);
         bitset.reset(pos);
@@ -97,7 +113,7 @@ TEST_F(BitSetTest, reset1) {
 TEST_F(BitSetTest, reset2) {
     for (int pos = 64; pos <= 127; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        Blocks blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 2);
         bitset.reset(pos);
@@ -109,7 +125,7 @@ TEST_F(BitSetTest, reset2) {
 TEST_F(BitSetTest, reset3) {
     for (int pos = 0; pos <= 1023; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        Blocks blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), pos / 64 + 1);
         bitset.reset(pos);
@@ -121,7 +137,7 @@ TEST_F(BitSetTest, reset3) {
 TEST_F(BitSetTest, reset4)  {
     for (int pos = 64; pos <= 127; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        Blocks blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 2);
         bitset.reset(128);
@@ -133,7 +149,7 @@ TEST_F(BitSetTest, reset4)  {
 //  Set bits 0-127 and reset 0-63.
 TEST_F(BitSetTest, reset5) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    Blocks blocks = get_blocks(bitset);
     for (int pos = 0; pos <= 127; pos++) {
         bitset.set(pos);
     }
@@ -150,7 +166,7 @@ TEST_F(BitSetTest, reset5) {
 //  Set bits 0-127 and reset 64-127.
 TEST_F(BitSetTest, reset6) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    Blocks blocks = get_blocks(bitset);
     for (int pos = 0; pos <= 127; pos++) {
         bitset.set(pos);
     }
@@ -169,7 +185,7 @@ TEST_F(BitSetTest, reset6) {
 // Clear an empty BitSet.
 TEST_F(BitSetTest, clear1) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    Blocks blocks = get_blocks(bitset);
     bitset.clear();
     EXPECT_EQ(blocks.size(), 0);
 }
@@ -178,7 +194,7 @@ TEST_F(BitSetTest, clear1) {
 // Clear BitSet with first/last bit set in each idx.
 TEST_F(BitSetTest, clear2) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    Blocks blocks = get_blocks(bitset);
 
     for (int idx = 0; idx < 32; idx++) {
         bitset.set(idx * 64);
@@ -198,7 +214,7 @@ TEST_F(BitSetTest, clear2) {
 // Clear BitSet with all bits set in idx 0 thru 15.
 TEST_F(BitSetTest, clear3) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    Blocks blocks = get_blocks(bitset);
     for (int pos = 0; pos < 64 * 16 ; pos++) {
         bitset.set(pos);
     }
@@ -1913,6 +1929,93 @@ TEST_F(BitSetTest, NumberedString2) {
     EXPECT_EQ("1,3-5,7-9", bitset.ToNumberedString());
 }
 
+// Bitsets with up to 128 bits use the inline storage. Copies allocate only
+// as much as they need.
+TEST_F(BitSetTest, InlineStorage) {
+    BitSet bitset;
+    EXPECT_TRUE(is_inline(bitset));
+    bitset.set(0);
+    bitset.set(127);
+    EXPECT_TRUE(is_inline(bitset));
+    bitset.set(128);
+    EXPECT_FALSE(is_inline(bitset));
+    EXPECT_EQ(3, get_blocks(bitset).size());
+
+    BitSet large(bitset);
+    EXPECT_FALSE(is_inline(large));
+    EXPECT_EQ(bitset, large);
+
+    bitset.reset(128);
+    EXPECT_FALSE(is_inline(bitset));
+    EXPECT_EQ(2, get_blocks(bitset).size());
+    BitSet small(bitset);
+    EXPECT_TRUE(is_inline(small));
+    EXPECT_EQ(bitset, small);
+    EXPECT_EQ(0, small.find_first());
+    EXPECT_EQ(127, small.find_last());
+
+    // Assign large to small and back again.
+    small = large;
+    EXPECT_FALSE(is_inline(small));
+    EXPECT_EQ(large, small);
+    EXPECT_EQ(128, small.find_last());
+    large = bitset;
+    EXPECT_EQ(bitset, large);
+    EXPECT_EQ(127, large.find_last());
+    large = large;
+    EXPECT_EQ(bitset, large);
+
+    // Blocks given up by a clear are zero when the bitset grows again.
+    large.clear();
+    large.set(191);
+    EXPECT_EQ(3, get_blocks(large).size());
+    EXPECT_EQ(0, get_blocks(large)[0]);
+    EXPECT_EQ(0, get_blocks(large)[1]);
+    EXPECT_EQ(1, large.count());
+    EXPECT_EQ(191, large.find_first());
+}
+
+// Copy and combine small bitsets, as done for peer and client sets.
+TEST_F(BitSetTest, DISABLED_PerfSmall) {
+    BitSet lhs, rhs;
+    for (int pos = 0; pos < 128; pos += 3) {
+        lhs.set(pos);
+    }
+    for (int pos = 0; pos < 128; pos += 5) {
+        rhs.set(pos);
+    }
+    size_t total = 0;
+    for (int i = 0; i < 10000000; i++) {
+        BitSet temp(lhs);
+        temp |= rhs;
+        temp.Reset(lhs & rhs);
+        total += temp.count();
+    }
+    LOG(DEBUG, "Total " << total);
+}
+
+// Combine and iterate over large bitsets.
+TEST_F(BitSetTest, DISABLED_PerfLarge) {
+    BitSet lhs, rhs;
+    for (int pos = 0; pos < 4096; pos += 3) {
+        lhs.set(pos);
+    }
+    for (int pos = 0; pos < 4096; pos += 5) {
+        rhs.set(pos);
+    }
+    size_t total = 0;
+    for (int i = 0; i < 100000; i++) {
+        BitSet temp;
+        temp.BuildComplement(lhs, rhs);
+        total += temp.intersects(rhs) + temp.Contains(lhs);
+        for (size_t pos = temp.find_first(); pos != BitSet::npos;
+             pos = temp.find_next(pos)) {
+            total++;
+        }
+    }
+    LOG(DEBUG, "Total " << total);
+}
+
 int main(int argc, char **argv) {
     LoggingInit();
     ::testing::InitGoogleTest(&argc, argv);
@@ -323,6 +323,74 @@ TEST_F(TimerUT, reschedule_2) {
     EXPECT_TRUE(TimerManager::DeleteTimer(timer2));
 }
 
+struct TimerExpiry {
+    TimerExpiry() : start(0), time(0), elapsed(0) { }
+    uint64_t start;
+    int time;
+    uint64_t elapsed;
+};
+
+bool TimerCbElapsed(TimerExpiry *expiry) {
+    expiry->elapsed = UTCTimestampUsec() - expiry->start;
+    timer_count_.fetch_and_increment();
+    return false;
+}
+
+// Timers that are added to the upper levels of the timer wheel fire after
+// they are moved down, and never early.
+TEST_F(TimerUT, wheel_levels) {
+    static const int kTimers = 24;
+    TimerTest *timers[kTimers];
+    TimerExpiry expiry[kTimers];
+    for (int i = 0; i < kTimers; i++) {
+        timers[i] = new TimerTest(*evm_->io_service(), "Wheel");
+        expiry[i].start = UTCTimestampUsec();
+        expiry[i].time = 5 + i * 53;
+        timers[i]->Start(expiry[i].time,
+                         boost::bind(&TimerCbElapsed, &expiry[i]));
+    }
+    TASK_UTIL_EXPECT_EQ(kTimers, timer_count_);
+    for (int i = 0; i < kTimers; i++) {
+        EXPECT_LE(expiry[i].time * 1000, expiry[i].elapsed);
+    }
+    task_util::WaitForIdle();
+    for (int i = 0; i < kTimers; i++) {
+        EXPECT_TRUE(TimerManager::DeleteTimer(timers[i]));
+    }
+}
+
+// Create, start, cancel and delete timers the way sessions that come and go
+// do with their hold and keepalive timers, while many others are running.
+// gtest reports the elapsed time.
+TEST_F(TimerUT, churn) {
+    static const int kRunning = 10000;
+    static const int kChurn = 100000;
+    vector<Timer *> running;
+    for (int i = 0; i < kRunning; i++) {
+        Timer *timer =
+            TimerManager::CreateTimer(*evm_->io_service(), "Running");
+        timer->Start(60000 + i, TimerCb);
+        running.push_back(timer);
+    }
+
+    for (int i = 0; i < kChurn; i++) {
+        Timer *timer = TimerManager::CreateTimer(*evm_->io_service(), "Churn");
+        timer->Start(3000 + i % 1000, TimerCb);
+        timer->Cancel();
+        timer->Start(90000, TimerCb);
+        EXPECT_TRUE(TimerManager::DeleteTimer(timer));
+    }
+    for (int i = 0; i < kRunning; i++) {
+        running[i]->Cancel();
+        running[i]->Start(60000, TimerCb);
+    }
+
+    for (int i = 0; i < kRunning; i++) {
+        EXPECT_TRUE(TimerManager::DeleteTimer(running[i]));
+    }
+    EXPECT_EQ(0, timer_count_);
+}
+
 int main(int argc, char *argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     // Run timer test with one thread
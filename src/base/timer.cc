@@ -4,6 +4,238 @@
 
 #include "base/timer.h"
 
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+//
+// TimerWheel
+//
+// Hashed hierarchical timer wheel that holds the running Timers of an
+// io_service. Time is counted in ticks of 1 msec. There are kLevels levels
+// of kSlots slots each, and a slot at level n covers kSlots^n ticks. A timer
+// is added to the lowest level that covers its expiry and moves down when
+// the level below it wraps around. Start and Cancel are thus O(1) no matter
+// how many timers are running.
+//
+// A single ASIO timer is armed for the next tick that has work to do. All
+// the timers that expire by then are collected under the wheel mutex, and
+// their tasks are started once the mutex is released.
+//
+// The wheel is an io_service service, so that there is one per io_service
+// and it goes away along with the io_service.
+//
+class TimerWheel : public boost::asio::io_service::service {
+public:
+    static boost::asio::io_service::id id;
+
+    explicit TimerWheel(boost::asio::io_service &io_service)
+        : boost::asio::io_service::service(io_service),
+          timer_(io_service), now_(Now()), armed_(0), count_(0) {
+    }
+
+    static TimerWheel *GetInstance(boost::asio::io_service &io_service) {
+        return &boost::asio::use_service<TimerWheel>(io_service);
+    }
+
+    // Add the timer to expire in time msecs, and take a reference on it.
+    void Add(Timer *timer, int time);
+
+    // Remove the timer if it has not expired yet. Returns true if it was
+    // removed, in which case the caller inherits the reference taken by Add.
+    bool Remove(Timer *timer);
+
+private:
+    typedef boost::intrusive::member_hook<
+        Timer,
+        Timer::WheelHook,
+        &Timer::wheel_node_
+    > MemberHook;
+    typedef boost::intrusive::list<
+        Timer,
+        MemberHook,
+        boost::intrusive::constant_time_size<false>
+    > Slot;
+    typedef std::vector<std::pair<Timer::TimerPtr, uint32_t> > ExpiryList;
+
+    static const int kSlotBits = 8;
+    static const int kSlots = 1 << kSlotBits;
+    static const int kLevels = 4;
+
+    virtual void shutdown_service();
+
+    static uint64_t Now();
+    void Insert(Timer *timer);
+    void Cascade(int level);
+    void Advance(uint64_t now, ExpiryList *expired);
+    uint64_t NextTick() const;
+    void Arm(uint64_t tick);
+    void Run(const boost::system::error_code &ec);
+
+    tbb::mutex mutex_;
+    boost::asio::monotonic_deadline_timer timer_;
+    Slot slots_[kLevels][kSlots];
+    uint64_t now_;
+    uint64_t armed_;
+    size_t count_;
+};
+
+boost::asio::io_service::id TimerWheel::id;
+
+uint64_t TimerWheel::Now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void TimerWheel::Add(Timer *timer, int time) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    uint64_t now = Now();
+    if (count_ == 0) {
+        now_ = now;
+    }
+
+    // A timer that is not running is never left linked to a slot.
+    assert(!timer->wheel_node_.is_linked());
+
+    // Round up so that the timer never fires before time msecs.
+    timer->expires_ = now + time + 1;
+    intrusive_ptr_add_ref(timer);
+    Insert(timer);
+    count_++;
+    if (armed_ == 0 || timer->expires_ < armed_) {
+        Arm(timer->expires_);
+    }
+}
+
+bool TimerWheel::Remove(Timer *timer) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    if (!timer->wheel_node_.is_linked()) {
+        return false;
+    }
+    timer->wheel_node_.unlink();
+    count_--;
+    return true;
+}
+
+// Link the timer to the slot of the lowest level that covers its expiry,
+// relative to the last tick processed.
+void TimerWheel::Insert(Timer *timer) {
+    uint64_t expires = std::max(timer->expires_, now_ + 1);
+    uint64_t delta = expires - now_;
+    int level = 0;
+    while (level < kLevels - 1 &&
+           delta >= (1ULL << (kSlotBits * (level + 1)))) {
+        level++;
+    }
+    int index = (expires >> (kSlotBits * level)) & (kSlots - 1);
+    slots_[level][index].push_back(*timer);
+}
+
+// Move the timers in the current slot of the given level to lower levels.
+// Called when the level below wraps around.
+void TimerWheel::Cascade(int level) {
+    int index = (now_ >> (kSlotBits * level)) & (kSlots - 1);
+    if (index == 0 && level + 1 < kLevels) {
+        Cascade(level + 1);
+    }
+    Slot &slot = slots_[level][index];
+    while (!slot.empty()) {
+        Timer *timer = &slot.front();
+        slot.pop_front();
+        Insert(timer);
+    }
+}
+
+// Process all the ticks up to now and collect the expired timers, along with
+// the reference held by the wheel. The seq_no of a timer can be read here
+// since it does not change while the timer is linked to the wheel.
+void TimerWheel::Advance(uint64_t now, ExpiryList *expired) {
+    while (now_ < now) {
+        if (count_ == 0) {
+            now_ = now;
+            break;
+        }
+        now_++;
+        int index = now_ & (kSlots - 1);
+        if (index == 0) {
+            Cascade(1);
+        }
+        Slot &slot = slots_[0][index];
+        while (!slot.empty()) {
+            Timer *timer = &slot.front();
+            slot.pop_front();
+            count_--;
+            expired->push_back(
+                std::make_pair(Timer::TimerPtr(timer, false), timer->seq_no_));
+        }
+    }
+}
+
+// Next tick with expiring timers or that cascades the upper levels.
+uint64_t TimerWheel::NextTick() const {
+    uint64_t tick = now_ + 1;
+    for (; tick & (kSlots - 1); tick++) {
+        if (!slots_[0][tick & (kSlots - 1)].empty()) {
+            break;
+        }
+    }
+    return tick;
+}
+
+// Arming the ASIO timer again aborts any previous wait.
+void TimerWheel::Arm(uint64_t tick) {
+    uint64_t now = Now();
+    boost::system::error_code ec;
+    armed_ = tick;
+    timer_.expires_from_now(
+        boost::posix_time::milliseconds(tick > now ? tick - now : 0), ec);
+    timer_.async_wait(boost::bind(&TimerWheel::Run, this,
+                                  boost::asio::placeholders::error));
+}
+
+void TimerWheel::Run(const boost::system::error_code &ec) {
+    if (ec == boost::asio::error::operation_aborted) {
+        return;
+    }
+
+    ExpiryList expired;
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        armed_ = 0;
+        Advance(Now(), &expired);
+        if (count_) {
+            Arm(NextTick());
+        }
+    }
+
+    for (ExpiryList::iterator iter = expired.begin();
+         iter != expired.end(); ++iter) {
+        iter->first->StartTimerTask(iter->second);
+    }
+}
+
+// Drop the references held by the wheel when the io_service goes away.
+void TimerWheel::shutdown_service() {
+    std::vector<Timer::TimerPtr> timers;
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        for (int level = 0; level < kLevels; level++) {
+            for (int index = 0; index < kSlots; index++) {
+                Slot &slot = slots_[level][index];
+                while (!slot.empty()) {
+                    Timer *timer = &slot.front();
+                    slot.pop_front();
+                    timers.push_back(Timer::TimerPtr(timer, false));
+                }
+            }
+        }
+        count_ = 0;
+        boost::system::error_code ec;
+        timer_.cancel(ec);
+    }
+}
+
 class Timer::TimerTask : public Task {
 public:
     TimerTask(TimerPtr timer, boost::system::error_code ec)
@@ -75,10 +307,11 @@ private:
 
 Timer::Timer(boost::asio::io_service &service, const std::string &name,
           int task_id, int task_instance, bool delete_on_completion)
-    : boost::asio::monotonic_deadline_timer(service), name_(name), handler_(NULL),
+    : name_(name), handler_(NULL),
     error_handler_(NULL), state_(Init), timer_task_(NULL), time_(0),
     task_id_(task_id), task_instance_(task_instance), seq_no_(0),
-    delete_on_completion_(delete_on_completion) {
+    delete_on_completion_(delete_on_completion), deleted_(false),
+    wheel_(TimerWheel::GetInstance(service)), expires_(0) {
     refcount_ = 0;
 }
 
@@ -106,15 +339,10 @@ bool Timer::Start(int time, Handler handler, ErrorHandler error_handler) {
     handler_ = handler;
     seq_no_++;
     error_handler_ = error_handler;
-    boost::system::error_code ec;
-    expires_from_now(boost::posix_time::milliseconds(time), ec);
-    if (ec) {
-        return false;
-    }
+    time_ = time;
 
     SetState(Running);
-    async_wait(boost::bind(Timer::StartTimerTask, this, TimerPtr(this), time, 
-                           seq_no_, boost::asio::placeholders::error));
+    wheel_->Add(this, time);
     return true;
 }
 
@@ -129,6 +357,8 @@ void Timer::Reschedule(int time)
 
 // Cancel a running timer
 bool Timer::Cancel() {
+    // Reference taken back from the wheel, released after the mutex.
+    TimerPtr wheel_ref;
     tbb::mutex::scoped_lock lock(mutex_);
 
     // A fired timer cannot be cancelled
@@ -150,41 +380,35 @@ bool Timer::Cancel() {
         timer_task_ = NULL;
     }
 
+    if (wheel_->Remove(this)) {
+        wheel_ref = TimerPtr(this, false);
+    }
+
     SetState(Cancelled);
     return true;
 }
 
-// ASIO callback on timer expiry. Start a task to serve the timer
-void Timer::StartTimerTask(boost::asio::monotonic_deadline_timer* t, TimerPtr timer,
-                           int time, uint32_t seq_no, 
-                           const boost::system::error_code &ec) {
-    tbb::mutex::scoped_lock lock(timer->mutex_);
-
-    if (timer->state_ == Cancelled) {
-        return;
-    }
+// Timer wheel callback on timer expiry. Start a task to serve the timer
+void Timer::StartTimerTask(uint32_t seq_no) {
+    tbb::mutex::scoped_lock lock(mutex_);
 
-    // If timer was cancelled, no callback is invoked
-    if (ec && ec.value() == boost::asio::error::operation_aborted) {
+    if (state_ == Cancelled) {
         return;
     }
 
     // Timer could have fired for previous run. Validate the seq_no_
-    if (timer->seq_no_ != seq_no) {
+    if (seq_no_ != seq_no) {
         return;
     }
     // Start a task and add Task reference.
-    assert(timer->timer_task_ == NULL);
-    timer->timer_task_ = new TimerTask(timer, ec);
-    timer->time_ = time;
-    TaskScheduler::GetInstance()->Enqueue(timer->timer_task_);
+    assert(timer_task_ == NULL);
+    timer_task_ = new TimerTask(TimerPtr(this), boost::system::error_code());
+    TaskScheduler::GetInstance()->Enqueue(timer_task_);
 }
 
 //
 // TimerManager class routines
 //
-TimerManager::TimerSet TimerManager::timer_ref_;
-tbb::mutex TimerManager::mutex_;
 
 Timer *TimerManager::CreateTimer(
             boost::asio::io_service &service, const std::string &name,
@@ -196,23 +420,26 @@ Timer *TimerManager::CreateTimer(
 }
 
 void TimerManager::AddTimer(Timer *timer) {
-    tbb::mutex::scoped_lock lock(mutex_);
-    timer_ref_.insert(TimerPtr(timer));
-
-    return;
+    intrusive_ptr_add_ref(timer);
 }
 
 //
-// Delete a timer object from the data base, by removing the intrusive
-// reference. If any other objects has a reference to this timer such as
-// boost::asio, the timer object deletion is automatically deferred
+// Delete a timer object by removing the intrusive reference taken when it
+// was created. If any other objects has a reference to this timer such as
+// the timer wheel, the timer object deletion is automatically deferred
 //
 bool TimerManager::DeleteTimer(Timer *timer) {
     if (!timer || timer->fired()) return false;
 
     timer->Cancel();
-    tbb::mutex::scoped_lock lock(mutex_);
-    timer_ref_.erase(TimerPtr(timer));
+    {
+        tbb::mutex::scoped_lock lock(timer->mutex_);
+        if (timer->deleted_) {
+            return true;
+        }
+        timer->deleted_ = true;
+    }
+    intrusive_ptr_release(timer);
 
     return true;
 }
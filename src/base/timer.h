@@ -3,8 +3,9 @@
  */
 
 //  Timer implementation using ASIO and Task infrastructure. 
-//  Registers an ASIO timer. On ASIO timer expiry, a task will be created to
-//  run the timer. Supports user specified task-id.
+//  Running timers are kept in a hierarchical timer wheel per io_service,
+//  which is driven by a single ASIO timer. On expiry, a task will be created
+//  to run the timer. Supports user specified task-id.
 //
 //  Operations supported
 //  - Create a timer by allocating an object of type Timer
@@ -28,9 +29,9 @@
 //  - Timer is allocated by application
 //  - Applications must call TimerManager::DeleteTimer() to delete the timer
 //  - All operations on timer are protected by mutex
-//  - When timer is running, it can have references from ASIO and Task. 
-//    Timer class will keep of reference from ASIO and Task. Timer will
-//    be deleted when both the references go away. (via intrusive pointer)
+//  - When timer is running, it can have references from the timer wheel and
+//    Task. Timer class will keep of reference from the wheel and Task. Timer
+//    will be deleted when both the references go away. (via intrusive pointer)
 //
 
 #ifndef TIMER_H_
@@ -44,12 +45,15 @@
 #include <boost/function.hpp>
 #include <boost/asio.hpp>
 #include <boost/system/error_code.hpp>
+#include <boost/intrusive/list.hpp>
 #include <set>
 #include <boost/asio/monotonic_deadline_timer.hpp>
 
 #include <base/task.h>
 
-class Timer : public boost::asio::monotonic_deadline_timer {
+class TimerWheel;
+
+class Timer {
 private:
 	// Task used to fire the timer
     class TimerTask;
@@ -110,6 +114,7 @@ public:
 private:
     friend class TimerManager;
     friend class TimerTest;
+    friend class TimerWheel;
 
     friend void intrusive_ptr_add_ref(Timer *timer);
     friend void intrusive_ptr_release(Timer *timer);
@@ -122,10 +127,12 @@ private:
         Cancelled       = 3,
     };
 
-    // ASIO callback on timer expiry. Start a task to serve the timer
-    static void StartTimerTask(boost::asio::monotonic_deadline_timer* t, TimerPtr t_ptr,
-                               int time, uint32_t seq_no,
-                               const boost::system::error_code &ec);
+    typedef boost::intrusive::list_member_hook<
+        boost::intrusive::link_mode<boost::intrusive::auto_unlink>
+    > WheelHook;
+
+    // Timer wheel callback on timer expiry. Start a task to serve the timer
+    void StartTimerTask(uint32_t seq_no);
 
     void SetState(TimerState s) { state_ = s; }
     static int GetTimerInstanceId() { return -1; }
@@ -150,7 +157,13 @@ private:
     int task_instance_;
     uint32_t seq_no_;
     bool delete_on_completion_;
+    bool deleted_;
     tbb::atomic<int> refcount_;
+    TimerWheel *wheel_;
+
+    // Owned by the TimerWheel and protected by its mutex.
+    WheelHook wheel_node_;
+    uint64_t expires_;
 };
 
 inline void intrusive_ptr_add_ref(Timer *timer) {
@@ -165,14 +178,14 @@ inline void intrusive_ptr_release(Timer *timer) {
 }
 
 //
-// TimerManager is the place holder for all the Timer objects
-// instantiated in the life time of a process
+// TimerManager creates and deletes the Timer objects instantiated in the
+// life time of a process
 //
-// Timer objects are help in TimerSet until all the cleanup is complete
-// and only then should they be deleted via DeleteTimer() API
+// A Timer holds a reference on itself from creation until it is deleted via
+// DeleteTimer() API
 //
-// Since Timer objects are also held by boost::asio routines, they are
-// protected using intrusive pointers
+// Since Timer objects are also held by the timer wheel and by tasks, they
+// are protected using intrusive pointers
 // 
 // This is similar to how TcpSession objects are managed via TcpSessionPtr
 //
@@ -188,18 +201,7 @@ public:
 private:
     friend class TimerTest;
 
-    typedef boost::intrusive_ptr<Timer> TimerPtr;
-    struct TimerPtrCmp {
-        bool operator()(const TimerPtr &lhs,
-                        const TimerPtr &rhs) const {
-            return lhs.get() < rhs.get();
-        }
-    };
-    typedef std::set<TimerPtr, TimerPtrCmp> TimerSet;
     static void AddTimer(Timer *Timer);
-
-    static tbb::mutex mutex_;
-    static TimerSet timer_ref_;
 };
 
 #endif /* TIMER_H_ */
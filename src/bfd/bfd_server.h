@@ -9,6 +9,7 @@
 #include <tbb/mutex.h>
 #include <map>
 #include <boost/asio/ip/address.hpp>
+#include <boost/unordered_map.hpp>
 
 class EventManager;
 
@@ -38,7 +39,7 @@ class BFDServer {
  private:
     class SessionManager : boost::noncopyable {
         EventManager *evm_;
-        typedef std::map<Discriminator, BFDSession*> DiscriminatorSessionMap;
+        typedef boost::unordered_map<Discriminator, BFDSession*> DiscriminatorSessionMap;
         typedef std::map<boost::asio::ip::address, BFDSession*> AddressSessionMap;
 
         DiscriminatorSessionMap by_discriminator_;
@@ -8,6 +8,7 @@
 #include "bfd/bfd_common.h"
 
 #include <boost/asio.hpp>
+#include <boost/bind.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/random.hpp>
 #include "base/logging.h"
@@ -29,10 +30,12 @@ UDPConnectionManager::UDPRecvServer::UDPRecvServer(EventManager *evm, int recvPo
 
             if (bytes_transferred != kMinimalPacketLength) {
                 LOG(ERROR, __func__ <<  "Wrong packet size: " << bytes_transferred);
+                DeallocateBuffer(recv_buffer);
                 return;
             }
             boost::scoped_ptr<ControlPacket> controlPacket(
                     ParseControlPacket(boost::asio::buffer_cast<const uint8_t *> (recv_buffer), bytes_transferred));
+            DeallocateBuffer(recv_buffer);
             if (controlPacket == NULL) {
                 LOG(ERROR, __func__ <<  "Unable to parse packet");
             } else {
@@ -44,7 +47,8 @@ UDPConnectionManager::UDPRecvServer::UDPRecvServer(EventManager *evm, int recvPo
 
 
         UDPConnectionManager::UDPCommunicator::UDPCommunicator(EventManager *evm, int remotePort)
-                : UDPServer(evm), remotePort_(remotePort) {
+                : UDPServer(evm), remotePort_(remotePort),
+                  queue_(new SendQueue(this)) {
             boost::random::uniform_int_distribution<> dist(kSendPortMin, kSendPortMax);
             for (int i = 0; i < 100 && GetServerState() != OK; ++i) {
                 int localPort = dist(randomGen);
@@ -58,18 +62,98 @@ UDPConnectionManager::UDPRecvServer::UDPRecvServer(EventManager *evm, int recvPo
                 LOG(ERROR, "Unable to bind to port in range: " << kSendPortMin << "-" << kSendPortMax);
             }
         }
+
+        UDPConnectionManager::UDPCommunicator::~UDPCommunicator() {
+            Detach();
+        }
+
      void UDPConnectionManager::UDPCommunicator::SendPacket(
                  const boost::asio::ip::address &dstAddr, const ControlPacket *packet) {
             LOG(DEBUG, __func__);
 
-            mutable_buffer send = AllocateBuffer(kMinimalPacketLength);  // Packet without auth data
-            int pktSize = EncodeControlPacket(packet, boost::asio::buffer_cast<uint8_t *> (send), kMinimalPacketLength);
+            uint8_t data[kMinimalPacketLength];  // Packet without auth data
+            int pktSize = EncodeControlPacket(packet, data, kMinimalPacketLength);
             if (pktSize != kMinimalPacketLength) {
                 LOG(ERROR, "Unable to encode packet");
-            } else {
-                boost::asio::ip::udp::endpoint dstEndpoint(dstAddr, remotePort_);
-                StartSend(dstEndpoint, pktSize, send);
+                return;
+            }
+
+            tbb::mutex::scoped_lock lock(queue_->mutex);
+            if (queue_->owner == NULL) {
+                return;
+            }
+            queue_->packets.insert(queue_->packets.end(), data, data + pktSize);
+            queue_->endpoints.push_back(boost::asio::ip::udp::endpoint(dstAddr, remotePort_));
+            if (!queue_->flush_pending) {
+                queue_->flush_pending = true;
+                event_manager()->io_service()->post(
+                    boost::bind(&UDPCommunicator::Flush, queue_));
+            }
+        }
+
+     // Runs in the event manager thread. The queue mutex is held while
+     // sending, so that Detach waits for a send in progress to complete.
+     // Packets that do not fit in the socket buffer are kept and sent once
+     // the socket becomes writable again.
+     void UDPConnectionManager::UDPCommunicator::Flush(SendQueuePtr queue) {
+            tbb::mutex::scoped_lock lock(queue->mutex);
+            UDPCommunicator *owner = queue->owner;
+            if (owner == NULL) {
+                return;
+            }
+
+            size_t count = queue->endpoints.size();
+            std::vector<boost::asio::const_buffer> buffers;
+            buffers.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                buffers.push_back(boost::asio::const_buffer(
+                    &queue->packets[i * kMinimalPacketLength], kMinimalPacketLength));
+            }
+            boost::system::error_code error;
+            size_t sent = owner->SendBatch(queue->endpoints, buffers, error);
+            if (error == boost::asio::error::would_block) {
+                queue->packets.erase(queue->packets.begin(),
+                    queue->packets.begin() + sent * kMinimalPacketLength);
+                queue->endpoints.erase(queue->endpoints.begin(),
+                    queue->endpoints.begin() + sent);
+                owner->AsyncWaitWritable(
+                    boost::bind(&UDPCommunicator::HandleWritable, queue, _1));
+                return;
+            }
+            if (sent != count) {
+                LOG(ERROR, "Unable to send " << count - sent << " packets");
+            }
+            queue->packets.clear();
+            queue->endpoints.clear();
+            queue->flush_pending = false;
+        }
+
+     void UDPConnectionManager::UDPCommunicator::HandleWritable(
+                SendQueuePtr queue, const boost::system::error_code &error) {
+            if (error) {
+                tbb::mutex::scoped_lock lock(queue->mutex);
+                if (queue->owner != NULL) {
+                    LOG(ERROR, "Unable to send " << queue->endpoints.size()
+                        << " packets: " << error.message());
+                }
+                queue->packets.clear();
+                queue->endpoints.clear();
+                queue->flush_pending = false;
+                return;
             }
+            Flush(queue);
+        }
+
+     void UDPConnectionManager::UDPCommunicator::Detach() {
+            tbb::mutex::scoped_lock lock(queue_->mutex);
+            queue_->owner = NULL;
+            queue_->packets.clear();
+            queue_->endpoints.clear();
+        }
+
+     void UDPConnectionManager::UDPCommunicator::Shutdown() {
+            Detach();
+            UDPServer::Shutdown();
         }
 
 
@@ -77,8 +161,10 @@ UDPConnectionManager::UDPRecvServer::UDPRecvServer(EventManager *evm, int recvPo
                : udpRecv_(evm, recvPort), udpSend_(evm, remotePort) {
         if (udpRecv_.GetServerState() != UDPRecvServer::OK)
             LOG(ERROR, "Unable to listen on port " << recvPort);
-        else
+        else {
+            udpRecv_.SetReceiveBatchSize(UDPServer::kMaxReceiveBatch);
             udpRecv_.StartReceive();
+        }
     }
 
      void UDPConnectionManager::SendPacket(const boost::asio::ip::address &dstAddr, const ControlPacket *packet) {
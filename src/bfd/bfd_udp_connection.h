@@ -6,7 +6,10 @@
 
 #include "bfd/bfd_connection.h"
 
+#include <vector>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <tbb/mutex.h>
 #include "io/udp_server.h"
 
 
@@ -32,11 +35,37 @@ class UDPConnectionManager :  public Connection {
                 const boost::system::error_code& error);
     } udpRecv_;
 
+    // Packets are queued and sent by the event manager thread in batches,
+    // so that the packets of all the sessions whose transmit timers expire
+    // together go out in a few system calls.
     class UDPCommunicator : public UDPServer {
+        // The handlers posted to the event manager hold a reference on the
+        // queue rather than on the communicator, which detaches itself from
+        // the queue when it shuts down.
+        struct SendQueue {
+            explicit SendQueue(UDPCommunicator *owner)
+                : owner(owner), flush_pending(false) {
+            }
+            tbb::mutex mutex;
+            UDPCommunicator *owner;
+            std::vector<uint8_t> packets;
+            std::vector<boost::asio::ip::udp::endpoint> endpoints;
+            bool flush_pending;
+        };
+        typedef boost::shared_ptr<SendQueue> SendQueuePtr;
+
         const int remotePort_;
+        SendQueuePtr queue_;
+
+        static void Flush(SendQueuePtr queue);
+        static void HandleWritable(SendQueuePtr queue,
+                                   const boost::system::error_code &error);
+        void Detach();
      public:
         UDPCommunicator(EventManager *evm, int remotePort);
+        virtual ~UDPCommunicator();
         virtual void SendPacket(const boost::asio::ip::address &dstAddr, const ControlPacket *packet);
+        virtual void Shutdown();
     } udpSend_;  // TODO multiple instances to randomize udp source port
 
  public:
@@ -9,6 +9,7 @@
 
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
+#include <tbb/atomic.h>
 #include <testing/gunit.h>
 #include "test/task_test_util.h"
 #include "base/logging.h"
@@ -26,6 +27,97 @@ class BFDTest : public ::testing::Test {
     boost::optional<bool> cmpResult;
 };
 
+class BFDBatchTest : public ::testing::Test {
+ public:
+    static const int kPort1 = 10003;
+    static const int kPort2 = 10004;
+
+    BFDBatchTest() : communicationManager1_(&em_, kPort1, kPort2),
+            communicationManager2_(&em_, kPort2, kPort1),
+            addr_(boost::asio::ip::address::from_string("127.0.0.1")) {
+        received_ = 0;
+        communicationManager2_.RegisterCallback(
+            boost::bind(&BFDBatchTest::ReceivePacket, this, _1));
+    }
+
+    void ReceivePacket(const ControlPacket *packet) {
+        received_++;
+    }
+
+    static void InitPacket(ControlPacket *packet) {
+        packet->poll = false;
+        packet->final = false;
+        packet->control_plane_independent = false;
+        packet->authentication_present = false;
+        packet->demand = false;
+        packet->multipoint = false;
+        packet->detection_time_multiplier = 3;
+        packet->length = kMinimalPacketLength;
+        packet->sender_discriminator = 1;
+        packet->receiver_discriminator = 0;
+        packet->diagnostic = kNoDiagnostic;
+        packet->state = kUp;
+        packet->desired_min_tx_interval = boost::posix_time::milliseconds(50);
+        packet->required_min_rx_interval = boost::posix_time::milliseconds(50);
+        packet->required_min_echo_rx_interval =
+            boost::posix_time::milliseconds(0);
+    }
+
+    // Send one packet for each of count sessions from the current thread.
+    void SendPackets(int count) {
+        ControlPacket packet;
+        InitPacket(&packet);
+        for (int i = 0; i < count; ++i) {
+            packet.sender_discriminator = i + 1;
+            communicationManager1_.SendPacket(addr_, &packet);
+        }
+    }
+
+    EventManager em_;
+    UDPConnectionManager communicationManager1_;
+    UDPConnectionManager communicationManager2_;
+    const boost::asio::ip::address addr_;
+    tbb::atomic<int> received_;
+};
+
+// Packets queued before the event manager runs go out in one batch.
+TEST_F(BFDBatchTest, Batch) {
+    const int kPackets = 100;
+    SendPackets(kPackets);
+    EventManagerThread evmThread(&em_);
+    TASK_UTIL_EXPECT_EQ(kPackets, received_);
+}
+
+// A flush that is still queued when the connection manager goes away does
+// not touch it.
+TEST_F(BFDBatchTest, ShutdownPendingFlush) {
+    EventManager em;
+    UDPConnectionManager *manager = new UDPConnectionManager(&em, 10005, kPort2);
+    ControlPacket packet;
+    InitPacket(&packet);
+    manager->SendPacket(addr_, &packet);
+    delete manager;
+
+    em.Poll();
+    em.Shutdown();
+}
+
+// Loopback throughput of 10K sessions sending every 50ms. Run with
+// --gtest_also_run_disabled_tests; gtest reports the elapsed time.
+TEST_F(BFDBatchTest, DISABLED_Perf) {
+    const int kSessions = 10000;
+    const int kRounds = 20;
+    const int kBatch = 100;
+    EventManagerThread evmThread(&em_);
+
+    for (int round = 0; round < kRounds; ++round) {
+        for (int sent = 0; sent < kSessions; sent += kBatch) {
+            SendPackets(kBatch);
+            TASK_UTIL_EXPECT_EQ(round * kSessions + sent + kBatch, received_);
+        }
+    }
+}
+
 
 TEST_F(BFDTest, UDPConnection) {
     const int port1 = 10001;
@@ -25,30 +25,35 @@ std::string BgpPath::PathSourceString(PathSource source) {
     }
 }
 
-BgpPath::BgpPath() : peer_(NULL), path_id_(0), source_(BGP_XMPP), 
+BgpPath::BgpPath() : peer_path_route_(NULL), peer_(NULL), path_id_(0),
+    source_(BGP_XMPP), 
     flags_(0), label_(0) {
 }
 
 BgpPath::BgpPath(const IPeer *peer, uint32_t path_id, PathSource src, 
                  const BgpAttrPtr ptr, uint32_t flags, uint32_t label)
-    : peer_(peer), path_id_(path_id), source_(src), attr_(ptr), 
+    : peer_path_route_(NULL),
+      peer_(peer), path_id_(path_id), source_(src), attr_(ptr), 
       flags_(flags), label_(label) {
 }
 
 BgpPath::BgpPath(const IPeer *peer, PathSource src, const BgpAttrPtr ptr, 
         uint32_t flags, uint32_t label)
-    : peer_(peer), path_id_(0), source_(src), attr_(ptr), 
+    : peer_path_route_(NULL),
+      peer_(peer), path_id_(0), source_(src), attr_(ptr), 
       flags_(flags), label_(label) {
 }
 
 BgpPath::BgpPath(uint32_t path_id, PathSource src, const BgpAttrPtr ptr,
         uint32_t flags, uint32_t label)
-    : peer_(NULL), path_id_(path_id), source_(src), attr_(ptr), 
+    : peer_path_route_(NULL),
+      peer_(NULL), path_id_(path_id), source_(src), attr_(ptr), 
       flags_(flags), label_(label) {
 }
 
 BgpPath::BgpPath(const BgpPath &rhs) 
-    : peer_(rhs.peer_), path_id_(rhs.path_id_), source_(rhs.source_), 
+    : peer_path_route_(NULL),
+      peer_(rhs.peer_), path_id_(rhs.path_id_), source_(rhs.source_), 
       attr_(rhs.attr_), flags_(rhs.flags_), label_(rhs.label_) {
     set_time_stamp_usecs(rhs.time_stamp_usecs());
 }
@@ -69,6 +74,10 @@ int BgpPath::PathCompare(const BgpPath &rhs, bool allow_ecmp) const {
     // Feasible Path first
     KEY_COMPARE(rhs.IsFeasible(), IsFeasible());
 
+    // Paths retained across a graceful restart are least preferred. They
+    // are never ECMP with paths that are not stale.
+    KEY_COMPARE(IsStale(), rhs.IsStale());
+
     // Compare local_pref larger value is better, so compare in reverse order
     KEY_COMPARE(rattr->local_pref(), attr_->local_pref());
 
@@ -5,6 +5,8 @@
 #ifndef ctrlplane_bgp_path_h
 #define ctrlplane_bgp_path_h
 
+#include <boost/intrusive/list.hpp>
+
 #include "base/util.h"
 #include "route/path.h"
 #include "bgp/bgp_peer.h"
@@ -30,6 +32,12 @@ public:
         StaticRoute = 3,
     };
 
+    // Hook for the per-peer RibIn path index kept by BgpTable. The hook
+    // unlinks itself when the path is destroyed.
+    typedef boost::intrusive::list_member_hook<
+        boost::intrusive::link_mode<boost::intrusive::auto_unlink>
+    > PeerPathHook;
+
     static const uint32_t INFEASIBLE_MASK =
         (AsPathLooped|NoNeighborAs|NoTunnelEncap);
 
@@ -82,7 +90,7 @@ public:
     }
 
     // Check if the path is stale
-    bool IsStale() {
+    bool IsStale() const {
         return ((flags_ & Stale) != 0);
     }
 
@@ -107,7 +115,16 @@ public:
     // Select one path over other
     int PathCompare(const BgpPath &rhs, bool allow_ecmp) const;
 
+    // Route under which this path is linked in the per-peer path index
+    BgpRoute *peer_path_route() const {
+        return peer_path_route_;
+    }
+
 private:
+    friend class BgpTable;
+
+    PeerPathHook peer_path_node_;
+    BgpRoute *peer_path_route_;
     const IPeer *peer_;
     const uint32_t path_id_;
     const PathSource source_;
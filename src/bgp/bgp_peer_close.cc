@@ -275,21 +275,24 @@ void PeerCloseManager::Close() {
 }
 
 // For graceful-restart, we take mark-and-sweep approach instead of directly
-// deleting the paths. In the first walk, local-preference is lowered so that
-// the paths are least preferred and they are marked stale. After some time, if
-// the peer session does not come back up, we delete all the paths and the peer
-// itself. If the session did come back up, we flush only those paths that were
-// not learned again in the new session.
+// deleting the paths. In the first pass, the paths are marked stale, which
+// makes them least preferred without changing their attributes. After some
+// time, if the peer session does not come back up, we delete all the paths
+// and the peer itself. If the session did come back up, we flush only those
+// paths that were not learned again in the new session.
 
-// ProcessRibIn
+// ProcessRibInPath
 //
-// Concurrency: Runs in the context of the DB Walker task launched by 
-// peer rib membership manager
+// Concurrency: Runs in the context of the DB partition task of the route, on
+// behalf of the peer rib membership manager
 //
-// DBWalker callback routine for each of the RibIn prefix.
+// Process one RibIn path sourced from this peer_. The paths are found via the
+// per-peer path index of the table, so only the routes that peer_ contributed
+// to are visited.
 //
-void PeerCloseManager::ProcessRibIn(DBTablePartBase *root, BgpRoute *rt,
-                                    BgpTable *table, int action_mask) {
+void PeerCloseManager::ProcessRibInPath(DBTablePartBase *root, BgpRoute *rt,
+                                        BgpPath *path, BgpTable *table,
+                                        int action_mask) {
     DBRequest::DBOperation oper;
     BgpAttrPtr attrs;
     MembershipRequest::Action  action;
@@ -302,57 +305,38 @@ void PeerCloseManager::ProcessRibIn(DBTablePartBase *root, BgpRoute *rt,
 
     if (action == MembershipRequest::INVALID) return;
 
-    // Process all paths sourced from this peer_. Multiple paths could exist
-    // in ecmp cases.
-    for (Route::PathList::iterator it = rt->GetPathList().begin(), next = it;
-         it != rt->GetPathList().end(); it = next) {
-        next++;
-
-        // Skip secondary paths.
-        if (dynamic_cast<BgpSecondaryPath *>(it.operator->())) continue;
-        BgpPath *path = static_cast<BgpPath *>(it.operator->());
-        if (path->GetPeer() != peer_) continue;
-
-        switch (action) {
-            case MembershipRequest::RIBIN_SWEEP:
-
-                // Stale paths must be deleted
-                if (!path->IsStale()) {
-                    return;
-                }
-
-                // Fall through to delete case as the path is still stale
-                // and we are sweeping such paths from the table
-            case MembershipRequest::RIBIN_DELETE:
-
-                // This path must be deleted. Hence attr is not required
-                oper = DBRequest::DB_ENTRY_DELETE;
-                attrs = NULL;
-                break;
-
-            case MembershipRequest::RIBIN_STALE:
-
-                // This path must be marked for staling. Update the local
-                // preference and update the route accordingly
-                oper = DBRequest::DB_ENTRY_ADD_CHANGE;
-
-                // Update attrs with maximum local preference so that this path
-                // is least preferred
-                // TODO: Check for the right local-pref value to use
-                attrs = peer_->server()->attr_db()->\
-                        ReplaceLocalPreferenceAndLocate(path->GetAttr(), 1);
-                path->SetStale();
-                break;
-
-            default:
+    switch (action) {
+        case MembershipRequest::RIBIN_SWEEP:
+
+            // Stale paths must be deleted
+            if (!path->IsStale()) {
                 return;
-        }
+            }
+
+            // Fall through to delete case as the path is still stale
+            // and we are sweeping such paths from the table
+        case MembershipRequest::RIBIN_DELETE:
+
+            // This path must be deleted. Hence attr is not required
+            oper = DBRequest::DB_ENTRY_DELETE;
+            attrs = NULL;
+            break;
 
-        // Feed the route modify/delete request to the table input process
-        table->InputCommon(root, rt, path, peer_, NULL, oper, attrs,
-                        path->GetPathId(), path->GetFlags(), path->GetLabel());
+        case MembershipRequest::RIBIN_STALE:
+
+            // Mark the path stale so that it becomes least preferred. The
+            // attributes are left alone, so listeners need to look at the
+            // route only if the path was part of the best (ECMP) set.
+            if (rt->SetPathStale(path)) {
+                root->Notify(rt);
+            }
+            return;
+
+        default:
+            return;
     }
 
-    return;
+    // Feed the route modify/delete request to the table input process
+    table->InputCommon(root, rt, path, peer_, NULL, oper, attrs,
+                       path->GetPathId(), path->GetFlags(), path->GetLabel());
 }
-
@@ -14,6 +14,7 @@
 #include "bgp/ipeer.h"
 
 class IPeerRib;
+class BgpPath;
 class BgpRoute;
 class BgpTable;
 
@@ -51,8 +52,8 @@ public:
     void SweepComplete(IPeer *ipeer, BgpTable *table);
     int GetCloseTypeForTimerCallback(IPeerRib *peer_rib);
     int GetActionAtStart(IPeerRib *peer_rib);
-    void ProcessRibIn(DBTablePartBase *root, BgpRoute *rt, BgpTable *table,
-                      int action_mask);
+    void ProcessRibInPath(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
+                          BgpTable *table, int action_mask);
     bool IsCloseInProgress();
 
 private:
@@ -6,8 +6,10 @@
 
 #include <boost/assign/list_of.hpp>
 #include <boost/bind.hpp>
+#include <tbb/atomic.h>
 #include <tbb/mutex.h>
 
+#include "base/task.h"
 #include "base/task_annotations.h"
 #include <sandesh/sandesh_types.h>
 #include <sandesh/sandesh.h>
@@ -172,24 +174,6 @@ void IPeerRib::RibInJoin(DBTablePartBase *root, DBEntryBase *db_entry,
     return;
 }
 
-//
-// Concurrency: Runs in the context of db-walker launched from the BGP peer
-// membership task.
-//
-// Close RibIn of this IPeerRib for a particular prefix. Based on the action
-// we may mark the route as stale, sweep the route if it is stale or just
-// delete the route altogether.
-//
-void IPeerRib::RibInLeave(DBTablePartBase *root, DBEntryBase *db_entry,
-                          BgpTable *table,
-                          MembershipRequest::Action action_mask) {
-    BgpRoute *rt = static_cast<BgpRoute *>(db_entry);
-
-    if (!IsRibInRegistered()) return;
-    ipeer_->peer_close()->close_manager()->
-        ProcessRibIn(root, rt, table, action_mask);
-}
-
 //
 // Concurrency: Runs in the context of the BGP peer membership task.
 //
@@ -292,19 +276,6 @@ void IPeerRib::RibOutJoin(DBTablePartBase *root, DBEntryBase *db_entry,
 // Concurrency: Runs in the context of db-walker launched from the BGP peer
 // membership task.
 //
-void IPeerRib::RibOutLeave(DBTablePartBase *root, DBEntryBase *db_entry,
-                           BgpTable *table,
-                           MembershipRequest::Action action_mask) {
-    if (!(action_mask & MembershipRequest::RIBOUT_DELETE)) {
-        return;
-    }
-
-    RibPeerSet lmask;
-    lmask.set(ribout_->GetPeerIndex(ipeer_));
-
-    ribout_->bgp_export()->Leave(root, lmask, db_entry);
-}
-
 void IPeerRib::ManagedDelete() {
 
     //
@@ -408,12 +379,118 @@ void PeerRibMembershipManager::JoinDone(DBTableBase *db,
     Enqueue(event);
 }
 
+//
+// State shared by the RibOut table walk and the per-partition RibIn workers
+// started from the Leave method. The last one to finish posts the completion.
+//
+struct PeerRibMembershipManager::LeaveState {
+    // RibOuts of the peers leaving their RibOut, each with the set of its
+    // leaving peers
+    typedef std::map<RibOut *, RibPeerSet> RibOutLeaveMap;
+
+    LeaveState(BgpTable *table, MembershipRequestList *request_list)
+        : table(table), request_list(request_list) {
+        pending = 0;
+    }
+
+    BgpTable *table;
+    MembershipRequestList *request_list;
+    RibOutLeaveMap ribout_leave_map;
+    tbb::atomic<int> pending;
+};
+
+//
+// Process RibIn leave for all requests in a single table partition.
+//
+// Only the paths learnt from the leaving peers are visited, using the per-peer
+// path index maintained by the BgpTable. Runs as the DB partition task of the
+// partition so that it is serialized with route processing, and yields after
+// a batch of paths just like the table walker does.
+//
+class PeerRibMembershipManager::RibInWorker : public Task {
+public:
+    static const int kIterationToYield = 1024;
+
+    RibInWorker(PeerRibMembershipManager *manager, LeaveState *state,
+                int part_id)
+        : Task(TaskScheduler::GetInstance()->GetTaskId("db::DBTable"),
+               part_id),
+          manager_(manager), state_(state), part_id_(part_id),
+          request_idx_(0), remaining_(-1) {
+    }
+
+    virtual bool Run();
+
+private:
+    PeerRibMembershipManager *manager_;
+    LeaveState *state_;
+    int part_id_;
+
+    // Request currently being processed and the number of its paths that
+    // remain to be visited, -1 if the request has not been started
+    size_t request_idx_;
+    int remaining_;
+};
+
+bool PeerRibMembershipManager::RibInWorker::Run() {
+    BgpTable *table = state_->table;
+    DBTablePartBase *root = table->GetTablePartition(part_id_);
+    MembershipRequestList *request_list = state_->request_list;
+    int count = 0;
+
+    for (; request_idx_ < request_list->size();
+         request_idx_++, remaining_ = -1) {
+        MembershipRequest *request = &request_list->at(request_idx_);
+
+        IPeerRib *peer_rib = manager_->IPeerRibFind(request->ipeer, table);
+        if (!peer_rib || !peer_rib->IsRibInRegistered())
+            continue;
+
+        BgpTable::PeerPathList *paths =
+            table->PeerPathListFind(part_id_, request->ipeer);
+        if (!paths)
+            continue;
+
+        //
+        // Paths are rotated to the tail before being processed. Those that
+        // are retained (stale, sweep) end up behind the ones not yet
+        // visited, and deleted paths unlink themselves. Bound the
+        // visit by the number of paths present when the request started.
+        //
+        if (remaining_ < 0)
+            remaining_ = paths->size();
+        PeerCloseManager *close_manager =
+            request->ipeer->peer_close()->close_manager();
+        while (remaining_ > 0 && !paths->empty()) {
+            if (count == kIterationToYield)
+                return false;
+            BgpPath *path = &paths->front();
+            paths->pop_front();
+            paths->push_back(*path);
+            close_manager->ProcessRibInPath(root, path->peer_path_route(),
+                path, table, request->action_mask);
+            remaining_--;
+            count++;
+        }
+        table->PeerPathListPurge(part_id_, request->ipeer);
+    }
+
+    manager_->LeavePartDone(state_);
+    return true;
+}
+
 //
 // Concurrency: Runs in the context of the BGP peer membership task.
 //
 // Kick off the process to unregister the IPeer from the BgpTable. We first
-// need to do a table walk and clean up state for all routes from the IPeer.
-// We can actually unregister only after the state has been cleaned up.
+// need to clean up state for all routes from the IPeer. We can actually
+// unregister only after the state has been cleaned up.
+//
+// RibIn state is cleaned up by visiting just the paths of the IPeer in each
+// partition. RibOut state is kept per route, so a table walk is needed only
+// if some IPeer in the request list is leaving a registered RibOut. The walk
+// then leaves each route from just those RibOuts, with all their leaving
+// peers at once.
 //
 // In the meantime, we deactivate the IPeer in the RibOut to ensure that it
 // does not export any more routes.
@@ -422,6 +499,7 @@ void PeerRibMembershipManager::Leave(BgpTable *table,
                               MembershipRequestList *request_list) {
 
     DB *db = table->database();
+    LeaveState *state = new LeaveState(table, request_list);
 
     for (MembershipRequestList::iterator iter = request_list->begin();
              iter != request_list->end(); iter++) {
@@ -433,49 +511,71 @@ void PeerRibMembershipManager::Leave(BgpTable *table,
 
         IPeerRib *peer_rib = IPeerRibFind(request->ipeer, table);
 
-        if (peer_rib) {
+        if (peer_rib && peer_rib->IsRibOutRegistered()) {
 
             // 
             // Ignore peer ribs which are already in close process
             //
             if (peer_rib->IsRibOutActive()) peer_rib->DeactivateRibOut();
+
+            RibOut *ribout = peer_rib->ribout();
+            state->ribout_leave_map[ribout].set(
+                ribout->GetPeerIndex(request->ipeer));
         }
     }
 
+    bool ribout_leave = !state->ribout_leave_map.empty();
+    int part_count = DB::PartitionCount();
+    state->pending = part_count + (ribout_leave ? 1 : 0);
+
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    for (int part_id = 0; part_id < part_count; part_id++) {
+        scheduler->Enqueue(new RibInWorker(this, state, part_id));
+    }
+
+    if (!ribout_leave)
+        return;
+
     DBTableWalker *walker = db->GetWalker();
     walker->WalkTable(table, NULL,
         // _1: DBTablePartBase, _2: DBEntry
-        boost::bind(&PeerRibMembershipManager::RouteLeave, this, _1, _2, table,
-                    request_list),
+        boost::bind(&PeerRibMembershipManager::RouteLeave, this, _1, _2,
+                    state),
         // _1: DBTableBase
-        boost::bind(&PeerRibMembershipManager::LeaveDone, this, _1,
-                    request_list));
+        boost::bind(&PeerRibMembershipManager::LeavePartDone, this, state));
 }
 
 //
 // Concurrency: Runs in the context of the db walker task triggered from
 // BGP peer membership task.
 //
-// Leave the route from RibIn and from RibOut
+// Leave the route from the RibOuts of the leaving peers
 //
 bool PeerRibMembershipManager::RouteLeave(DBTablePartBase *root,
                                           DBEntryBase *db_entry,
-                                          BgpTable *table,
-                                          MembershipRequestList *request_list) {
-    for (MembershipRequestList::iterator iter = request_list->begin();
-             iter != request_list->end(); iter++) {
-        MembershipRequest *request = iter.operator->();
-
-        IPeerRib  *peer_rib = IPeerRibFind(request->ipeer, table);
-        if (peer_rib == NULL) {
-            continue;
-        }
-        peer_rib->RibOutLeave(root, db_entry, table, request->action_mask);
-        peer_rib->RibInLeave(root, db_entry, table, request->action_mask);
+                                          LeaveState *state) {
+    for (LeaveState::RibOutLeaveMap::const_iterator iter =
+             state->ribout_leave_map.begin();
+         iter != state->ribout_leave_map.end(); iter++) {
+        iter->first->bgp_export()->Leave(root, iter->second, db_entry);
     }
     return true;
 }
 
+//
+// Concurrency: Runs in the context of the DB partition task.
+//
+// Called when the RibOut walk or the RibIn worker of a partition started from
+// the Leave method is done. Once all of them are done, the leave is complete.
+//
+void PeerRibMembershipManager::LeavePartDone(LeaveState *state) {
+    if (state->pending.fetch_and_decrement() != 1)
+        return;
+
+    LeaveDone(state->table, state->request_list);
+    delete state;
+}
+
 void PeerRibMembershipManager::MembershipRequestListDebug(
     const char *function, int line, BgpTable *table,
     MembershipRequestList *request_list) {
@@ -493,10 +593,9 @@ void PeerRibMembershipManager::MembershipRequestListDebug(
 //
 // Concurrency: Runs in the context of the DB partition task.
 //
-// Process the table walk done notification from the DB infrastructure.  This
-// walk was started from the Leave method. Since the table walk is complete,
-// we can post an IPeerRib UNREGISTER_RIB event for the BGP peer membership
-// task.
+// Process the completion of the RibIn and RibOut cleanup started from the
+// Leave method. Since all the state has been cleaned up, we can post an
+// IPeerRib UNREGISTER_RIB event for the BGP peer membership task.
 //
 void PeerRibMembershipManager::LeaveDone(DBTableBase *db,
                                          MembershipRequestList *request_list) {
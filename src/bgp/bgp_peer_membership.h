@@ -124,8 +124,6 @@ public:
     void SetRibInRegistered(bool set);
     void RibInJoin(DBTablePartBase *root, DBEntryBase *db_entry,
                    BgpTable *table, MembershipRequest::Action action_mask);
-    void RibInLeave(DBTablePartBase *root, DBEntryBase *db_entry,
-                    BgpTable *table, MembershipRequest::Action action_mask);
 
     void RegisterRibOut(RibExportPolicy policy);
     void UnregisterRibOut();
@@ -133,11 +131,10 @@ public:
     void DeactivateRibOut();
     bool IsRibOutRegistered() const;
     void SetRibOutRegistered(bool set);
+    RibOut *ribout() { return ribout_; }
 
     void RibOutJoin(DBTablePartBase *root, DBEntryBase *db_entry,
                     BgpTable *table, MembershipRequest::Action action_mask);
-    void RibOutLeave(DBTablePartBase *root, DBEntryBase *db_entry,
-                     BgpTable *table, MembershipRequest::Action action_mask);
     
     void ManagedDelete();
 
@@ -232,6 +229,9 @@ private:
     friend class PeerMembershipMgrTest;
     friend class PeerRibMembershipManagerTest;
 
+    class RibInWorker;
+    struct LeaveState;
+
     typedef std::multimap<const BgpTable *, IPeer *> RibPeerMap;
     typedef std::multimap<const IPeer *, IPeerRib *> PeerRibMap;
 
@@ -242,8 +242,9 @@ private:
 
     void Leave(BgpTable *table, MembershipRequestList *request_list);
     bool RouteLeave(DBTablePartBase *root, DBEntryBase *db_entry,
-                    BgpTable *table, MembershipRequestList *request_list);
+                    LeaveState *state);
     void LeaveDone(DBTableBase *db, MembershipRequestList *request_list);
+    void LeavePartDone(LeaveState *state);
 
     IPeerRibEvent *ProcessRequest(IPeerRibEvent::EventType event_type,
                                   BgpTable *table,
@@ -34,14 +34,41 @@ const BgpPath *BgpRoute::BestPath() const {
 }
 
 //
-// Insert given path and redo path selection.
+// Paths from BGP peers are ordered on peer attributes such as the peer type
+// and the BGP identifier, which can change while the paths are in the route.
+// With two or more such paths the list may no longer be in order, so it has
+// to be sorted in full rather than updated in place.
 //
-void BgpRoute::InsertPath(BgpPath *path) {
-    const Path *prev_front = front();
-
-    insert(path);
+bool BgpRoute::IsPathOrderMutable(const BgpPath *path) const {
+    int count = 0;
+    if (path->GetPeer() && !path->GetPeer()->IsXmppPeer())
+        count++;
+    for (Route::PathList::const_iterator it = GetPathList().begin();
+         it != GetPathList().end(); ++it) {
+        const BgpPath *rt_path = static_cast<const BgpPath *>(it.operator->());
+        if (rt_path == path || !rt_path->GetPeer() ||
+            rt_path->GetPeer()->IsXmppPeer())
+            continue;
+        if (++count > 1)
+            return true;
+    }
+    return false;
+}
 
-    Sort(&BgpTable::PathSelection, prev_front);
+//
+// Insert given path at its position in the sorted path list, or redo path
+// selection if the order of the list may have changed.
+//
+void BgpRoute::InsertPath(BgpPath *path) {
+    if (IsPathOrderMutable(path)) {
+        const Path *prev_front = front();
+        insert(path);
+        Sort(&BgpTable::PathSelection, prev_front);
+    } else {
+        path->set_time_stamp_usecs(UTCTimestampUsec());
+        InsertSorted(path, &BgpTable::PathSelection);
+    }
+    PathIndexInsert(path);
 
     // Update counters.
     BgpTable *table = static_cast<BgpTable *>(get_table());
@@ -50,13 +77,18 @@ void BgpRoute::InsertPath(BgpPath *path) {
 }
 
 //
-// Delete given path and redo path selection.
+// Delete given path. The remaining paths stay sorted, unless their order may
+// have changed, in which case path selection is redone.
 //
 void BgpRoute::DeletePath(BgpPath *path) {
-    const Path *prev_front = front();
-
-    remove(path);
-    Sort(&BgpTable::PathSelection, prev_front);
+    PathIndexRemove(path);
+    if (IsPathOrderMutable(path)) {
+        const Path *prev_front = front();
+        remove(path);
+        Sort(&BgpTable::PathSelection, prev_front);
+    } else {
+        RemoveSorted(path);
+    }
 
     // Update counters.
     BgpTable *table = static_cast<BgpTable *>(get_table());
@@ -67,26 +99,115 @@ void BgpRoute::DeletePath(BgpPath *path) {
 }
 
 //
-// Find path added by peer with given path id and path source.
-// Skips secondary paths.
+// Mark given path stale and move it to its new position in the path list.
+// Attributes of the path are left untouched.
 //
-BgpPath *BgpRoute::FindPath(BgpPath::PathSource src, const IPeer *peer,
-                            uint32_t path_id) {
-    for (Route::PathList::iterator it = GetPathList().begin();
-         it != GetPathList().end(); ++it) {
+// Return true if the path was part of the best (ECMP) set, in which case the
+// route must be notified. Otherwise no listener looks at this path.
+//
+bool BgpRoute::SetPathStale(BgpPath *path) {
+    if (path->IsStale())
+        return false;
+
+    bool in_best_set = (BestPath()->PathCompare(*path, true) == 0);
+    path->SetStale();
+    if (IsPathOrderMutable(path)) {
+        Sort(&BgpTable::PathSelection, front());
+    } else {
+        RepositionSorted(path, &BgpTable::PathSelection);
+    }
+    return in_best_set;
+}
 
-        // Skip secondary paths.
-        if (dynamic_cast<BgpSecondaryPath *>(it.operator->())) {
-            continue;
+size_t BgpRoute::PathKeyHash::operator()(const PathKey &key) const {
+    size_t value = 0;
+    boost::hash_combine(value, static_cast<int>(key.src));
+    boost::hash_combine(value, key.peer);
+    boost::hash_combine(value, key.path_id);
+    return value;
+}
+
+//
+// Add a primary path to the path index, building the index if the route has
+// just grown past kPathIndexMinPaths.
+//
+void BgpRoute::PathIndexInsert(BgpPath *path) {
+    if (!path_index_) {
+        if (GetPathList().size() < kPathIndexMinPaths)
+            return;
+        path_index_.reset(new PathIndex);
+        for (Route::PathList::iterator it = GetPathList().begin();
+             it != GetPathList().end(); ++it) {
+            BgpPath *rt_path = static_cast<BgpPath *>(it.operator->());
+            if (rt_path->IsReplicated())
+                continue;
+
+            // Paths are sorted, so the first path with a key wins.
+            path_index_->insert(std::make_pair(PathKey(rt_path->GetSource(),
+                rt_path->GetPeer(), rt_path->GetPathId()), rt_path));
         }
+        return;
+    }
 
-        BgpPath *path = static_cast<BgpPath *>(it.operator->());
-        if (path->GetPeer() == peer && path->GetPathId() == path_id &&
-            path->GetSource() == src) {
-            return path;
+    if (path->IsReplicated())
+        return;
+
+    // Keep pointing to the best path if there are paths with the same key,
+    // just like the linear search would.
+    std::pair<PathIndex::iterator, bool> result = path_index_->insert(
+        std::make_pair(PathKey(path->GetSource(), path->GetPeer(),
+                               path->GetPathId()), path));
+    if (!result.second &&
+        BgpTable::PathSelection(*path, *result.first->second)) {
+        result.first->second = path;
+    }
+}
+
+//
+// Remove a path from the path index. The index is released once the route
+// shrinks well below kPathIndexMinPaths, so that a route hovering around the
+// threshold does not keep rebuilding it.
+//
+void BgpRoute::PathIndexRemove(BgpPath *path) {
+    if (!path_index_)
+        return;
+
+    if (GetPathList().size() <= kPathIndexMinPaths / 2) {
+        path_index_.reset();
+        return;
+    }
+
+    if (path->IsReplicated())
+        return;
+    PathKey key(path->GetSource(), path->GetPeer(), path->GetPathId());
+    PathIndex::iterator it = path_index_->find(key);
+    if (it == path_index_->end() || it->second != path)
+        return;
+
+    // Point to the next path with the same key, if any, just like the linear
+    // search would find it once this path is gone.
+    for (Route::PathList::iterator pit = GetPathList().begin();
+         pit != GetPathList().end(); ++pit) {
+        BgpPath *rt_path = static_cast<BgpPath *>(pit.operator->());
+        if (rt_path == path || rt_path->IsReplicated())
+            continue;
+        if (PathKey(rt_path->GetSource(), rt_path->GetPeer(),
+                    rt_path->GetPathId()) == key) {
+            it->second = rt_path;
+            return;
         }
     }
-    return NULL;
+    path_index_->erase(it);
+}
+
+//
+// Find path added by peer with given path id and path source.
+// Skips secondary paths.
+//
+BgpPath *BgpRoute::FindPath(BgpPath::PathSource src, const IPeer *peer,
+                            uint32_t path_id) {
+    const BgpRoute *rt = this;
+    return const_cast<BgpPath *>(rt->FindPath(src, peer, path_id));
 }
 
 //
@@ -96,15 +217,21 @@ BgpPath *BgpRoute::FindPath(BgpPath::PathSource src, const IPeer *peer,
 //
 const BgpPath *BgpRoute::FindPath(BgpPath::PathSource src, const IPeer *peer,
                                   uint32_t path_id) const {
+    if (path_index_) {
+        PathIndex::const_iterator it =
+            path_index_->find(PathKey(src, peer, path_id));
+        return (it != path_index_->end() ? it->second : NULL);
+    }
+
     for (Route::PathList::const_iterator it = GetPathList().begin();
          it != GetPathList().end(); ++it) {
+        const BgpPath *path = static_cast<const BgpPath *>(it.operator->());
 
         // Skip secondary paths.
-        if (dynamic_cast<const BgpSecondaryPath *>(it.operator->())) {
+        if (path->IsReplicated()) {
             continue;
         }
 
-        const BgpPath *path = static_cast<const BgpPath *>(it.operator->());
         if (path->GetPeer() == peer && path->GetPathId() == path_id &&
             path->GetSource() == src) {
             return path;
@@ -120,24 +247,11 @@ const BgpPath *BgpRoute::FindPath(BgpPath::PathSource src, const IPeer *peer,
 //
 bool BgpRoute::RemovePath(BgpPath::PathSource src,const IPeer *peer,
                           uint32_t path_id) {
-    for (Route::PathList::iterator it = GetPathList().begin();
-         it != GetPathList().end(); it++) {
-         BgpPath *path = static_cast<BgpPath *>(it.operator->());
-
-        //
-        // Skip secondary paths.
-        //
-        if (dynamic_cast<BgpSecondaryPath *>(it.operator->())) {
-            continue;
-        }
-
-        if (path->GetPeer() == peer && path->GetPathId() == path_id &&
-            path->GetSource() == src) {
-            DeletePath(path);
-            return true;
-        }
-    }
-    return false;
+    BgpPath *path = FindPath(src, peer, path_id);
+    if (!path)
+        return false;
+    DeletePath(path);
+    return true;
 }
 
 //
@@ -156,7 +270,7 @@ bool BgpRoute::RemovePath(const IPeer *peer) {
         //
         // Skip secondary paths.
         //
-        if (dynamic_cast<BgpSecondaryPath *>(it.operator->())) {
+        if (path->IsReplicated()) {
             continue;
         }
 
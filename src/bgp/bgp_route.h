@@ -5,6 +5,9 @@
 #ifndef ctrlplane_bgp_route_h
 #define ctrlplane_bgp_route_h
 
+#include <boost/scoped_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
 #include "route/route.h"
 #include "net/address.h"
 #include "bgp/bgp_path.h"
@@ -24,6 +27,7 @@ public:
 
     void InsertPath(BgpPath *path);
     void DeletePath(BgpPath *path);
+    bool SetPathStale(BgpPath *path);
 
     BgpPath *FindPath(BgpPath::PathSource src, const IPeer *peer,
                       uint32_t path_id);
@@ -56,7 +60,36 @@ public:
 
     // Fill info needed for introspect
     void FillRouteInfo(BgpTable *table, ShowRoute *show_route);
+
 private:
+    // Index of primary paths by source, peer and path id. It is only built
+    // for routes with many paths e.g. anycast and ECMP prefixes, where the
+    // linear scan in FindPath would dominate the processing of an update.
+    struct PathKey {
+        PathKey(BgpPath::PathSource src, const IPeer *peer, uint32_t path_id)
+            : src(src), peer(peer), path_id(path_id) {
+        }
+        bool operator==(const PathKey &rhs) const {
+            return (src == rhs.src && peer == rhs.peer &&
+                    path_id == rhs.path_id);
+        }
+
+        BgpPath::PathSource src;
+        const IPeer *peer;
+        uint32_t path_id;
+    };
+    struct PathKeyHash {
+        size_t operator()(const PathKey &key) const;
+    };
+    typedef boost::unordered_map<PathKey, BgpPath *, PathKeyHash> PathIndex;
+
+    static const size_t kPathIndexMinPaths = 16;
+
+    bool IsPathOrderMutable(const BgpPath *path) const;
+    void PathIndexInsert(BgpPath *path);
+    void PathIndexRemove(BgpPath *path);
+
+    boost::scoped_ptr<PathIndex> path_index_;
 
     DISALLOW_COPY_AND_ASSIGN(BgpRoute);
 };
@@ -43,17 +43,57 @@ struct ShowRouteData : public RequestPipeline::InstData {
 
 class ShowRouteHandler {
 public:
+    // Routes in a response, unless the request asks for fewer.
+    static const uint32_t kPageLimit = 1000;
+    // Routes visited by a stage 1 task before it yields.
+    static const uint32_t kIterLimit = 1024;
+
     struct ShowRouteData : public RequestPipeline::InstData {
+        ShowRouteData() : count(0), resume(false) {}
+
+        // Adds the routes of table, to the last entry if it is the table
+        // that was being walked when the task yielded.
+        void AddRoutes(const string &instance, BgpTable *table,
+                       const vector<ShowRoute> &route_list);
+
         vector<ShowRouteTable> route_table_list;
+        uint32_t count;
+
+        // Position of the walk when the task yields.
+        bool resume;
+        string next_routing_instance;
+        string next_routing_table;
+        string next_prefix;
     };
 
     ShowRouteHandler(const ShowRouteReq *req, int inst_id) :
         req_(req), inst_id_(inst_id) {}
 
-    // Search for interesting prefixes in a given table for specified partition
-    void BuildShowRouteTable(BgpTable *table,
+    // Number of routes in the response. One more route is collected to
+    // find where the next page starts.
+    static uint32_t PageLimit(const ShowRouteReq *req) {
+        BgpSandeshContext *bsc =
+            static_cast<BgpSandeshContext *>(req->client_context());
+        uint32_t limit = bsc->page_limit ? bsc->page_limit : kPageLimit;
+        if (req->get_count() && req->get_count() < limit)
+            return req->get_count();
+        return limit;
+    }
+
+    static uint32_t IterLimit(const ShowRouteReq *req) {
+        BgpSandeshContext *bsc =
+            static_cast<BgpSandeshContext *>(req->client_context());
+        return bsc->iter_limit ? bsc->iter_limit : kIterLimit;
+    }
+
+    // Search for interesting prefixes in a given table for specified
+    // partition, starting at start_prefix if it is not empty. At most
+    // budget routes are visited. Returns the route at which to resume
+    // if the budget runs out, NULL otherwise.
+    BgpRoute *BuildShowRouteTable(BgpTable *table,
+            const string &start_prefix,
             vector<ShowRoute> &route_list,
-            int count) {
+            uint32_t count, uint32_t *budget) {
         DBTablePartition *partition =
             static_cast<DBTablePartition *>(table->GetTablePartition(inst_id_));
         BgpRoute *route;
@@ -63,14 +103,17 @@ public:
             exact_lookup = true;
             auto_ptr<DBEntry> key = table->AllocEntryStr(req_->get_prefix());
             route = static_cast<BgpRoute *>(partition->Find(key.get()));
-        } else if (table->name() == req_->get_start_routing_table()) {
-            auto_ptr<DBEntry> key = table->AllocEntryStr(req_->get_start_prefix());
+        } else if (!start_prefix.empty()) {
+            auto_ptr<DBEntry> key = table->AllocEntryStr(start_prefix);
             route = static_cast<BgpRoute *>(partition->lower_bound(key.get()));
         } else {
             route = static_cast<BgpRoute *>(partition->GetFirst());
         }
-        for (int i = 0; route && (!count || i < count);
-             route = static_cast<BgpRoute *>(partition->GetNext(route)), i++) {
+        for (; route && route_list.size() < count;
+             route = static_cast<BgpRoute *>(partition->GetNext(route))) {
+            if (*budget == 0)
+                return route;
+            (*budget)--;
             if (!MatchPrefix(req_->get_prefix(), route,
                              req_->get_longer_match()))
                 continue;
@@ -80,6 +123,7 @@ public:
             if (exact_lookup)
                 break;
         }
+        return NULL;
     }
 
     bool MatchPrefix(const string &expected_prefix, BgpRoute *route,
@@ -115,6 +159,29 @@ private:
     int inst_id_;
 };
 
+void ShowRouteHandler::ShowRouteData::AddRoutes(const string &instance,
+        BgpTable *table, const vector<ShowRoute> &route_list) {
+    if (route_table_list.empty() ||
+        route_table_list.back().routing_table_name != table->name()) {
+        ShowRouteTable srt;
+        srt.set_routing_instance(instance);
+        srt.set_routing_table_name(table->name());
+
+        // Encode routing-table stats.
+        srt.prefixes = table->Size();
+        srt.primary_paths = table->GetPrimaryPathCount();
+        srt.secondary_paths = table->GetSecondaryPathCount();
+        srt.infeasible_paths = table->GetInfeasiblePathCount();
+        srt.paths = srt.primary_paths + srt.secondary_paths;
+        route_table_list.push_back(srt);
+    }
+    vector<ShowRoute> &routes = route_table_list.back().routes;
+    routes.insert(routes.end(), route_list.begin(), route_list.end());
+}
+
+// Walk the routes of a partition. The task yields after visiting
+// IterLimit() routes so that a large table does not hold up the other
+// db::DBTable tasks, and picks up where it left off when it runs again.
 bool ShowRouteHandler::CallbackS1(const Sandesh *sr,
             const RequestPipeline::PipeSpec ps,
             int stage, int instNum,
@@ -129,6 +196,8 @@ bool ShowRouteHandler::CallbackS1(const Sandesh *sr,
     string exact_routing_table = req->get_routing_table();
     string exact_routing_instance;
     string start_routing_instance;
+    string start_routing_table = req->get_start_routing_table();
+    string start_prefix = req->get_start_prefix();
     if (exact_routing_table.empty()) {
         exact_routing_instance = req->get_routing_instance();
     } else {
@@ -140,45 +209,47 @@ bool ShowRouteHandler::CallbackS1(const Sandesh *sr,
     } else {
         start_routing_instance = exact_routing_instance;
     }
+    if (mydata->resume) {
+        start_routing_instance = mydata->next_routing_instance;
+        start_routing_table = mydata->next_routing_table;
+        start_prefix = mydata->next_prefix;
+        mydata->resume = false;
+    }
 
+    uint32_t limit = PageLimit(req) + 1;
+    uint32_t budget = IterLimit(req);
     RoutingInstanceMgr::NameIterator i =
         rim->name_lower_bound(start_routing_instance);
-    uint32_t count = 0;
     while (i != rim->name_end()) {
         if (!handler.match(exact_routing_instance, i->first))
             break;
         RoutingInstance::RouteTableList::const_iterator j;
-        if (req->get_start_routing_instance() == i->first)
-            j = i->second->GetTables().lower_bound(req->get_start_routing_table());
+        if (start_routing_instance == i->first)
+            j = i->second->GetTables().lower_bound(start_routing_table);
         else
             j = i->second->GetTables().begin();
         for (;j != i->second->GetTables().end(); j++) {
             BgpTable *table = j->second;
             if (!handler.match(req->get_routing_table(), table->name()))
                 continue;
-            ShowRouteTable srt;
-            srt.set_routing_instance(i->first);
-            srt.set_routing_table_name(table->name());
-
-            // Encode routing-table stats.
-            srt.prefixes = table->Size();
-            srt.primary_paths = table->GetPrimaryPathCount();
-            srt.secondary_paths = table->GetSecondaryPathCount();
-            srt.infeasible_paths = table->GetInfeasiblePathCount();
-            srt.paths = srt.primary_paths + srt.secondary_paths;
 
             vector<ShowRoute> route_list;
-            handler.BuildShowRouteTable(table, route_list,
-                req->get_count() ? req->get_count() - count : 0);
-            if (route_list.size()) {
-                srt.set_routes(route_list);
-                mydata->route_table_list.push_back(srt);
+            BgpRoute *next = handler.BuildShowRouteTable(table,
+                table->name() == start_routing_table ? start_prefix : string(),
+                route_list, limit - mydata->count, &budget);
+            if (route_list.size())
+                mydata->AddRoutes(i->first, table, route_list);
+            mydata->count += route_list.size();
+            if (next) {
+                mydata->resume = true;
+                mydata->next_routing_instance = i->first;
+                mydata->next_routing_table = table->name();
+                mydata->next_prefix = next->ToString();
+                return false;
             }
-            count += route_list.size();
-            if (req->get_count() && count >= req->get_count()) break;
+            if (mydata->count >= limit)
+                return true;
         }
-        if (req->get_count() && count >= req->get_count()) break;
-
         i++;
     }
     return true;
@@ -195,16 +266,45 @@ bool ShowRouteTable::operator<(const ShowRouteTable &rhs) const {
 }
 
 template <class T>
-void MergeSort(vector<T> &result, vector<const vector<T> *> &input, int limit);
-
-int MergeValues(ShowRoute &result, vector<const ShowRoute *> &input, int limit) {
-    assert(input.size() == 1);
-    result = *input[0];
-    return 1;
+void MergeSort(vector<T> &result, vector<const vector<T> *> &input, int limit,
+               DB *db);
+
+// Merge the routes of a table from all the partitions in the order of the
+// table's keys. This is the order in which a partition is walked and the
+// next page resumes with a lower_bound on the key, which differs from the
+// order of the prefix strings (e.g. 9.0.0.0/8 is before 10.0.0.0/8).
+static void MergeRoutes(BgpTable *table, vector<ShowRoute> &result,
+                        vector<const vector<ShowRoute> *> &input, int limit) {
+    size_t size = input.size();
+    vector<size_t> index(size, 0);
+    vector<DBEntry *> keys(size, static_cast<DBEntry *>(NULL));
+    while (limit == 0 || result.size() < static_cast<size_t>(limit)) {
+        size_t best = size;
+        for (size_t i = 0; i < size; i++) {
+            if (index[i] == input[i]->size()) continue;
+            if (table && !keys[i])
+                keys[i] = table->AllocEntryStr(
+                    input[i]->at(index[i]).prefix).release();
+            if (best == size) {
+                best = i;
+            } else if (table) {
+                if (keys[i]->IsLess(*keys[best]))
+                    best = i;
+            } else if (input[i]->at(index[i]) < input[best]->at(index[best])) {
+                best = i;
+            }
+        }
+        if (best == size) break;
+        result.push_back(input[best]->at(index[best]));
+        index[best]++;
+        delete keys[best];
+        keys[best] = NULL;
+    }
+    STLDeleteValues(&keys);
 }
 
 int MergeValues(ShowRouteTable &result, vector<const ShowRouteTable *> &input,
-                 int limit) {
+                 int limit, DB *db) {
     vector<const vector<ShowRoute> *> list;
     result.routing_instance = input[0]->routing_instance;
     result.routing_table_name = input[0]->routing_table_name;
@@ -214,19 +314,23 @@ int MergeValues(ShowRouteTable &result, vector<const ShowRouteTable *> &input,
     result.infeasible_paths = input[0]->infeasible_paths;
     result.paths = input[0]->paths;
 
-    int count = 0;
     for (size_t i = 0; i < input.size(); i++) {
         if (input[i]->routes.size())
             list.push_back(&input[i]->routes);
     }
-    MergeSort(result.routes, list, limit ? limit - count : 0);
-    count += result.routes.size();
-    return count;
+
+    // The table may have gone away since the partitions were walked, in
+    // which case the order of the routes no longer matters.
+    BgpTable *table =
+        static_cast<BgpTable *>(db->FindTable(result.routing_table_name));
+    MergeRoutes(table, result.routes, list, limit);
+    return result.routes.size();
 }
 
 // Merge n number of vectors in result. input is a vector of pointers to vector
 template <class T>
-void MergeSort(vector<T> &result, vector<const vector<T> *> &input, int limit) {
+void MergeSort(vector<T> &result, vector<const vector<T> *> &input, int limit,
+               DB *db) {
     size_t size = input.size();
     size_t index[size];
     bzero(index, sizeof(index));
@@ -254,7 +358,7 @@ void MergeSort(vector<T> &result, vector<const vector<T> *> &input, int limit) {
             list.push_back(&input[j]->at(index[j]));
             index[j]++;
         }
-        count += MergeValues(table, list, limit ? limit - count : 0);
+        count += MergeValues(table, list, limit ? limit - count : 0, db);
         result.push_back(table);
     }
 
@@ -274,7 +378,26 @@ bool ShowRouteHandler::CallbackS2(const Sandesh *sr,
         if (old_data.route_table_list.size())
             table_lists.push_back(&old_data.route_table_list);
     }
-    MergeSort(route_table_list, table_lists, req->get_count());
+    BgpSandeshContext *bsc =
+        static_cast<BgpSandeshContext *>(req->client_context());
+    uint32_t limit = PageLimit(req);
+    MergeSort(route_table_list, table_lists, limit + 1,
+              bsc->bgp_server->database());
+
+    // The route after the page is where the next page starts.
+    uint32_t count = 0;
+    for (size_t i = 0; i < route_table_list.size(); i++) {
+        count += route_table_list[i].routes.size();
+    }
+    if (count > limit) {
+        ShowRouteTable &last = route_table_list.back();
+        resp->set_next_routing_instance(last.routing_instance);
+        resp->set_next_routing_table(last.routing_table_name);
+        resp->set_next_prefix(last.routes.back().prefix);
+        last.routes.pop_back();
+        if (last.routes.empty())
+            route_table_list.pop_back();
+    }
     resp->set_tables(route_table_list);
     resp->set_context(req->context());
     resp->Response();
@@ -1369,12 +1492,11 @@ public:
             static_cast<BgpSandeshContext *>(req->client_context());
 
         ShowBgpServerResp *resp = new ShowBgpServerResp;
-        TcpServerSocketStats peer_socket_stats;
-        bsc->bgp_server->session_manager()->GetRxSocketStats(peer_socket_stats);
-        resp->set_rx_socket_stats(peer_socket_stats);
-
-        bsc->bgp_server->session_manager()->GetTxSocketStats(peer_socket_stats);
-        resp->set_tx_socket_stats(peer_socket_stats);
+        TcpServerSocketStats rx_socket_stats, tx_socket_stats;
+        bsc->bgp_server->session_manager()->GetRxTxSocketStats(
+                         rx_socket_stats, tx_socket_stats);
+        resp->set_rx_socket_stats(rx_socket_stats);
+        resp->set_tx_socket_stats(tx_socket_stats);
 
         resp->set_context(req->context());
         resp->Response();
@@ -1407,14 +1529,11 @@ public:
             static_cast<BgpSandeshContext *>(req->client_context());
 
         ShowXmppServerResp *resp = new ShowXmppServerResp;
-        TcpServerSocketStats peer_socket_stats;
-        bsc->xmpp_peer_manager->xmpp_server()->GetRxSocketStats(
-                         peer_socket_stats);
-        resp->set_rx_socket_stats(peer_socket_stats);
-
-        bsc->xmpp_peer_manager->xmpp_server()->GetTxSocketStats(
-                         peer_socket_stats);
-        resp->set_tx_socket_stats(peer_socket_stats);
+        TcpServerSocketStats rx_socket_stats, tx_socket_stats;
+        bsc->xmpp_peer_manager->xmpp_server()->GetRxTxSocketStats(
+                         rx_socket_stats, tx_socket_stats);
+        resp->set_rx_socket_stats(rx_socket_stats);
+        resp->set_tx_socket_stats(tx_socket_stats);
 
         resp->set_context(req->context());
         resp->Response();
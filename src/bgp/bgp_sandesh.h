@@ -12,9 +12,19 @@ class BgpXmppChannelManager;
 class IFMapServer;
 
 struct BgpSandeshContext : public SandeshContext {
+    BgpSandeshContext()
+        : bgp_server(NULL), xmpp_peer_manager(NULL), ifmap_server(NULL),
+          page_limit(0), iter_limit(0) {
+    }
+
     BgpServer *bgp_server;
     BgpXmppChannelManager *xmpp_peer_manager;
     IFMapServer *ifmap_server;
+
+    // Overrides of the introspect page size and of the number of entries
+    // visited per task invocation, for tests. 0 means the default.
+    uint32_t page_limit;
+    uint32_t iter_limit;
 };
 
 #endif /* BGP_SANDESH_H_ */
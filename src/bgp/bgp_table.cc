@@ -10,6 +10,7 @@
 #include <sandesh/sandesh_types.h>
 #include <sandesh/sandesh.h>
 
+#include "db/db.h"
 #include "db/db_table_partition.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_path.h"
@@ -59,7 +60,8 @@ class BgpTable::DeleteActor : public LifetimeActor {
 BgpTable::BgpTable(DB *db, const string &name)
         : RouteTable(db, name),
           rtinstance_(NULL),
-          instance_delete_ref_(this, NULL) {
+          instance_delete_ref_(this, NULL),
+          peer_path_index_(DB::PartitionCount()) {
     primary_path_count_ = 0;
     secondary_path_count_ = 0;
     infeasible_path_count_ = 0;
@@ -71,6 +73,14 @@ BgpTable::~BgpTable() {
     // destroy the DeleteActor which can have its Delete() method be called
     // via the reference.
     instance_delete_ref_.Reset(NULL);
+
+    for (size_t part_id = 0; part_id < peer_path_index_.size(); part_id++) {
+        PeerPathMap &peer_paths = peer_path_index_[part_id];
+        for (PeerPathMap::iterator it = peer_paths.begin();
+             it != peer_paths.end(); ++it) {
+            delete it->second;
+        }
+    }
 }
 
 // TODO: Fix BgpTable creation to pass in instance argument in the constructor
@@ -242,8 +252,6 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
                            const IPeer *peer, DBRequest *req,
                            DBRequest::DBOperation oper, BgpAttrPtr attrs,
                            uint32_t path_id, uint32_t flags, uint32_t label) {
-    bool is_stale = false;
-
     switch (oper) {
     case DBRequest::DB_ENTRY_ADD_CHANGE: {
 
@@ -258,7 +266,6 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
                 (path->GetFlags() != flags) ||
                 (path->GetLabel() != label)) {
                 // Update Attributes and notify (if needed)
-                is_stale = path->IsStale();
                 rt->DeletePath(path);
             } else {
 
@@ -272,15 +279,8 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
         BgpPath *new_path;
         new_path = new BgpPath(peer, path_id, BgpPath::BGP_XMPP, attrs, flags, label);
 
-        //
-        // If the path is being staled (by bringing down the local pref,
-        // mark the same in the new path created
-        //
-        if (is_stale) {
-            new_path->SetStale();
-        }
-
         rt->InsertPath(new_path);
+        PeerPathLink(root, rt, new_path);
         root->Notify(rt);
         break;
     }
@@ -310,6 +310,52 @@ void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
     }
 }
 
+//
+// Link a primary path learnt from a peer into the per-peer path index of the
+// route's partition. The path drops out of the index by itself when it gets
+// deleted.
+//
+void BgpTable::PeerPathLink(DBTablePartBase *root, BgpRoute *rt,
+                            BgpPath *path) {
+    if (!path->GetPeer())
+        return;
+
+    PeerPathMap &peer_paths = peer_path_index_[root->index()];
+    PeerPathMap::iterator it = peer_paths.find(path->GetPeer());
+    if (it == peer_paths.end()) {
+        it = peer_paths.insert(
+            make_pair(path->GetPeer(), new PeerPathList())).first;
+    }
+    path->peer_path_route_ = rt;
+    it->second->push_back(*path);
+}
+
+//
+// Return the paths learnt from the given peer in the given partition.
+//
+// Concurrency: must be called from the task of the given partition.
+//
+BgpTable::PeerPathList *BgpTable::PeerPathListFind(int part_id,
+                                                   const IPeer *peer) {
+    PeerPathMap &peer_paths = peer_path_index_[part_id];
+    PeerPathMap::iterator it = peer_paths.find(peer);
+    return (it != peer_paths.end() ? it->second : NULL);
+}
+
+//
+// Release the path list for the given peer if it no longer has any paths.
+//
+// Concurrency: must be called from the task of the given partition.
+//
+void BgpTable::PeerPathListPurge(int part_id, const IPeer *peer) {
+    PeerPathMap &peer_paths = peer_path_index_[part_id];
+    PeerPathMap::iterator it = peer_paths.find(peer);
+    if (it == peer_paths.end() || !it->second->empty())
+        return;
+    delete it->second;
+    peer_paths.erase(it);
+}
+
 void BgpTable::Input(DBTablePartition *root, DBClient *client,
                      DBRequest *req) {
     const IPeer *peer =
@@ -346,9 +392,9 @@ void BgpTable::Input(DBTablePartition *root, DBClient *client,
          it != rt->GetPathList().end(); ++it) {
 
         // Skip secondary paths.
-        if (dynamic_cast<BgpSecondaryPath *>(it.operator->())) continue;
-
         BgpPath *path = static_cast<BgpPath *>(it.operator->());
+        if (path->IsReplicated()) continue;
+
         if (path->GetPeer() == peer &&
                 path->GetSource() == BgpPath::BGP_XMPP) {
             deleted_paths.insert(make_pair(path, true));
@@ -369,10 +415,11 @@ void BgpTable::Input(DBTablePartition *root, DBClient *client,
             path = rt->FindPath(BgpPath::BGP_XMPP, peer,
                                 nexthop.address_.to_v4().to_ulong());
 
+            //
+            // A stale path that is learnt again gets replaced by a new path
+            // below, since the request flags never include the stale flag.
+            //
             if (path && req->oper != DBRequest::DB_ENTRY_DELETE) {
-                if (path->IsStale()) {
-                    path->ResetStale();
-                }
                 deleted_paths.erase(path);
             }
             if (data && data->attrs() && count > 0) {
@@ -6,6 +6,8 @@
 #define ctrlplane_bgp_table_h
 
 #include <map>
+#include <vector>
+#include <boost/intrusive/list.hpp>
 #include <tbb/atomic.h>
 
 #include "base/lifetime.h"
@@ -29,6 +31,15 @@ class BgpTable : public RouteTable {
 public:
     typedef std::map<RibExportPolicy, RibOut *> RibOutMap;
 
+    // Per-peer index of the primary BGP_XMPP paths in a table partition.
+    // It lets RibIn close, stale and sweep visit only the paths owned by
+    // a peer instead of walking every route in the table.
+    typedef boost::intrusive::member_hook<BgpPath, BgpPath::PeerPathHook,
+        &BgpPath::peer_path_node_> PeerPathMember;
+    typedef boost::intrusive::list<BgpPath, PeerPathMember,
+        boost::intrusive::constant_time_size<false> > PeerPathList;
+    typedef std::map<const IPeer *, PeerPathList *> PeerPathMap;
+
     struct RequestKey : DBRequestKey {
         virtual const IPeer *GetPeer() const = 0;
     };
@@ -111,6 +122,9 @@ public:
     LifetimeActor *deleter();
     size_t GetPendingRiboutsCount(size_t &markers);
 
+    PeerPathList *PeerPathListFind(int part_id, const IPeer *peer);
+    void PeerPathListPurge(int part_id, const IPeer *peer);
+
     void UpdatePathCount(const BgpPath *path, int count);
     const uint64_t GetPrimaryPathCount() const { return primary_path_count_; }
     const uint64_t GetSecondaryPathCount() const {
@@ -125,6 +139,8 @@ private:
     friend class BgpTableTest;
     virtual BgpRoute *TableFind(DBTablePartition *rtp,
             const DBRequestKey *prefix) = 0;
+    void PeerPathLink(DBTablePartBase *root, BgpRoute *rt, BgpPath *path);
+
     RoutingInstance *rtinstance_;
     RibOutMap ribout_map_;
 
@@ -134,6 +150,9 @@ private:
     tbb::atomic<uint64_t> secondary_path_count_;
     tbb::atomic<uint64_t> infeasible_path_count_;
 
+    // Indexed by partition id, only accessed from that partition's task
+    std::vector<PeerPathMap> peer_path_index_;
+
     DISALLOW_COPY_AND_ASSIGN(BgpTable);
 };
 
@@ -113,6 +113,7 @@ BgpRoute *EnetTable::RouteReplicate(BgpServer *server,
                                       src_path->GetPathId());
     if (dest_path != NULL) {
         if ((new_attr != dest_path->GetAttr()) ||
+            (src_path->GetFlags() != dest_path->GetFlags()) ||
             (src_path->GetLabel() != dest_path->GetLabel())) {
             assert(dest_route->RemoveSecondaryPath(src_rt,
                        src_path->GetSource(), src_path->GetPeer(),
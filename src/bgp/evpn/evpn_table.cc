@@ -114,6 +114,7 @@ BgpRoute *EvpnTable::RouteReplicate(BgpServer *server,
             src_path->GetPathId());
     if (dest_path != NULL) {
         if ((new_attr != dest_path->GetAttr()) ||
+            (src_path->GetFlags() != dest_path->GetFlags()) ||
             (src_path->GetLabel() != dest_path->GetLabel())) {
             // Update Attributes and notify (if needed)
             assert(dest_route->RemoveSecondaryPath(src_rt,
@@ -41,6 +41,7 @@
 #include "control-node/test/network_agent_mock.h"
 #include "io/test/event_manager_test.h"
 #include "db/db.h"
+#include "db/db_table_walker.h"
 #include "net/bgp_af.h"
 #include "schema/xmpp_unicast_types.h"
 #include "testing/gunit.h"
@@ -1044,12 +1045,20 @@ TEST_P(BgpPeerCloseTest, ClosePeersWithRouteStalingAndDelete) {
         TASK_UTIL_EXPECT_FALSE(peer->Peer()->IsReady());
     }
 
+    //
+    // RibIn deletion of the stale paths is driven off the per-peer path
+    // index and must not need any table walk
+    //
+    DBTableWalker *walker = server_->database()->GetWalker();
+    uint64_t walk_count = walker->walk_request_count();
+
     CallStaleTimer(false);
 
     // Assert that all ribins have been deleted correctly
     WaitForIdle();
     VerifyPeers();
     VerifyRoutes(0);
+    EXPECT_EQ(walk_count, walker->walk_request_count());
 }
 
 TEST_P(BgpPeerCloseTest, ClosePeersWithRouteStaling) {
@@ -1067,16 +1076,24 @@ TEST_P(BgpPeerCloseTest, ClosePeersWithRouteStaling) {
 
     SetPeerCloseGraceful(true);
 
-    // Trigger ribin deletes
-    BOOST_FOREACH(BgpNullPeer *npeer, peers_) { npeer->peer()->Close(); }
+    // Trigger ribin deletes. Close the xmpp peers first, so that the
+    // attributes of their paths are released before the bgp paths are
+    // staled.
     XmppPeerClose();
 
     BOOST_FOREACH(test::NetworkAgentMock *agent, xmpp_agents_) {
         TASK_UTIL_EXPECT_FALSE(agent->IsEstablished());
     }
+    task_util::WaitForIdle();
+
+    // Staling paths must neither locate new attributes nor release any
+    size_t attr_count = server_->attr_db()->Size();
+    BOOST_FOREACH(BgpNullPeer *npeer, peers_) { npeer->peer()->Close(); }
 
     // Verify that routes are still there (staled)
     VerifyRoutes(n_routes_);
+    task_util::WaitForIdle();
+    EXPECT_EQ(attr_count, server_->attr_db()->Size());
     // VerifyXmppRoutes(n_instances_ * n_routes_);
 
     BOOST_FOREACH(test::NetworkAgentMock *agent, xmpp_agents_) {
@@ -20,6 +20,7 @@
 #include "bgp/test/bgp_server_test_util.h"
 #include "db/db.h"
 #include "db/db_partition.h"
+#include "db/db_table_walker.h"
 #include "io/test/event_manager_test.h"
 #include "testing/gunit.h"
 
@@ -373,6 +374,33 @@ TEST_F(PeerMembershipMgrTest, MultiplePeersSingleTable) {
     TASK_UTIL_EXPECT_TRUE(size() == 0);
 }
 
+// Peers leaving the same table together are cleaned up with a single walk.
+TEST_F(PeerMembershipMgrTest, MultiplePeersLeaveSingleWalk) {
+    PeerRibMembershipManager *mgr = server()->membership_mgr();
+    DBTableWalker *walker = server_->database()->GetWalker();
+
+    // Make sure we start out clean.
+    ASSERT_EQ(size(), 0);
+
+    // Register all peers.
+    mgr->Register(peers_[0], red_tbl_, peers_[0]->GetRibExportPolicy(), -1);
+    mgr->Register(peers_[1], red_tbl_, peers_[1]->GetRibExportPolicy(), -1);
+    mgr->Register(peers_[2], red_tbl_, peers_[2]->GetRibExportPolicy(), -1);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_TRUE(size() == 3);
+
+    // Queue up the unregister of all peers so they are processed together.
+    uint64_t walk_count = walker->walk_request_count();
+    static_cast<PeerRibMembershipManagerTest *>(mgr)->SetQueueDisable(true);
+    mgr->Unregister(peers_[0], red_tbl_);
+    mgr->Unregister(peers_[1], red_tbl_);
+    mgr->Unregister(peers_[2], red_tbl_);
+    static_cast<PeerRibMembershipManagerTest *>(mgr)->SetQueueDisable(false);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_TRUE(size() == 0);
+    EXPECT_EQ(walk_count + 1, walker->walk_request_count());
+}
+
 // Delete a peer with membership request pending
 TEST_F(PeerMembershipMgrTest, PeerDeleteWithPendingMembershipRequestPending) {
     PeerRibMembershipManager *mgr = server()->membership_mgr();
@@ -20,6 +20,10 @@
 
 class BgpPeerMock : public IPeer {
 public:
+    explicit BgpPeerMock(bool is_xmpp = false, uint32_t bgp_identifier = 0)
+        : is_xmpp_(is_xmpp), bgp_identifier_(bgp_identifier) {
+    }
+
     virtual std::string ToString() const {
         return "test-peer";
     }
@@ -41,7 +45,7 @@ public:
     virtual bool IsReady() const {
         return true;
     }
-    virtual bool IsXmppPeer() const { return false; }
+    virtual bool IsXmppPeer() const { return is_xmpp_; }
     virtual void Close() {
     }
     virtual const std::string GetStateName() const {
@@ -52,7 +56,10 @@ public:
         return BgpProto::IBGP;
     }
     virtual uint32_t bgp_identifier() const {
-        return 0;
+        return bgp_identifier_;
+    }
+    void set_bgp_identifier(uint32_t bgp_identifier) {
+        bgp_identifier_ = bgp_identifier;
     }
     virtual void UpdateRefCount(int count) { }
     virtual tbb::atomic<int> GetRefCount() const {
@@ -60,7 +67,10 @@ public:
         count = 0;
         return count;
     }
+
 private:
+    bool is_xmpp_;
+    uint32_t bgp_identifier_;
 };
 
 class BgpRouteTest : public ::testing::Test {
@@ -134,6 +144,195 @@ TEST_F(BgpRouteTest, Paths) {
     route.RemovePath(&peer);
 }
 
+//
+// Add enough paths to build the path index and verify that the path list stays
+// sorted and that FindPath returns the right path as paths come and go.
+//
+TEST_F(BgpRouteTest, ManyPaths) {
+    BgpAttrSpec spec;
+    BgpAttrDB *db = server_.attr_db();
+    BgpPeerMock peer(true);
+    Ip4Prefix prefix;
+    InetRoute route(prefix);
+
+    static const int kPathCount = 64;
+    std::vector<BgpPath *> paths;
+    for (int idx = 0; idx < kPathCount; idx++) {
+        BgpAttr *attr = new BgpAttr(db, spec);
+        attr->set_local_pref(100 + (idx * 7) % kPathCount);
+        BgpPath *path = new BgpPath(&peer, idx + 1, BgpPath::BGP_XMPP,
+                                    db->Locate(attr), 0, 0);
+        route.InsertPath(path);
+        paths.push_back(path);
+    }
+
+    EXPECT_EQ(kPathCount, static_cast<int>(route.count()));
+    for (int idx = 0; idx < kPathCount; idx++) {
+        EXPECT_EQ(paths[idx],
+                  route.FindPath(BgpPath::BGP_XMPP, &peer, idx + 1));
+    }
+    EXPECT_TRUE(route.FindPath(BgpPath::BGP_XMPP, &peer, 0) == NULL);
+    EXPECT_TRUE(route.FindPath(BgpPath::StaticRoute, &peer, 1) == NULL);
+
+    const BgpPath *prev = NULL;
+    for (Route::PathList::const_iterator it = route.GetPathList().begin();
+         it != route.GetPathList().end(); ++it) {
+        const BgpPath *path = static_cast<const BgpPath *>(it.operator->());
+        if (prev) {
+            EXPECT_GE(prev->GetAttr()->local_pref(),
+                      path->GetAttr()->local_pref());
+        }
+        prev = path;
+    }
+
+    // Remove every other path and verify lookups and ordering again.
+    for (int idx = 0; idx < kPathCount; idx += 2) {
+        EXPECT_TRUE(route.RemovePath(BgpPath::BGP_XMPP, &peer, idx + 1));
+    }
+    EXPECT_EQ(kPathCount / 2, static_cast<int>(route.count()));
+    for (int idx = 0; idx < kPathCount; idx++) {
+        const BgpPath *path =
+            route.FindPath(BgpPath::BGP_XMPP, &peer, idx + 1);
+        EXPECT_EQ(idx % 2 ? paths[idx] : NULL, path);
+    }
+    EXPECT_EQ(static_cast<uint32_t>(100 + kPathCount - 1),
+              route.BestPath()->GetAttr()->local_pref());
+
+    // Remove the rest, shrinking the route below the index threshold.
+    route.RemovePath(&peer);
+    EXPECT_EQ(0, static_cast<int>(route.count()));
+    EXPECT_TRUE(route.FindPath(BgpPath::BGP_XMPP, &peer, 2) == NULL);
+}
+
+//
+// A stale path must be least preferred without any change to its attributes.
+//
+TEST_F(BgpRouteTest, StalePath) {
+    BgpAttrSpec spec;
+    BgpAttrDB *db = server_.attr_db();
+    BgpPeerMock peer;
+    Ip4Prefix prefix;
+    InetRoute route(prefix);
+
+    BgpAttr *attr1 = new BgpAttr(db, spec);
+    attr1->set_local_pref(200);
+    BgpAttrPtr attr1_ptr = db->Locate(attr1);
+    BgpPath *path1 = new BgpPath(&peer, 1, BgpPath::BGP_XMPP, attr1_ptr, 0, 0);
+    route.InsertPath(path1);
+
+    BgpAttr *attr2 = new BgpAttr(db, spec);
+    attr2->set_local_pref(100);
+    BgpPath *path2 = new BgpPath(&peer, 2, BgpPath::BGP_XMPP,
+                                 db->Locate(attr2), 0, 0);
+    route.InsertPath(path2);
+    EXPECT_EQ(path1, route.BestPath());
+
+    // Best path changes, so the route needs to be notified.
+    EXPECT_TRUE(route.SetPathStale(path1));
+    EXPECT_TRUE(path1->IsStale());
+    EXPECT_EQ(attr1_ptr.get(), path1->GetAttr());
+    EXPECT_EQ(path2, route.BestPath());
+
+    // Marking a path stale again is a no-op.
+    EXPECT_FALSE(route.SetPathStale(path1));
+
+    // Path is not part of the best set, so there is nothing to notify.
+    BgpAttr *attr3 = new BgpAttr(db, spec);
+    attr3->set_local_pref(50);
+    BgpPath *path3 = new BgpPath(&peer, 3, BgpPath::BGP_XMPP,
+                                 db->Locate(attr3), 0, 0);
+    route.InsertPath(path3);
+    EXPECT_FALSE(route.SetPathStale(path3));
+    EXPECT_EQ(path2, route.BestPath());
+
+    route.RemovePath(&peer);
+    EXPECT_EQ(0, static_cast<int>(route.count()));
+}
+
+//
+// Paths from BGP peers are ordered on the BGP identifier of the peer, which
+// can change while the paths are in the route. The path list must still end
+// up in order when the route changes.
+//
+TEST_F(BgpRouteTest, PeerIdentifierChange) {
+    BgpAttrSpec spec;
+    BgpAttrDB *db = server_.attr_db();
+    BgpPeerMock peer1(false, 1), peer2(false, 2), peer3(false, 5);
+    Ip4Prefix prefix;
+    InetRoute route(prefix);
+    BgpAttrPtr attr = db->Locate(new BgpAttr(db, spec));
+
+    BgpPath *path1 = new BgpPath(&peer1, BgpPath::BGP_XMPP, attr, 0, 0);
+    route.InsertPath(path1);
+    BgpPath *path2 = new BgpPath(&peer2, BgpPath::BGP_XMPP, attr, 0, 0);
+    route.InsertPath(path2);
+    EXPECT_EQ(path1, route.BestPath());
+
+    peer1.set_bgp_identifier(3);
+    BgpPath *path3 = new BgpPath(&peer3, BgpPath::BGP_XMPP, attr, 0, 0);
+    route.InsertPath(path3);
+
+    std::vector<const BgpPath *> expected;
+    expected.push_back(path2);
+    expected.push_back(path1);
+    expected.push_back(path3);
+    std::vector<const BgpPath *> actual;
+    for (Route::PathList::const_iterator it = route.GetPathList().begin();
+         it != route.GetPathList().end(); ++it) {
+        actual.push_back(static_cast<const BgpPath *>(it.operator->()));
+    }
+    EXPECT_EQ(expected, actual);
+
+    // Best path changes again when the identifier change is followed by a
+    // delete.
+    peer3.set_bgp_identifier(0);
+    EXPECT_TRUE(route.RemovePath(BgpPath::BGP_XMPP, &peer1, 0));
+    EXPECT_EQ(path3, route.BestPath());
+
+    route.RemovePath(&peer2);
+    route.RemovePath(&peer3);
+    EXPECT_EQ(0, static_cast<int>(route.count()));
+}
+
+//
+// With the path index built, removing one of two paths with the same key
+// leaves the other one to be found.
+//
+TEST_F(BgpRouteTest, PathIndexDuplicateKey) {
+    BgpAttrSpec spec;
+    BgpAttrDB *db = server_.attr_db();
+    BgpPeerMock peer(true);
+    Ip4Prefix prefix;
+    InetRoute route(prefix);
+
+    for (int idx = 0; idx < 16; idx++) {
+        BgpAttr *attr = new BgpAttr(db, spec);
+        attr->set_local_pref(100);
+        route.InsertPath(new BgpPath(&peer, idx + 1, BgpPath::BGP_XMPP,
+                                     db->Locate(attr), 0, 0));
+    }
+
+    BgpAttr *attr1 = new BgpAttr(db, spec);
+    attr1->set_local_pref(50);
+    BgpPath *path1 = new BgpPath(&peer, 100, BgpPath::BGP_XMPP,
+                                 db->Locate(attr1), 0, 0);
+    route.InsertPath(path1);
+    BgpAttr *attr2 = new BgpAttr(db, spec);
+    attr2->set_local_pref(200);
+    BgpPath *path2 = new BgpPath(&peer, 100, BgpPath::BGP_XMPP,
+                                 db->Locate(attr2), 0, 0);
+    route.InsertPath(path2);
+    EXPECT_EQ(path2, route.FindPath(BgpPath::BGP_XMPP, &peer, 100));
+
+    route.DeletePath(path2);
+    EXPECT_EQ(path1, route.FindPath(BgpPath::BGP_XMPP, &peer, 100));
+    route.DeletePath(path1);
+    EXPECT_TRUE(route.FindPath(BgpPath::BGP_XMPP, &peer, 100) == NULL);
+
+    route.RemovePath(&peer);
+    EXPECT_EQ(0, static_cast<int>(route.count()));
+}
+
 }  // namespace
 
 static void SetUp() {
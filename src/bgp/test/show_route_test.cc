@@ -67,6 +67,9 @@ public:
 
 protected:
     static bool validate_done_;
+    static string next_routing_instance_;
+    static string next_routing_table_;
+    static string next_prefix_;
 
     virtual void SetUp() {
         evm_.reset(new EventManager());
@@ -286,6 +289,25 @@ protected:
         validate_done_ = true;
     }
 
+    static void ValidateShowRoutePageSandeshResponse(Sandesh *sandesh,
+        vector<int> &result, const string &next_table,
+        const string &next_prefix, int called_from_line) {
+        ShowRouteResp *resp = dynamic_cast<ShowRouteResp *>(sandesh);
+        EXPECT_NE((ShowRouteResp *)NULL, resp);
+        cout << "From line number: " << called_from_line << endl;
+        EXPECT_EQ(result.size(), resp->get_tables().size());
+        for (size_t i = 0;
+             i < min(result.size(), resp->get_tables().size()); i++) {
+            EXPECT_EQ(result[i], resp->get_tables()[i].routes.size());
+        }
+        EXPECT_EQ(next_table, resp->get_next_routing_table());
+        EXPECT_EQ(next_prefix, resp->get_next_prefix());
+        next_routing_instance_ = resp->get_next_routing_instance();
+        next_routing_table_ = resp->get_next_routing_table();
+        next_prefix_ = resp->get_next_prefix();
+        validate_done_ = true;
+    }
+
     static void ValidateShowRouteVrfSandeshResponse(Sandesh *sandesh,
         const string vrf, const char *prefix, int called_from_line) {
         ShowRouteVrfResp *resp = dynamic_cast<ShowRouteVrfResp *>(sandesh);
@@ -306,6 +328,9 @@ protected:
 };
 
 bool ShowRouteTestBase::validate_done_;
+string ShowRouteTestBase::next_routing_instance_;
+string ShowRouteTestBase::next_routing_table_;
+string ShowRouteTestBase::next_prefix_;
 
 class ShowRouteTest1 : public ShowRouteTestBase {
 };
@@ -1119,6 +1144,72 @@ TEST_F(ShowRouteVrfTest, Prefix4) {
     }
 }
 
+// Walk all the routes a page at a time, with the tasks yielding after
+// every route. The pages follow the order of the table's keys, which puts
+// 9.0.0.0/8 before 10.0.0.0/8 although its prefix string sorts after.
+TEST_F(ShowRouteTest2, Page) {
+    BgpSandeshContext sandesh_context;
+    sandesh_context.bgp_server = a_.get();
+    sandesh_context.page_limit = 2;
+    sandesh_context.iter_limit = 1;
+    Sandesh::set_client_context(&sandesh_context);
+
+    AddInetRoute("9.0.0.0/8", peers_[0], "blue");
+    AddInetRoute("10.0.0.0/8", peers_[1], "blue");
+
+    struct {
+        vector<int> result;
+        string next_table;
+        string next_prefix;
+    } pages[] = {
+        { list_of(2), "blue.inet.0", "192.168.11.0/24" },
+        { list_of(2), "blue.inet.0", "192.168.13.0/24" },
+        { list_of(1)(1), "red.inet.0", "192.168.12.0/24" },
+        { list_of(2), "", "" },
+    };
+
+    next_routing_instance_.clear();
+    next_routing_table_.clear();
+    next_prefix_.clear();
+    for (size_t i = 0; i < sizeof(pages) / sizeof(pages[0]); i++) {
+        ShowRouteReq *show_req = new ShowRouteReq;
+        Sandesh::set_response_callback(
+            boost::bind(ValidateShowRoutePageSandeshResponse, _1,
+                        pages[i].result, pages[i].next_table,
+                        pages[i].next_prefix, __LINE__));
+        show_req->set_start_routing_instance(next_routing_instance_);
+        show_req->set_start_routing_table(next_routing_table_);
+        show_req->set_start_prefix(next_prefix_);
+        validate_done_ = false;
+        show_req->HandleRequest();
+        show_req->Release();
+        TASK_UTIL_EXPECT_EQ(true, validate_done_);
+    }
+
+    DeleteInetRoute("9.0.0.0/8", peers_[0], 4, "blue");
+    DeleteInetRoute("10.0.0.0/8", peers_[1], 3, "blue");
+}
+
+// A count below the page size limits the page.
+TEST_F(ShowRouteTest2, PageCount) {
+    BgpSandeshContext sandesh_context;
+    sandesh_context.bgp_server = a_.get();
+    sandesh_context.page_limit = 4;
+    Sandesh::set_client_context(&sandesh_context);
+
+    ShowRouteReq *show_req = new ShowRouteReq;
+    vector<int> result = list_of(1);
+    Sandesh::set_response_callback(
+        boost::bind(ValidateShowRoutePageSandeshResponse, _1, result,
+                    string("blue.inet.0"), string("192.168.12.0/24"),
+                    __LINE__));
+    show_req->set_count(1);
+    validate_done_ = false;
+    show_req->HandleRequest();
+    show_req->Release();
+    TASK_UTIL_EXPECT_EQ(true, validate_done_);
+}
+
 class TestEnvironment : public ::testing::Environment {
     virtual ~TestEnvironment() { }
 };
@@ -382,6 +382,10 @@ int main(int argc, char *argv[]) {
     }
     TaskScheduler::Initialize();
     ControlNode::SetDefaultSchedulingPolicy();
+
+    // Must be done before any TCP server is created.
+    evm.StartSessionThreads(options.io_threads());
+
     BgpSandeshContext sandesh_context;
 
     if (options.discovery_server().empty()) {
@@ -85,6 +85,8 @@ void Options::Initialize(EventManager &evm,
         ("DEFAULT.http_server_port",
              opt::value<uint16_t>()->default_value(default_http_server_port),
              "Sandesh HTTP listener port")
+        ("DEFAULT.io_threads", opt::value<int>()->default_value(0),
+             "Number of threads for TCP session IO, 0 to use the main thread")
 
         ("DEFAULT.log_category",
              opt::value<string>()->default_value(log_category_),
@@ -202,6 +204,12 @@ bool Options::Process(int argc, char *argv[],
     GetOptValue<uint16_t>(var_map, http_server_port_,
                           "DEFAULT.http_server_port");
 
+    GetOptValue<int>(var_map, io_threads_, "DEFAULT.io_threads");
+    if (io_threads_ < 0) {
+        cout << "Invalid number of IO threads: " << io_threads_ << endl;
+        return false;
+    }
+
     GetOptValue<string>(var_map, log_category_, "DEFAULT.log_category");
     GetOptValue<string>(var_map, log_file_, "DEFAULT.log_file");
     GetOptValue<int>(var_map, log_files_count_, "DEFAULT.log_files_count");
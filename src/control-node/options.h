@@ -27,6 +27,7 @@ public:
     const std::string log_file() const { return log_file_; }
     const int log_files_count() const { return log_files_count_; }
     const long log_file_size() const { return log_file_size_; }
+    const int io_threads() const { return io_threads_; }
     const std::string log_level() const { return log_level_; }
     const bool log_local() const { return log_local_; }
     const std::string ifmap_server_url() const { return ifmap_server_url_; }
@@ -61,6 +62,7 @@ private:
     std::string log_file_;
     int log_files_count_;
     long log_file_size_;
+    int io_threads_;
     std::string log_level_;
     bool log_local_;
     std::string ifmap_server_url_;
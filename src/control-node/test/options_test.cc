@@ -57,6 +57,7 @@ TEST_F(OptionsTest, NoArguments) {
     EXPECT_EQ(options_.hostname(), hostname_);
     EXPECT_EQ(options_.host_ip(), host_ip_);
     EXPECT_EQ(options_.http_server_port(), default_http_server_port);
+    EXPECT_EQ(options_.io_threads(), 0);
     EXPECT_EQ(options_.log_category(), "");
     EXPECT_EQ(options_.log_disable(), false);
     EXPECT_EQ(options_.log_file(), "<stdout>");
@@ -93,6 +94,7 @@ TEST_F(OptionsTest, DefaultConfFile) {
     EXPECT_EQ(options_.hostname(), hostname_);
     EXPECT_EQ(options_.host_ip(), host_ip_);
     EXPECT_EQ(options_.http_server_port(), default_http_server_port);
+    EXPECT_EQ(options_.io_threads(), 0);
     EXPECT_EQ(options_.log_category(), "");
     EXPECT_EQ(options_.log_disable(), false);
     EXPECT_EQ(options_.log_file(), "<stdout>");
@@ -131,6 +133,7 @@ TEST_F(OptionsTest, OverrideStringFromCommandLine) {
     EXPECT_EQ(options_.hostname(), hostname_);
     EXPECT_EQ(options_.host_ip(), host_ip_);
     EXPECT_EQ(options_.http_server_port(), default_http_server_port);
+    EXPECT_EQ(options_.io_threads(), 0);
     EXPECT_EQ(options_.log_category(), "");
     EXPECT_EQ(options_.log_disable(), false);
     EXPECT_EQ(options_.log_file(), "test.log"); // Overridden from cmd line.
@@ -169,6 +172,7 @@ TEST_F(OptionsTest, OverrideBooleanFromCommandLine) {
     EXPECT_EQ(options_.hostname(), hostname_);
     EXPECT_EQ(options_.host_ip(), host_ip_);
     EXPECT_EQ(options_.http_server_port(), default_http_server_port);
+    EXPECT_EQ(options_.io_threads(), 0);
     EXPECT_EQ(options_.log_category(), "");
     EXPECT_EQ(options_.log_disable(), false);
     EXPECT_EQ(options_.log_file(), "<stdout>");
@@ -195,6 +199,7 @@ TEST_F(OptionsTest, CustomConfigFile) {
         "hostip=1.2.3.4\n"
         "hostname=test\n"
         "http_server_port=800\n"
+        "io_threads=4\n"
         "log_category=bgp\n"
         "log_disable=1\n"
         "log_file=test.log\n"
@@ -245,6 +250,7 @@ TEST_F(OptionsTest, CustomConfigFile) {
     EXPECT_EQ(options_.hostname(), "test");
     EXPECT_EQ(options_.host_ip(), "1.2.3.4");
     EXPECT_EQ(options_.http_server_port(), 800);
+    EXPECT_EQ(options_.io_threads(), 4);
     EXPECT_EQ(options_.log_category(), "bgp");
     EXPECT_EQ(options_.log_disable(), true);
     EXPECT_EQ(options_.log_file(), "test.log");
@@ -9,7 +9,7 @@
 using namespace std;
 
 HttpRequest::HttpRequest() :
-    method_(static_cast<http_method>(-1)) {
+    method_(static_cast<http_method>(-1)), keep_alive_(false) {
 }
 
 string HttpRequest::ToString() const {
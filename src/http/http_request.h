@@ -25,6 +25,10 @@ public:
     void PushHeader(const std::string &key, const std::string &value) {
 	headers_.insert(make_pair(key, value));
     }
+    // Whether the connection stays open after the response, as negotiated
+    // by the HTTP version and the Connection header of the request.
+    void SetKeepAlive(bool keep_alive) { keep_alive_ = keep_alive; }
+    bool KeepAlive() const { return keep_alive_; }
 
     std::string ToString() const;
 
@@ -35,6 +39,7 @@ private:
     http_method method_;
     std::string url_;
     HeaderMap headers_;
+    bool keep_alive_;
 };
 
 #endif
@@ -5,6 +5,7 @@
 #include "http/http_session.h"
 
 #include <map>
+#include <vector>
 #include <boost/bind.hpp>
 #include <cstdio>
 
@@ -25,36 +26,34 @@ HttpSession::map_type * HttpSession::context_map_ = 0;
 tbb::mutex HttpSession::mutex_;
 tbb::atomic<long> HttpSession::task_count_;
 
-// Input processing context
+// Input processing context. The parser is fed the data as it is read, so
+// a request can span reads and a read can carry several pipelined requests.
 class HttpSession::RequestBuilder {
 public:
-    RequestBuilder() : complete_(false) {
-        parser_.data = this;
-        Clear();
-    }
+    typedef std::vector<HttpRequest *> RequestList;
 
-    void Clear() {
+    RequestBuilder() : requests_(NULL) {
         http_parser_init(&parser_, HTTP_REQUEST);
+        parser_.data = this;
         request_.reset(new HttpRequest());
-        complete_ = false;
-        header_key_.clear();
-        header_value_.clear();
-    }
-    size_t Parse(const u_int8_t *data, size_t datalen) {
-        size_t nparsed = 
-            http_parser_execute(&parser_, &settings_,
-                    reinterpret_cast<const char *>(data), datalen);
-        return nparsed;
     }
 
-    bool complete() const { return complete_; }
+    // Appends the requests completed by the data to requests, transferring
+    // their ownership. Returns false if the data is not a valid request.
+    bool Parse(const u_int8_t *data, size_t datalen, RequestList *requests) {
+        requests_ = requests;
+        http_parser_execute(&parser_, &settings_,
+                            reinterpret_cast<const char *>(data), datalen);
+        requests_ = NULL;
+        enum http_errno error = HTTP_PARSER_ERRNO(&parser_);
+        // Data that follows a request which is not keep-alive is dropped.
+        return (error == HPE_OK || error == HPE_CLOSED_CONNECTION);
+    }
 
-    // Transfers ownership
-    HttpRequest *GetRequest() {
-        HttpRequest *request = request_.get();
-        request_.release();
-        return request;
+    const char *ErrorName() const {
+        return http_errno_name(HTTP_PARSER_ERRNO(&parser_));
     }
+
 private:
     static int OnMessageBegin(struct http_parser *parser) {
         return 0;
@@ -65,14 +64,18 @@ private:
             reinterpret_cast<RequestBuilder *>(parser->data);
         builder->request_->SetMethod(static_cast<http_method>(parser->method));
         builder->request_->SetUrl(&builder->tmp_url_);
-        builder->PushHeader();
+        builder->request_->SetKeepAlive(http_should_keep_alive(parser));
+        if (!builder->header_key_.empty()) {
+            builder->PushHeader();
+        }
         return 0;
     }
 
     static int OnMessageComplete(struct http_parser *parser) {
         RequestBuilder *builder =
             reinterpret_cast<RequestBuilder *>(parser->data);
-        builder->complete_ = true;
+        builder->requests_->push_back(builder->request_.release());
+        builder->request_.reset(new HttpRequest());
         return 0;
     }
 
@@ -122,8 +125,8 @@ private:
 
     struct http_parser parser_;
     std::auto_ptr<HttpRequest> request_;
+    RequestList *requests_;
 
-    bool complete_;
     string tmp_url_;        // temporary: used while parsing
     string header_key_;
     string header_value_;
@@ -156,23 +159,36 @@ public:
         static const char no_response[] =
 "HTTP/1.1 404 Not Found\r\n"
 "Content-Type: text/html; charset=UTF-8\r\n"
-"Content-Length: 46\r\n"
+"Content-Length: 45\r\n"
 "\r\n"
 "<html>\n"
 "<title>404 Not Found</title>\n"
 "</html>\r\n"
 ;
+        // Do not send the terminating NUL, it would be taken for the start
+        // of the next response on a keep-alive connection.
         session->Send(reinterpret_cast<const u_int8_t *>(no_response),
-              sizeof(no_response), NULL);
+              sizeof(no_response) - 1, NULL);
+        session->ResponseComplete();
         delete request;
     }
 
-    // Retrieve a request item from the queue. Return true if the queue
-    // is empty _after_ the pop, false otherwise.
+    // Retrieve the next request from the queue, unless the response to the
+    // previous one is still pending. When there is nothing to do, the task
+    // ends and the next one is scheduled by whoever queues a request or
+    // completes the response. The response to the request is pending until
+    // it is complete, unless the session is already closed.
     bool FromQ(HttpRequest *& r) {
         tbb::mutex::scoped_lock lock(HttpSession::mutex_);
-        session_->request_queue_.try_pop(r);
-        return session_->request_queue_.empty();
+        if (session_->response_pending_ ||
+            !session_->request_queue_.try_pop(r)) {
+            session_->task_pending_ = false;
+            return false;
+        }
+        if (!r->ToString().empty() && !session_->context_str_.empty()) {
+            session_->response_pending_ = true;
+        }
+        return true;
     }
     virtual bool Run() {
         HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_INFO,
@@ -180,34 +196,40 @@ public:
         HttpRequest *request = NULL;
         bool del_session = false;
         HttpServer *server = static_cast<HttpServer *>(session_->server());
-        while (true) {
-            request = NULL;
-            bool empty = FromQ(request);
-            if (!request) break;
+        while (FromQ(request)) {
             HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_INFO,
                          "URL is " + request->ToString());
             if (request->ToString().empty()) {
+                // The requests that were queued before have been answered.
+                // The task stays pending so that no other one is started.
+                delete request;
                 del_session = true;
+                // The context is already gone if the peer closed the
+                // session, and the CLOSE event has been reported.
+                bool notify;
+                {
+                    tbb::mutex::scoped_lock lock(HttpSession::mutex_);
+                    notify = !session_->context_str_.empty();
+                    session_->RemoveContext();
+                }
                 session_->set_observer(NULL);
                 session_->Close();
-                delete request;
-            } else {
-                HttpServer::HttpHandlerFn handler =
-                        server->GetHandler(request->UrlPath());
-                if (handler == NULL) {
-                    handler = boost::bind(&RequestHandler::NotFound,
-                                          this, _1, _2);
+                if (notify && session_->event_cb_ &&
+                    !session_->event_cb_.empty()) {
+                    session_->event_cb_(session_.get(), TcpSession::CLOSE);
                 }
-                handler(session_.get(), request);
+                break;
             }
-
-            // If the queue was empty, do not proceed further. If new request
-            // items have been added to the queue, they would be processed by
-            // a new task.
-            if (empty) break;
+            HttpServer::HttpHandlerFn handler =
+                    server->GetHandler(request->UrlPath());
+            if (handler == NULL) {
+                handler = boost::bind(&RequestHandler::NotFound,
+                                      this, _1, _2);
+            }
+            handler(session_.get(), request);
+            request = NULL;
         }
         if (del_session) {
-            session_->set_observer(NULL);
             server->DeleteSession(session_.get());
             HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_INFO, "DeleteSession");
         }
@@ -219,7 +241,8 @@ private:
 };
 
 HttpSession::HttpSession(HttpServer *server, Socket *socket)
-    : TcpSession(server, socket), event_cb_(NULL) {
+    : TcpSession(server, socket), event_cb_(NULL), task_pending_(false),
+      response_pending_(false), closing_(false) {
     if (req_handler_task_id_ == -1) {
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
         req_handler_task_id_ = scheduler->GetTaskId("http::RequestHandlerTask");
@@ -252,37 +275,23 @@ void HttpSession::OnSessionEvent(TcpSession *session,
     HttpSession *h_session = dynamic_cast<HttpSession *>(session);
     assert(h_session);
 
-    bool was_empty = false;
     switch (event) {
     case TcpSession::CLOSE:
         {
             tbb::mutex::scoped_lock lock(mutex_);
-            if (GetMap()->erase(h_session->context_str_)) {
-                HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_INFO,
-                    "Removed Session " + h_session->context_str_);
-            } else {
-                HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_INFO,
-                    "Not Removed Session " + h_session->context_str_);                
+            RemoveContext();
+            // A pending response can no longer be sent.
+            response_pending_ = false;
+            if (!closing_) {
+                QueueCloseRequest();
             }
-            h_session->context_str_ = "";
-            HttpRequest *request = new HttpRequest();
-            string nourl = "";
-            request->SetUrl(&nourl);
-            was_empty = request_queue_.empty();
-            request_queue_.push(request);
+            ScheduleRequestHandler();
         }
         break;
     default:
         break;
     }
 
-    if (was_empty) {
-        TaskScheduler *scheduler = TaskScheduler::GetInstance();
-        RequestHandler *task = new RequestHandler(this);
-        HttpSession::task_count_++;
-        scheduler->Enqueue(task);
-    }
-
     if (event_cb_ && !event_cb_.empty()) {
         event_cb_(h_session, event);
     }
@@ -292,35 +301,135 @@ void HttpSession::OnRead(Buffer buffer) {
     const u_int8_t *data = BufferData(buffer);
     size_t size = BufferSize(buffer);
     std::stringstream msg;
-    bool was_empty = false;
     {
         tbb::mutex::scoped_lock lock(mutex_);
 
         msg << "HttpSession::Read " << size << " bytes";
         HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_DEBUG, msg.str());
 
-        if (context_str_.size() == 0) {
+        if (context_str_.size() == 0 || closing_) {
             ReleaseBuffer(buffer);
             return;
         }
         if (request_builder_.get() == NULL) {
             request_builder_.reset(new RequestBuilder());
         }
-        request_builder_->Parse(data, size);
-        if (request_builder_->complete()) {
-            was_empty = request_queue_.empty();
-            HttpRequest *request = request_builder_->GetRequest();
-            HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_DEBUG, request->ToString());
+        RequestBuilder::RequestList requests;
+        bool valid = request_builder_->Parse(data, size, &requests);
+        for (RequestBuilder::RequestList::iterator iter = requests.begin();
+             iter != requests.end(); ++iter) {
+            HttpRequest *request = *iter;
+            if (closing_) {
+                delete request;
+                continue;
+            }
+            HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_DEBUG,
+                         request->ToString());
+            bool keep_alive = request->KeepAlive();
             request_queue_.push(request);
-            request_builder_->Clear();
+            if (!keep_alive) {
+                // Close the session once the response has been sent.
+                QueueCloseRequest();
+            }
         }
+        if (!valid && !closing_) {
+            // Close the session once the requests before the error have
+            // been handled. Their pending responses can still be sent.
+            HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_INFO,
+                string("Parse error ") + request_builder_->ErrorName() +
+                " on Session " + context_str_);
+            QueueCloseRequest();
+        }
+        ScheduleRequestHandler();
     }
-    if (was_empty) {
-        TaskScheduler *scheduler = TaskScheduler::GetInstance();
-        RequestHandler *task = new RequestHandler(this);
-        HttpSession::task_count_++;
-        scheduler->Enqueue(task);
-    }
-    // TODO: error handling
     ReleaseBuffer(buffer);
 }
+
+void HttpSession::ResponseComplete() {
+    tbb::mutex::scoped_lock lock(mutex_);
+    OnResponseComplete();
+}
+
+// Called with mutex_ held.
+void HttpSession::OnResponseComplete() {
+    if (!response_pending_) {
+        return;
+    }
+    response_pending_ = false;
+    ScheduleRequestHandler();
+}
+
+// Called with mutex_ held. Starts a task to handle the queued requests,
+// unless one is already running or a response is pending.
+void HttpSession::ScheduleRequestHandler() {
+    if (task_pending_ || response_pending_ || request_queue_.empty()) {
+        return;
+    }
+    task_pending_ = true;
+    HttpSession::task_count_++;
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Enqueue(new RequestHandler(this));
+}
+
+// Called with mutex_ held. No request is queued after the close request.
+void HttpSession::QueueCloseRequest() {
+    closing_ = true;
+    request_queue_.push(CloseRequest());
+}
+
+// Called with mutex_ held.
+void HttpSession::RemoveContext() {
+    if (context_str_.empty()) {
+        return;
+    }
+    if (GetMap()->erase(context_str_)) {
+        HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_INFO,
+            "Removed Session " + context_str_);
+    } else {
+        HTTP_SYS_LOG("HttpSession", SandeshLevel::UT_INFO,
+            "Not Removed Session " + context_str_);
+    }
+    context_str_ = "";
+}
+
+// A request with an empty url closes the session when it is handled.
+HttpRequest *HttpSession::CloseRequest() {
+    HttpRequest *request = new HttpRequest();
+    string nourl = "";
+    request->SetUrl(&nourl);
+    return request;
+}
+
+bool HttpSession::SendChunkedResponseHeader(const string &content_type) {
+    string header("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: " + content_type + "\r\n"
+                  "Transfer-Encoding: chunked\r\n"
+                  "\r\n");
+    return Send(reinterpret_cast<const u_int8_t *>(header.data()),
+                header.size(), NULL);
+}
+
+bool HttpSession::SendChunk(const u_int8_t *data, size_t size) {
+    if (size != 0) {
+        return WriteChunk(data, size);
+    }
+    tbb::mutex::scoped_lock lock(mutex_);
+    bool ret = WriteChunk(data, size);
+    OnResponseComplete();
+    return ret;
+}
+
+bool HttpSession::WriteChunk(const u_int8_t *data, size_t size) {
+    char prefix[32];
+    int len = snprintf(prefix, sizeof(prefix), "%zx\r\n", size);
+    string chunk;
+    chunk.reserve(len + size + 4);
+    chunk.append(prefix, len);
+    chunk.append(reinterpret_cast<const char *>(data), size);
+    chunk.append("\r\n");
+    if (size == 0) {
+        chunk.append("\r\n");
+    }
+    return Send(reinterpret_cast<const u_int8_t *>(chunk.data()),
+                chunk.size(), NULL);
+}
@@ -24,12 +24,15 @@ class HttpSession: public TcpSession {
     virtual ~HttpSession();
     const std::string get_context() { return context_str_; }
 
+    // Sends the complete response to the request being answered.
     static bool SendSession(std::string const& s,
             const u_int8_t *data, size_t size, size_t *sent) {
         tbb::mutex::scoped_lock lock(mutex_);
         HttpSession* hs = GetSession(s);
         if (!hs) return false;
-        return hs->Send(data, size, sent);
+        bool ret = hs->Send(data, size, sent);
+        hs->OnResponseComplete();
+        return ret;
     }
     static std::string get_client_context(std::string const& s) {
         tbb::mutex::scoped_lock lock(mutex_);
@@ -49,6 +52,33 @@ class HttpSession: public TcpSession {
         return task_count_;
     }
 
+    // Responses whose body is produced piecewise, such as large introspect
+    // tables, are sent with chunked transfer encoding: the header, then any
+    // number of chunks, and an empty chunk to end the body, which completes
+    // the response.
+    bool SendChunkedResponseHeader(const std::string &content_type);
+    bool SendChunk(const u_int8_t *data, size_t size);
+    static bool SendChunkSession(std::string const& s,
+            const u_int8_t *data, size_t size) {
+        tbb::mutex::scoped_lock lock(mutex_);
+        HttpSession* hs = GetSession(s);
+        if (!hs) return false;
+        bool ret = hs->WriteChunk(data, size);
+        if (size == 0) {
+            hs->OnResponseComplete();
+        }
+        return ret;
+    }
+
+    // The response to a request is pending from the time its handler is
+    // called until it is complete, which the handler may leave to a task
+    // that answers by context later. The requests that follow on the
+    // session, including the close after a request that is not keep-alive,
+    // are only handled then, so that the responses go out in order.
+    // SendSession and the empty chunk complete the response. A handler
+    // that writes the response with Send calls ResponseComplete.
+    void ResponseComplete();
+
     void AcceptSession();
     void RegisterEventCb(SessionEventCb cb);
 
@@ -63,6 +93,12 @@ class HttpSession: public TcpSession {
 
     void OnSessionEvent(TcpSession *session,
             enum TcpSession::Event event);
+    static HttpRequest *CloseRequest();
+    void QueueCloseRequest();
+    void ScheduleRequestHandler();
+    void OnResponseComplete();
+    void RemoveContext();
+    bool WriteChunk(const u_int8_t *data, size_t size);
 
     static map_type* GetMap() {
         if (!context_map_) {
@@ -85,6 +121,14 @@ class HttpSession: public TcpSession {
     std::string context_str_;
     std::string client_context_str_;
     SessionEventCb event_cb_;
+    // Protected by mutex_. A RequestHandler task is scheduled or running.
+    bool task_pending_;
+    // Protected by mutex_. The response to the last request dispatched is
+    // not complete yet.
+    bool response_pending_;
+    // Protected by mutex_. The session closes after the queued requests
+    // and any further input is dropped.
+    bool closing_;
 
     static int req_handler_task_id_;
     static map_type* context_map_;
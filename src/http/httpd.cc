@@ -3,6 +3,7 @@
  */
 
 #include "base/logging.h"
+#include "base/task.h"
 #include "http/http_request.h"
 #include "http/http_server.h"
 #include "http/http_session.h"
@@ -22,22 +23,39 @@
 using namespace boost::assign;
 using namespace std;
 
+// Reports the server status the way introspect requests are answered: the
+// response is produced by a task after the handler returns, and its body is
+// streamed in chunks.
 class ServerInfo {
 public:
     void HandleRequest(HttpSession *session, const HttpRequest *request) {
-	const char response[] =
-"HTTP/1.1 200 OK\n"
-"Content-Type: text/html; charset=UTF-8\n"
-"Content-Length: 45\n"
-"\n"
-"<html>\n"
-"<title>Server Status</title>\n"
-"</html>\n"
-;
-	session->Send(reinterpret_cast<const u_int8_t *>(response),
-		      sizeof(response), NULL);
+        session->SendChunkedResponseHeader("text/html; charset=UTF-8");
+        TaskScheduler *scheduler = TaskScheduler::GetInstance();
+        scheduler->Enqueue(new StatusTask(session->get_context()));
         delete request;
     }
+
+private:
+    class StatusTask : public Task {
+    public:
+        explicit StatusTask(const string &context)
+            : Task(TaskScheduler::GetInstance()->GetTaskId("httpd::Status")),
+              context_(context) {
+        }
+        virtual bool Run() {
+            SendChunk("<html>\n");
+            SendChunk("<title>Server Status</title>\n");
+            SendChunk("</html>\n");
+            HttpSession::SendChunkSession(context_, NULL, 0);
+            return true;
+        }
+    private:
+        void SendChunk(const string &data) {
+            HttpSession::SendChunkSession(context_,
+                reinterpret_cast<const u_int8_t *>(data.data()), data.size());
+        }
+        string context_;
+    };
 };
 
 static void ServerShutdown(HttpServer *http, HttpSession *session,
@@ -47,6 +65,7 @@ static void ServerShutdown(HttpServer *http, HttpSession *session,
 	;
     session->Send(reinterpret_cast<const u_int8_t *>(response),
 		  sizeof(response), NULL);
+    session->ResponseComplete();
     http->event_manager()->Shutdown();
 }
 
@@ -0,0 +1,384 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <memory>
+#include <sstream>
+
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "testing/gunit.h"
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/test/task_test_util.h"
+#include "http/http_request.h"
+#include "http/http_server.h"
+#include "http/http_session.h"
+#include "io/event_manager.h"
+#include "io/test/event_manager_test.h"
+
+using boost::asio::ip::tcp;
+using namespace std;
+
+namespace {
+
+class HttpServerTest : public ::testing::Test {
+protected:
+    HttpServerTest() : server_(NULL) {
+        keep_alive_ = 0;
+        close_ = 0;
+        deferred_ = 0;
+    }
+
+    virtual void SetUp() {
+        evm_.reset(new EventManager());
+        server_ = new HttpServer(evm_.get());
+        server_->RegisterHandler("/echo",
+            boost::bind(&HttpServerTest::HandleEcho, this, _1, _2));
+        server_->RegisterHandler("/chunked",
+            boost::bind(&HttpServerTest::HandleChunked, this, _1, _2));
+        server_->RegisterHandler("/deferred",
+            boost::bind(&HttpServerTest::HandleDeferred, this, _1, _2));
+        server_->RegisterHandler("/deferred-chunked",
+            boost::bind(&HttpServerTest::HandleDeferredChunked, this, _1, _2));
+        server_->Initialize(0);
+        thread_.reset(new ServerThread(evm_.get()));
+        thread_->Start();
+    }
+
+    virtual void TearDown() {
+        server_->Shutdown();
+        task_util::WaitForIdle();
+        TcpServerManager::DeleteServer(server_);
+        server_ = NULL;
+        evm_->Shutdown();
+        if (thread_.get() != NULL) {
+            thread_->Join();
+        }
+        task_util::WaitForIdle();
+    }
+
+    // Responds with the url of the request.
+    void HandleEcho(HttpSession *session, const HttpRequest *request) {
+        if (request->KeepAlive()) {
+            keep_alive_++;
+        } else {
+            close_++;
+        }
+        string response = EchoResponse(request->UrlPath());
+        session->Send(reinterpret_cast<const u_int8_t *>(response.data()),
+                      response.size(), NULL);
+        session->ResponseComplete();
+        delete request;
+    }
+
+    // Responds with the lines 0 to 99, one chunk per line.
+    void HandleChunked(HttpSession *session, const HttpRequest *request) {
+        session->SendChunkedResponseHeader("text/plain");
+        for (int i = 0; i < 100; i++) {
+            ostringstream line;
+            line << i << "\n";
+            session->SendChunk(
+                reinterpret_cast<const u_int8_t *>(line.str().data()),
+                line.str().size());
+        }
+        session->SendChunk(NULL, 0);
+        delete request;
+    }
+
+    // Leaves the response to the test, which sends it by context later, the
+    // way introspect requests are answered.
+    void HandleDeferred(HttpSession *session, const HttpRequest *request) {
+        deferred_context_ = session->get_context();
+        deferred_++;
+        delete request;
+    }
+
+    // Sends the header, and leaves the chunks of the body to the test.
+    void HandleDeferredChunked(HttpSession *session,
+                               const HttpRequest *request) {
+        session->SendChunkedResponseHeader("text/plain");
+        deferred_context_ = session->get_context();
+        deferred_++;
+        delete request;
+    }
+
+    bool SendDeferred(const string &response) {
+        return HttpSession::SendSession(deferred_context_,
+            reinterpret_cast<const u_int8_t *>(response.data()),
+            response.size(), NULL);
+    }
+
+    static string EchoResponse(const string &body) {
+        ostringstream response;
+        response << "HTTP/1.1 200 OK\r\n"
+                 << "Content-Type: text/plain\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "\r\n" << body;
+        return response.str();
+    }
+
+    void Connect(tcp::socket *socket) {
+        boost::system::error_code ec;
+        socket->connect(tcp::endpoint(
+            boost::asio::ip::address::from_string("127.0.0.1", ec),
+            server_->GetPort()), ec);
+        ASSERT_FALSE(ec);
+    }
+
+    void Write(tcp::socket *socket, const string &data) {
+        boost::asio::write(*socket, boost::asio::buffer(data));
+    }
+
+    // Reads until size bytes are received or the socket stays idle for a
+    // second.
+    string Read(tcp::socket *socket, size_t size) {
+        string data;
+        for (int idle = 0; data.size() < size && idle < 1000; ) {
+            boost::system::error_code ec;
+            size_t available = socket->available(ec);
+            if (ec) {
+                break;
+            }
+            if (available == 0) {
+                usleep(1000);
+                idle++;
+                continue;
+            }
+            char buffer[4096];
+            size_t len = socket->read_some(boost::asio::buffer(buffer,
+                min(available, sizeof(buffer))), ec);
+            if (ec) {
+                break;
+            }
+            data.append(buffer, len);
+            idle = 0;
+        }
+        return data;
+    }
+
+    boost::asio::io_service io_service_;
+    auto_ptr<EventManager> evm_;
+    auto_ptr<ServerThread> thread_;
+    HttpServer *server_;
+    tbb::atomic<int> keep_alive_;
+    tbb::atomic<int> close_;
+    tbb::atomic<int> deferred_;
+    string deferred_context_;
+};
+
+// Several requests on a connection, one at a time.
+TEST_F(HttpServerTest, KeepAlive) {
+    tcp::socket socket(io_service_);
+    Connect(&socket);
+    for (int i = 0; i < 10; i++) {
+        Write(&socket, "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        string expected = EchoResponse("/echo");
+        EXPECT_EQ(expected, Read(&socket, expected.size()));
+    }
+    EXPECT_EQ(10, keep_alive_);
+    EXPECT_EQ(0, close_);
+}
+
+// Requests that are sent before the previous responses are received, with
+// several of them in a write and one of them split across writes, are
+// answered in order.
+TEST_F(HttpServerTest, Pipeline) {
+    tcp::socket socket(io_service_);
+    Connect(&socket);
+    string requests;
+    string expected;
+    for (int i = 0; i < 3; i++) {
+        requests += "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        expected += EchoResponse("/echo");
+    }
+    requests += "GET /missing HTTP/1.1\r\n";
+    Write(&socket, requests);
+    Write(&socket, "Host: localhost\r\n\r\nGET /echo HTTP/1.1\r\n\r\n");
+
+    expected += "HTTP/1.1 404 Not Found\r\n"
+                "Content-Type: text/html; charset=UTF-8\r\n"
+                "Content-Length: 45\r\n"
+                "\r\n"
+                "<html>\n"
+                "<title>404 Not Found</title>\n"
+                "</html>\r\n";
+    expected += EchoResponse("/echo");
+    EXPECT_EQ(expected, Read(&socket, expected.size()));
+    EXPECT_EQ(4, keep_alive_);
+}
+
+// The request tells whether the client keeps the connection open.
+TEST_F(HttpServerTest, ConnectionClose) {
+    tcp::socket socket(io_service_);
+    Connect(&socket);
+    Write(&socket, "GET /echo HTTP/1.1\r\nConnection: close\r\n\r\n"
+                   "GET /echo HTTP/1.1\r\n\r\n");
+    string expected = EchoResponse("/echo");
+    EXPECT_EQ(expected, Read(&socket, expected.size() + 1));
+    EXPECT_EQ(0, keep_alive_);
+    EXPECT_EQ(1, close_);
+    TASK_UTIL_EXPECT_EQ(0, server_->GetSessionCount());
+
+    tcp::socket socket10(io_service_);
+    Connect(&socket10);
+    Write(&socket10, "GET /echo HTTP/1.0\r\n\r\n");
+    EXPECT_EQ(expected, Read(&socket10, expected.size()));
+    EXPECT_EQ(2, close_);
+    TASK_UTIL_EXPECT_EQ(0, server_->GetSessionCount());
+}
+
+// Data that is not a request closes the session.
+TEST_F(HttpServerTest, ParseError) {
+    tcp::socket socket(io_service_);
+    Connect(&socket);
+    Write(&socket, "GET /echo HTTP/1.1\r\n\r\njunk\r\n\r\n");
+    string expected = EchoResponse("/echo");
+    EXPECT_EQ(expected, Read(&socket, expected.size()));
+    TASK_UTIL_EXPECT_EQ(0, server_->GetSessionCount());
+}
+
+// The requests that follow a deferred response are only handled once it
+// has been sent, so that the responses go out in order.
+TEST_F(HttpServerTest, Deferred) {
+    tcp::socket socket(io_service_);
+    Connect(&socket);
+    Write(&socket, "GET /deferred HTTP/1.1\r\n\r\n"
+                   "GET /echo HTTP/1.1\r\n\r\n");
+    TASK_UTIL_EXPECT_EQ(1, deferred_);
+    task_util::WaitForIdle();
+    EXPECT_EQ(0, keep_alive_);
+
+    string expected = EchoResponse("/deferred");
+    EXPECT_TRUE(SendDeferred(expected));
+    expected += EchoResponse("/echo");
+    EXPECT_EQ(expected, Read(&socket, expected.size()));
+    EXPECT_EQ(1, keep_alive_);
+}
+
+// A request that is not keep-alive closes the session only once its
+// response has been sent by context.
+TEST_F(HttpServerTest, DeferredConnectionClose) {
+    tcp::socket socket(io_service_);
+    Connect(&socket);
+    Write(&socket, "GET /deferred HTTP/1.1\r\nConnection: close\r\n\r\n");
+    TASK_UTIL_EXPECT_EQ(1, deferred_);
+    task_util::WaitForIdle();
+    EXPECT_EQ(1, server_->GetSessionCount());
+
+    string expected = EchoResponse("/deferred");
+    EXPECT_TRUE(SendDeferred(expected));
+    EXPECT_EQ(expected, Read(&socket, expected.size()));
+    TASK_UTIL_EXPECT_EQ(0, server_->GetSessionCount());
+
+    tcp::socket socket10(io_service_);
+    Connect(&socket10);
+    Write(&socket10, "GET /deferred HTTP/1.0\r\n\r\n");
+    TASK_UTIL_EXPECT_EQ(2, deferred_);
+    task_util::WaitForIdle();
+    EXPECT_EQ(1, server_->GetSessionCount());
+
+    EXPECT_TRUE(SendDeferred(expected));
+    EXPECT_EQ(expected, Read(&socket10, expected.size()));
+    TASK_UTIL_EXPECT_EQ(0, server_->GetSessionCount());
+}
+
+// The empty chunk completes a deferred chunked response.
+TEST_F(HttpServerTest, DeferredChunked) {
+    tcp::socket socket(io_service_);
+    Connect(&socket);
+    Write(&socket, "GET /deferred-chunked HTTP/1.1\r\n\r\n"
+                   "GET /echo HTTP/1.1\r\n\r\n");
+    TASK_UTIL_EXPECT_EQ(1, deferred_);
+
+    string header = "HTTP/1.1 200 OK\r\n"
+                    "Content-Type: text/plain\r\n"
+                    "Transfer-Encoding: chunked\r\n"
+                    "\r\n";
+    EXPECT_TRUE(HttpSession::SendChunkSession(deferred_context_,
+        reinterpret_cast<const u_int8_t *>("abc"), 3));
+    task_util::WaitForIdle();
+    EXPECT_EQ(0, keep_alive_);
+    EXPECT_TRUE(HttpSession::SendChunkSession(deferred_context_, NULL, 0));
+
+    string expected = header + "3\r\nabc\r\n0\r\n\r\n" +
+        EchoResponse("/echo");
+    EXPECT_EQ(expected, Read(&socket, expected.size()));
+    EXPECT_EQ(1, keep_alive_);
+}
+
+// A parse error closes the session only once the deferred response of an
+// earlier request has been sent.
+TEST_F(HttpServerTest, ParseErrorDeferred) {
+    tcp::socket socket(io_service_);
+    Connect(&socket);
+    Write(&socket, "GET /deferred HTTP/1.1\r\n\r\njunk\r\n\r\n");
+    TASK_UTIL_EXPECT_EQ(1, deferred_);
+    task_util::WaitForIdle();
+    EXPECT_EQ(1, server_->GetSessionCount());
+
+    string expected = EchoResponse("/deferred");
+    EXPECT_TRUE(SendDeferred(expected));
+    EXPECT_EQ(expected, Read(&socket, expected.size()));
+    TASK_UTIL_EXPECT_EQ(0, server_->GetSessionCount());
+}
+
+TEST_F(HttpServerTest, Chunked) {
+    tcp::socket socket(io_service_);
+    Connect(&socket);
+    Write(&socket, "GET /chunked HTTP/1.1\r\n\r\n");
+
+    string expected = "HTTP/1.1 200 OK\r\n"
+                      "Content-Type: text/plain\r\n"
+                      "Transfer-Encoding: chunked\r\n"
+                      "\r\n";
+    for (int i = 0; i < 100; i++) {
+        ostringstream chunk;
+        chunk << hex << (i < 10 ? 2 : 3) << "\r\n" << dec << i << "\n\r\n";
+        expected += chunk.str();
+    }
+    expected += "0\r\n\r\n";
+    EXPECT_EQ(expected, Read(&socket, expected.size()));
+}
+
+// Load generator: each client sends requests on a keep-alive connection,
+// with a window of outstanding requests. Run with
+// --gtest_also_run_disabled_tests; gtest reports the elapsed time.
+TEST_F(HttpServerTest, DISABLED_Load) {
+    const int kClients = 16;
+    const int kRequests = 10000;
+    const int kWindow = 8;
+    const string request = "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    const string response = EchoResponse("/echo");
+
+    boost::ptr_vector<tcp::socket> sockets;
+    for (int i = 0; i < kClients; i++) {
+        sockets.push_back(new tcp::socket(io_service_));
+        Connect(&sockets.back());
+    }
+
+    string window;
+    for (int i = 0; i < kWindow; i++) {
+        window += request;
+    }
+    for (int sent = 0; sent < kRequests; sent += kWindow) {
+        for (int i = 0; i < kClients; i++) {
+            Write(&sockets[i], window);
+        }
+        for (int i = 0; i < kClients; i++) {
+            ASSERT_EQ(response.size() * kWindow,
+                      Read(&sockets[i], response.size() * kWindow).size());
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -4,7 +4,8 @@
 
 #include "ifmap/ifmap_encoder.h"
 
-#include <sstream>
+#include <string.h>
+#include "base/util.h"
 #include "ifmap/ifmap_link.h"
 #include "ifmap/ifmap_object.h"
 #include "ifmap/ifmap_update.h"
@@ -12,35 +13,67 @@
 using namespace pugi;
 using namespace std;
 
+static const char *kMessageHead =
+    "<?xml version=\"1.0\"?>\n"
+    "<iq type=\"set\" from=\"network-control@contrailsystems.com\" to=\"";
+static const char *kMessageTail = "</iq>\n";
+
+// Appends the output of pugi serialization to a string.
+struct IFMapMessageWriter : public xml_writer {
+    explicit IFMapMessageWriter(string *str) : str_(str) { }
+    virtual void write(const void *data, size_t size) {
+        str_->append(static_cast<const char *>(data), size);
+    }
+    string *str_;
+};
+
 IFMapMessage::IFMapMessage() : op_type_(NONE), node_count_(0),
     objects_per_message_(kObjectsPerMessage) {
     // init empty document
     Open();
 }
 
+// The document only holds the config element. The iq envelope differs per
+// receiver and is added as a string around the serialized config.
 void IFMapMessage::Open() {
-    xml_node iq = doc_.append_child("iq");
-    // set iq (type, from, to) attributes
-    iq.append_attribute("type") = "set";
-    iq.append_attribute("from") = "network-control@contrailsystems.com"; 
-    iq.append_attribute("to") = "";
-    config_ = iq.append_child("config");
+    config_ = doc_.append_child("config");
 }
 
+// Serialize config at the depth it has within the iq element, so that the
+// result is the same as saving the complete iq document.
 void IFMapMessage::Close() {
-    ostringstream oss;
-    doc_.save(oss);
-    str_ = oss.str();
+    body_.clear();
+    IFMapMessageWriter writer(&body_);
+    config_.print(writer, "\t", format_default, encoding_auto, 1);
 }
 
 void IFMapMessage::SetReceiverInMsg(const std::string &cli_identifier) {
-    xml_node iq = doc_.child("iq");
-    assert(iq);
-    xml_attribute iqattr = iq.attribute("to");
-    assert(iqattr);
-    std::string str(cli_identifier);
-    str += "/config";
-    iqattr.set_value(str.c_str());
+    assert(!body_.empty());
+    str_.clear();
+    str_.reserve(strlen(kMessageHead) + cli_identifier.size() + body_.size() +
+                 32);
+    str_ += kMessageHead;
+    // Escape the identifier as an attribute value, as pugi would.
+    for (string::const_iterator it = cli_identifier.begin();
+         it != cli_identifier.end(); ++it) {
+        switch (*it) {
+        case '&': str_ += "&amp;"; break;
+        case '<': str_ += "&lt;"; break;
+        case '>': str_ += "&gt;"; break;
+        case '"': str_ += "&quot;"; break;
+        case '\'': str_ += "&apos;"; break;
+        default:
+            if (static_cast<unsigned char>(*it) < 32) {
+                str_ += "&#" + integerToString(static_cast<int>(*it)) + ";";
+            } else {
+                str_ += *it;
+            }
+            break;
+        }
+    }
+    str_ += "/config\">\n";
+    str_ += body_;
+    str_ += kMessageTail;
 }
 
 void IFMapMessage::SetObjectsPerMessage(int num) {
@@ -110,6 +143,7 @@ void IFMapMessage::Reset() {
     doc_.reset();
     node_count_ = 0;
     op_type_ = NONE;
+    body_.clear();
     Open();
 }
 
@@ -117,3 +151,8 @@ const char * IFMapMessage::c_str() const {
     assert(!str_.empty());
     return str_.c_str();
 }
+
+const std::string &IFMapMessage::get_string() const {
+    assert(!str_.empty());
+    return str_;
+}
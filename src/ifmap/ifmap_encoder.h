@@ -16,8 +16,9 @@ public:
     static const int kObjectsPerMessage = 16;
     IFMapMessage();
 
+    // serialize the encoded objects, done once for all the receivers
     void Close();
-    // set the 'to' field in the message
+    // set the 'to' field in the message, only valid after Close()
     void SetReceiverInMsg(const std::string &cli_identifier);
     void SetObjectsPerMessage(int num);
     void EncodeUpdate(const IFMapUpdate *update);
@@ -26,6 +27,7 @@ public:
     void Reset();
 
     const char *c_str() const;
+    const std::string &get_string() const;
 
 private:
     enum Op {
@@ -41,7 +43,8 @@ private:
     pugi::xml_node config_;
     Op op_type_;             // the current  type of op_node_
     pugi::xml_node op_node_;
-    std::string str_;
+    std::string body_;       // serialized config_, same for all receivers
+    std::string str_;        // envelope for the current receiver + body_
     int node_count_;
     int objects_per_message_;
 };
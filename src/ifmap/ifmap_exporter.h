@@ -58,6 +58,7 @@ public:
     IFMapServer *server() { return server_; }
 
     bool FilterNeighbor(IFMapNode *lnode, IFMapNode *rnode);
+    IFMapGraphWalker *walker() { return walker_.get(); }
 
 private:
     friend class XmppIfmapTest;
@@ -132,17 +132,41 @@ bool IFMapGraphWalker::FilterNeighbor(IFMapNode *lnode, IFMapNode *rnode) {
     return false;
 }
 
-void IFMapGraphWalker::RecomputeInterest(DBGraphVertex *vertex, int bit) {
+// Add the bits in bset that the vertex has not been reached with yet to
+// its new mask, and queue them for propagation to its neighbors.
+void IFMapGraphWalker::InterestAdd(DBGraphVertex *vertex, const BitSet &bset,
+                                   PendingMap *pending, PendingQueue *queue) {
     IFMapNode *node = static_cast<IFMapNode *>(vertex);
     IFMapNodeState *state = exporter_->NodeStateLocate(node);
-    state->nmask_set(bit);
+    BitSet bits;
+    bits.BuildComplement(bset, state->nmask());
+    if (bits.empty()) {
+        return;
+    }
+    state->nmask_or(bits);
+
+    std::pair<PendingMap::iterator, bool> result =
+        pending->insert(std::make_pair(vertex, bits));
+    if (result.second) {
+        queue->push_back(vertex);
+    } else {
+        result.first->second |= bits;
+    }
 }
 
-bool IFMapGraphWalker::Worker(QueueEntry work_entry) {
-    const BitSet &bset = work_entry.set;
+// Recompute the interest of every client in rm_mask_ in a single pass.
+// Rather than one traversal per client, the client bits are propagated
+// together and a vertex is only expanded again when it is reached with
+// bits it has not seen yet. The parts of the graph that are shared by many
+// virtual-routers (networks, ipams, global config) are thus walked once per
+// batch instead of once per client.
+void IFMapGraphWalker::RecomputeInterest() {
+    PendingMap pending;
+    PendingQueue queue;
+
     IFMapServer *server = exporter_->server();
-    for (size_t i = bset.find_first(); i != BitSet::npos;
-         i = bset.find_next(i)) {
+    for (size_t i = rm_mask_.find_first(); i != BitSet::npos;
+         i = rm_mask_.find_next(i)) {
         IFMapClient *client = server->GetClient(i);
         if (client == NULL) {
             continue;
@@ -153,11 +177,37 @@ bool IFMapGraphWalker::Worker(QueueEntry work_entry) {
                                                   "virtual-router");
         IFMapNode *node = table->FindNode(client->identifier());
         if ((node != NULL) && node->IsVertexValid()) {
-            graph_->Visit(node,
-                boost::bind(&IFMapGraphWalker::RecomputeInterest, this, _1, i),
-                0, *traversal_white_list_.get());
+            BitSet bset;
+            bset.set(i);
+            InterestAdd(node, bset, &pending, &queue);
         }
     }
+
+    while (!queue.empty()) {
+        DBGraphVertex *vertex = queue.front();
+        queue.pop_front();
+        PendingMap::iterator loc = pending.find(vertex);
+        BitSet bset = loc->second;
+        pending.erase(loc);
+
+        for (DBGraphVertex::edge_iterator iter =
+                 vertex->edge_list_begin(graph_);
+             iter != vertex->edge_list_end(graph_); ++iter) {
+            DBGraphEdge *edge = iter.operator->();
+            DBGraphVertex *target = iter.target();
+            if (edge->IsDeleted() || target->IsDeleted() ||
+                !traversal_white_list_->VertexFilter(target) ||
+                !traversal_white_list_->EdgeFilter(vertex, target, edge)) {
+                continue;
+            }
+            InterestAdd(target, bset, &pending, &queue);
+        }
+    }
+}
+
+// Link removals are coalesced: the worker only accumulates the affected
+// clients and the interest is recomputed once at the end of the batch.
+bool IFMapGraphWalker::Worker(QueueEntry work_entry) {
     rm_mask_ |= work_entry.set;
     return true;
 }
@@ -197,6 +247,7 @@ void IFMapGraphWalker::CleanupInterest(DBGraphVertex *vertex) {
 // Cleanup all graph nodes that a bit set in the remove mask (rm_mask_) but
 // where not visited by the walker.
 void IFMapGraphWalker::WorkBatchEnd(bool done) {
+    RecomputeInterest();
     for (DBGraph::vertex_iterator iter = graph_->vertex_list_begin();
          iter != graph_->vertex_list_end(); ++iter) {
         DBGraphVertex *vertex = iter.operator->();
@@ -5,6 +5,8 @@
 #ifndef __ctrlplane__ifmap_graph_walker__
 #define __ctrlplane__ifmap_graph_walker__
 
+#include <deque>
+#include <map>
 #include "base/bitset.h"
 #include "base/queue_task.h"
 #include "schema/vnc_cfg_types.h"
@@ -32,17 +34,26 @@ public:
 
     bool FilterNeighbor(IFMapNode *lnode, IFMapNode *rnode);
 
+    // The edges and vertices along which client interest propagates.
+    const IFMapTypenameWhiteList &traversal_white_list() const {
+        return *traversal_white_list_;
+    }
+
 private:
     struct QueueEntry {
         BitSet set;
     };
+    typedef std::map<DBGraphVertex *, BitSet> PendingMap;
+    typedef std::deque<DBGraphVertex *> PendingQueue;
 
     bool Worker(QueueEntry entry);
     void WorkBatchEnd(bool done);
 
     void ProcessLinkAdd(IFMapNode *lnode, IFMapNode *rnode, const BitSet &bset);
     void JoinVertex(DBGraphVertex *vertex, const BitSet &bset);
-    void RecomputeInterest(DBGraphVertex *vertex, int bit);
+    void InterestAdd(DBGraphVertex *vertex, const BitSet &bset,
+                     PendingMap *pending, PendingQueue *queue);
+    void RecomputeInterest();
     void CleanupInterest(DBGraphVertex *vertex);
     void AddNodesToWhitelist();
     void AddLinksToWhitelist();
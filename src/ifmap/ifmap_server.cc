@@ -28,6 +28,7 @@
 #include "ifmap/ifmap_update_queue.h"
 #include "ifmap/ifmap_update_sender.h"
 #include "ifmap/ifmap_xmpp.h"
+#include "ifmap/ifmap_util.h"
 #include "ifmap/ifmap_uuid_mapper.h"
 #include "schema/vnc_cfg_types.h"
 
@@ -281,12 +282,19 @@ bool IFMapServer::ClientWorker(QueueEntry work_entry) {
     return done;
 }
 
+// Reset the client bits in the node and in all the links that depend on it.
+// Link interest is the intersection of the interest of its nodes, so any link
+// that carries the bits has both its nodes in the client's interest graph.
 void IFMapServer::NodeResetClient(DBGraphVertex *vertex, const BitSet &bset) {
     IFMapNode *node = static_cast<IFMapNode *>(vertex);
     IFMapNodeState *state = exporter_->NodeStateLookup(node);
     if (state) {
         state->InterestReset(bset);
         state->AdvertisedReset(bset);
+        for (IFMapNodeState::iterator iter = state->begin();
+             iter != state->end(); ++iter) {
+            LinkResetClient(iter.operator->(), bset);
+        }
     }
 }
 
@@ -329,12 +337,18 @@ void IFMapServer::RemoveSelfAddedLinksAndObjects(IFMapClient *client) {
     }
 }
 
+// Changing the edges of the vrouter runs the graph walker, which computes
+// the interest of the client, and the updates then go out through the
+// update queue like any other. The walker has to run for a new client
+// since its interest is not known beforehand, and the queue keeps what is
+// advertised to the client ordered with the config changes made meanwhile.
 void IFMapServer::ClientGraphDownload(IFMapClient *client) {
     IFMapTable *table = IFMapTable::FindTable(db_, "virtual-router");
     assert(table);
 
     IFMapNode *node = table->FindNode(client->identifier());
     if ((node != NULL) && node->IsVertexValid()) {
+        DBTable *link_table = exporter_->link_table();
         for (DBGraphVertex::adjacency_iterator iter = node->begin(graph_);
             iter != node->end(graph_); ++iter) {
             IFMapNode *adj = static_cast<IFMapNode *>(iter.operator->());
@@ -342,8 +356,6 @@ void IFMapServer::ClientGraphDownload(IFMapClient *client) {
                 continue;
             }
             DBGraphEdge *edge = graph_->GetEdge(node, adj);
-            DBTable *link_table = static_cast<DBTable *>(
-                db_->FindTable("__ifmap_metadata__.0"));
             link_table->Change(edge);
         }
     }
@@ -365,10 +377,15 @@ void IFMapServer::ClientGraphCleanup(IFMapClient *client) {
         state->InterestReset(rm_bs);
         state->AdvertisedReset(rm_bs);
 
+        // The client's bits can only have propagated along the walker's
+        // traversal white list. Restrict the cleanup to that subgraph rather
+        // than visiting every node reachable from the vrouter, which is most
+        // of the configuration (via global-system-config and the other
+        // vrouters).
         if (node->IsVertexValid()) {
             graph_->Visit(node,
                 boost::bind(&IFMapServer::NodeResetClient, this, _1, rm_bs),
-                boost::bind(&IFMapServer::LinkResetClient, this, _1, rm_bs));
+                0, exporter_->walker()->traversal_white_list());
         }
     }
 }
@@ -4,7 +4,9 @@
 
 #include "ifmap/ifmap_server_parser.h"
 
+#include <algorithm>
 #include <pugixml/pugixml.hpp>
+#include "base/util.h"
 #include "db/db.h"
 #include "ifmap/ifmap_server_table.h"
 #include "ifmap/ifmap_log.h"
@@ -212,33 +214,220 @@ void IFMapServerParser::ParseResults(
     }
 }
 
-// Called in the context of the ifmap client thread.
-bool IFMapServerParser::Receive(DB *db, const char *data, size_t length,
+void IFMapServerParser::Enqueue(DB *db, DBRequest *request,
                                 uint64_t sequence_number) {
-    xml_document xdoc;
-    pugi::xml_parse_result result = xdoc.load_buffer(data, length);
-    if (!result) {
-        IFMAP_WARN(IFMapXmlLoadError, "Unable to load XML document", length);
+    IFMapTable::RequestKey *key =
+            static_cast<IFMapTable::RequestKey *>(request->key.get());
+    key->id_seq_num = sequence_number;
+
+    IFMapTable *table = IFMapTable::FindTable(db, key->id_type);
+    if (table == NULL) {
+        IFMAP_TRACE(IFMapTblNotFoundTrace, "Cant find table", key->id_type);
+        return;
+    }
+    table->Enqueue(request);
+}
+
+static bool IsResultName(const string &name) {
+    return (name == "updateResult" || name == "searchResult" ||
+            name == "deleteResult");
+}
+
+static bool IsTagSpace(char c) {
+    return (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+}
+
+// Returns the offset of the '>' that closes the tag starting at start,
+// skipping over quoted attribute values.
+static size_t TagEnd(const char *base, size_t size, size_t start) {
+    char quote = '\0';
+    for (size_t i = start + 1; i < size; i++) {
+        char c = base[i];
+        if (quote != '\0') {
+            if (c == quote) {
+                quote = '\0';
+            }
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '>') {
+            return i;
+        }
+    }
+    return string::npos;
+}
+
+IFMapServerParser::Stream::Stream(const IFMapServerParser *parser, DB *db,
+                                  uint64_t sequence_number)
+    : parser_(parser), db_(db), sequence_number_(sequence_number),
+      item_hint_(0), in_result_(false), add_change_(true), error_(false),
+      item_count_(0) {
+}
+
+IFMapServerParser::Stream::~Stream() {
+    STLDeleteValues(&requests_);
+}
+
+bool IFMapServerParser::Stream::Feed(const char *data, size_t length) {
+    return Consume(data, length);
+}
+
+bool IFMapServerParser::Stream::Finish(const char *data, size_t length) {
+    if (!Consume(data, length)) {
+        return false;
+    }
+    if (!buffer_.empty() || in_result_) {
+        IFMAP_WARN(IFMapXmlLoadError, "Truncated XML document",
+                   buffer_.size());
         return false;
     }
+    while (!requests_.empty()) {
+        auto_ptr<DBRequest> req(requests_.front());
+        requests_.pop_front();
+        IFMapServerParser::Enqueue(db_, req.get(), sequence_number_);
+    }
+    return true;
+}
+
+// Parses the buffered input followed by data. Whatever is left over is an
+// incomplete tag or resultItem and is kept for the next call. The input is
+// only copied when an element straddles two chunks.
+bool IFMapServerParser::Stream::Consume(const char *data, size_t length) {
+    if (error_) {
+        return false;
+    }
+
+    const char *base;
+    size_t size;
+    bool buffered = !buffer_.empty();
+    if (buffered) {
+        buffer_.append(data, length);
+        base = buffer_.data();
+        size = buffer_.size();
+    } else {
+        base = data;
+        size = length;
+    }
 
-    IFMapServerParser::RequestList requests;
-    ParseResults(xdoc, &requests);
+    size_t offset = Parse(base, size);
+    item_hint_ = (item_hint_ > offset) ? item_hint_ - offset : 0;
+    if (buffered) {
+        buffer_.erase(0, offset);
+    } else if (offset < size) {
+        buffer_.assign(base + offset, size - offset);
+    }
+    return !error_;
+}
 
-    while (!requests.empty()) {
-        auto_ptr<DBRequest> req(requests.front());
-        requests.pop_front();
+// Returns the offset just past the end tag that matches qname, or npos if
+// the end tag has not been fed yet.
+size_t IFMapServerParser::Stream::ItemEnd(const char *base, size_t size,
+                                          const string &qname, size_t start) {
+    string etag = "</" + qname;
+    const char *end = base + size;
+    const char *pos = base + max(start, item_hint_);
+    while (true) {
+        pos = search(pos, end, etag.begin(), etag.end());
+        if (pos == end) {
+            size_t tail = min(size, etag.size());
+            item_hint_ = max(start, size - tail);
+            return string::npos;
+        }
+        const char *next = pos + etag.size();
+        while (next != end && IsTagSpace(*next)) {
+            ++next;
+        }
+        if (next == end) {
+            item_hint_ = pos - base;
+            return string::npos;
+        }
+        if (*next == '>') {
+            item_hint_ = 0;
+            return next + 1 - base;
+        }
+        pos = next;
+    }
+}
 
-        IFMapTable::RequestKey *key =
-                static_cast<IFMapTable::RequestKey *>(req->key.get());
-        key->id_seq_num = sequence_number;
+// Scans the tags outside of resultItem elements to track which result
+// element is open, and hands each complete resultItem to pugi.
+size_t IFMapServerParser::Stream::Parse(const char *base, size_t size) {
+    size_t offset = 0;
+    while (offset < size) {
+        const char *lt = static_cast<const char *>(
+            memchr(base + offset, '<', size - offset));
+        if (lt == NULL) {
+            return size;
+        }
+        size_t start = lt - base;
+        if (size - start >= 4 && strncmp(lt, "<!--", 4) == 0) {
+            const char *comment = "-->";
+            const char *pos = search(lt + 4, base + size, comment, comment + 3);
+            if (pos == base + size) {
+                return start;
+            }
+            offset = pos + 3 - base;
+            continue;
+        }
+        size_t end = TagEnd(base, size, start);
+        if (end == string::npos) {
+            return start;
+        }
 
-        IFMapTable *table = IFMapTable::FindTable(db, key->id_type);
-        if (table != NULL) {
-            table->Enqueue(req.get());
-        } else {
-            IFMAP_TRACE(IFMapTblNotFoundTrace, "Cant find table", key->id_type);
+        bool closing = (base[start + 1] == '/');
+        size_t name_start = start + 1 + (closing ? 1 : 0);
+        size_t name_end = name_start;
+        while (name_end < end && !IsTagSpace(base[name_end]) &&
+               base[name_end] != '/') {
+            name_end++;
+        }
+        string qname(base + name_start, name_end - name_start);
+        size_t colon = qname.find(':');
+        string name = (colon == string::npos) ? qname : qname.substr(colon + 1);
+        bool empty = (base[end - 1] == '/');
+
+        if (closing) {
+            if (IsResultName(name)) {
+                in_result_ = false;
+            }
+        } else if (IsResultName(name)) {
+            if (!empty) {
+                in_result_ = true;
+                add_change_ = (name != "deleteResult");
+            }
+        } else if (in_result_ && !empty && name == "resultItem") {
+            size_t item_end = ItemEnd(base, size, qname, end + 1);
+            if (item_end == string::npos) {
+                return start;
+            }
+            if (!ParseItem(base + start, item_end - start)) {
+                error_ = true;
+                return item_end;
+            }
+            offset = item_end;
+            continue;
         }
+        offset = end + 1;
     }
+    return offset;
+}
+
+bool IFMapServerParser::Stream::ParseItem(const char *data, size_t length) {
+    xml_document xdoc;
+    pugi::xml_parse_result result = xdoc.load_buffer(data, length);
+    if (!result) {
+        IFMAP_WARN(IFMapXmlLoadError, "Unable to load XML resultItem", length);
+        return false;
+    }
+
+    parser_->ParseResultItem(xdoc.first_child(), add_change_, &requests_);
+    item_count_++;
     return true;
 }
+
+// Called in the context of the ifmap client thread, with the complete body
+// of a poll response.
+bool IFMapServerParser::Receive(DB *db, const char *data, size_t length,
+                                uint64_t sequence_number) {
+    Stream stream(this, db, sequence_number);
+    return stream.Finish(data, length);
+}
@@ -7,6 +7,7 @@
 
 #include <list>
 #include <map>
+#include <string>
 #include <boost/function.hpp>
 
 struct AutogenProperty;
@@ -26,6 +27,45 @@ public:
     typedef std::map<std::string, MetadataParseFn> MetadataParseMap;
     typedef std::list<struct DBRequest *> RequestList;
 
+    // Parser for a single poll response that loads one resultItem at a
+    // time, so the DOM of the whole document is never built. The requests
+    // are held until the document is complete and are only enqueued if all
+    // of it parsed. IFMapChannel reads the whole body before Receive is
+    // called, so nothing is enqueued while the body arrives. Feed accepts
+    // the document in pieces.
+    class Stream {
+    public:
+        Stream(const IFMapServerParser *parser, DB *db,
+               uint64_t sequence_number);
+        ~Stream();
+
+        bool Feed(const char *data, size_t length);
+        // Feeds the last chunk and enqueues the requests. Returns false,
+        // without enqueueing anything, if the input was malformed or ended
+        // inside a result element.
+        bool Finish(const char *data = NULL, size_t length = 0);
+
+        size_t item_count() const { return item_count_; }
+
+    private:
+        bool Consume(const char *data, size_t length);
+        size_t Parse(const char *base, size_t size);
+        size_t ItemEnd(const char *base, size_t size,
+                       const std::string &qname, size_t start);
+        bool ParseItem(const char *data, size_t length);
+
+        const IFMapServerParser *parser_;
+        DB *db_;
+        uint64_t sequence_number_;
+        std::string buffer_;
+        size_t item_hint_;
+        bool in_result_;
+        bool add_change_;
+        bool error_;
+        size_t item_count_;
+        RequestList requests_;
+    };
+
     // Called for each resultItem element in the IF-MAP notification.
     bool ParseResultItem(const pugi::xml_node &parent, bool add_change,
                          RequestList *list) const;
@@ -47,6 +87,8 @@ private:
 
     bool ParseMetadata(const pugi::xml_node &node,
                        struct DBRequest *result) const;
+    static void Enqueue(DB *db, struct DBRequest *request,
+                        uint64_t sequence_number);
 
     MetadataParseMap metadata_map_;
 };
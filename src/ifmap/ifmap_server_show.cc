@@ -892,7 +892,7 @@ bool ShowIFMapUuidToNodeMapping::BufferStage(const Sandesh *sr,
                                         uuid_mapper.uuid_node_map_.begin();
          iter != uuid_mapper.uuid_node_map_.end(); ++iter) {
         IFMapUuidToNodeMappingEntry dest;
-        dest.set_uuid(iter->first);
+        dest.set_uuid(IFMapUuidMapper::UuidToString(iter->first));
         IFMapNode *node = static_cast<IFMapNode *>(iter->second);
         dest.set_node_name(node->ToString());
         show_data->send_buffer.push_back(dest);
@@ -1022,7 +1022,7 @@ bool ShowIFMapNodeToUuidMapping::BufferStage(const Sandesh *sr,
         IFMapNodeToUuidMappingEntry dest;
         IFMapNode *node = static_cast<IFMapNode *>(iter->first);
         dest.set_node_name(node->ToString());
-        dest.set_uuid(iter->second);
+        dest.set_uuid(IFMapUuidMapper::UuidToString(iter->second));
         show_data->send_buffer.push_back(dest);
     }
 
@@ -1148,7 +1148,7 @@ bool ShowIFMapPendingVmReg::BufferStage(const Sandesh *sr,
                                         mapper->pending_vmreg_map_.begin();
          iter != mapper->pending_vmreg_map_.end(); ++iter) {
         IFMapPendingVmRegEntry dest;
-        dest.set_vm_uuid(iter->first);
+        dest.set_vm_uuid(IFMapUuidMapper::UuidToString(iter->first));
         dest.set_vr_name(iter->second);
         show_data->send_buffer.push_back(dest);
     }
@@ -171,6 +171,7 @@ public:
     const BitSet &nmask() const { return nmask_; }
     void nmask_clear() { nmask_.clear(); }
     void nmask_set(int bit) { nmask_.set(bit); }
+    void nmask_or(const BitSet &bset) { nmask_ |= bset; }
 
 private:
     DEPENDENCY_LIST(IFMapLink, IFMapNodeState, dependents_);
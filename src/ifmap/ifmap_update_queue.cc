@@ -46,23 +46,25 @@ void IFMapUpdateQueue::Dequeue(IFMapUpdate *update) {
 }
 
 IFMapMarker *IFMapUpdateQueue::GetMarker(int bit) {
-    MarkerMap::iterator loc = marker_map_.find(bit);
-    if (loc == marker_map_.end()) {
+    if ((bit < 0) || ((size_t) bit >= marker_map_.size())) {
         return NULL;
     }
-    return loc->second;
+    return marker_map_[bit];
 }
 
 void IFMapUpdateQueue::Join(int bit) {
     IFMapMarker *marker = &tail_marker_;
     marker->mask.set(bit);
-    marker_map_.insert(std::make_pair(bit, marker));
+    if ((size_t) bit >= marker_map_.size()) {
+        marker_map_.resize(bit + 1, NULL);
+    }
+    assert(marker_map_[bit] == NULL);
+    marker_map_[bit] = marker;
 }
 
 void IFMapUpdateQueue::Leave(int bit) {
-    MarkerMap::iterator loc = marker_map_.find(bit);
-    assert(loc != marker_map_.end());
-    IFMapMarker *marker = loc->second;
+    IFMapMarker *marker = GetMarker(bit);
+    assert(marker != NULL);
 
     BitSet reset_bs;
     reset_bs.set(bit);
@@ -85,7 +87,7 @@ void IFMapUpdateQueue::Leave(int bit) {
         server_->exporter()->StateUpdateOnDequeue(update, reset_bs, true);
     }
 
-    marker_map_.erase(loc);
+    marker_map_[bit] = NULL;
     marker->mask.reset(bit);
     if ((marker != &tail_marker_)  && (marker->mask.empty())) {
         list_.erase(list_.iterator_to(*marker));
@@ -101,12 +103,7 @@ void IFMapUpdateQueue::MarkerMerge(IFMapMarker *dst, IFMapMarker *src,
     // Call to operator|=()
     //
     dst->mask |= mmove;
-    for (size_t i = mmove.find_first();
-         i != BitSet::npos; i = mmove.find_next(i)) {
-        MarkerMap::iterator loc = marker_map_.find(i);
-        assert(loc != marker_map_.end());
-        loc->second = dst;
-    }
+    MarkerSetAll(dst, mmove);
     // Reset the bits in the src and get rid of it in case it's now empty.
     src->mask.Reset(mmove);
     if (src->mask.empty()) {
@@ -116,6 +113,15 @@ void IFMapUpdateQueue::MarkerMerge(IFMapMarker *dst, IFMapMarker *src,
     }
 }
 
+// Point the MarkerMap entry of every client in mset to marker.
+void IFMapUpdateQueue::MarkerSetAll(IFMapMarker *marker, const BitSet &mset) {
+    for (size_t i = mset.find_first();
+         i != BitSet::npos; i = mset.find_next(i)) {
+        assert(i < marker_map_.size() && marker_map_[i] != NULL);
+        marker_map_[i] = marker;
+    }
+}
+
 IFMapMarker* IFMapUpdateQueue::MarkerSplit(IFMapMarker *marker,
                                            IFMapListEntry *current, 
                                            const BitSet &msplit, bool before) {
@@ -127,12 +133,7 @@ IFMapMarker* IFMapUpdateQueue::MarkerSplit(IFMapMarker *marker,
     marker->mask.Reset(msplit);
     assert(!marker->mask.empty());
 
-    for (size_t i = msplit.find_first();
-         i != BitSet::npos; i = msplit.find_next(i)) {
-        MarkerMap::iterator loc = marker_map_.find(i);
-        assert(loc != marker_map_.end());
-        loc->second = new_marker;
-    }
+    MarkerSetAll(new_marker, new_marker->mask);
     if (before) {
         // Insert new_marker before current
         list_.insert(list_.iterator_to(*current), *new_marker);
@@ -5,7 +5,7 @@
 #ifndef __ctrlplane__ifmap_update_queue__
 #define __ctrlplane__ifmap_update_queue__
 
-#include <map>
+#include <vector>
 #include "ifmap/ifmap_update.h"
 
 class IFMapServer;
@@ -19,7 +19,10 @@ public:
     > MemberHook;
     typedef boost::intrusive::list<IFMapListEntry, MemberHook> List;
 
-    typedef std::map<int, IFMapMarker *> MarkerMap;
+    // Indexed by client index. Client indices are allocated densely by the
+    // server, so a flat vector gives O(1) lookups when markers are split and
+    // merged. Entries for clients that are not joined are NULL.
+    typedef std::vector<IFMapMarker *> MarkerMap;
 
     explicit IFMapUpdateQueue(IFMapServer *server);
 
@@ -99,6 +102,7 @@ private:
 
     IFMapMarker* MarkerSplit(IFMapMarker *marker, IFMapListEntry *current, 
                              const BitSet &msplit, bool before);
+    void MarkerSetAll(IFMapMarker *marker, const BitSet &mset);
 };
 
 #endif /* defined(__ctrlplane__ifmap_update_queue__) */
@@ -232,6 +232,9 @@ void IFMapUpdateSender::SendUpdate(BitSet send_set, BitSet *blocked_set) {
 
     assert(!message_->IsEmpty());
 
+    // Serialize the message once. Only the envelope differs per client.
+    message_->Close();
+
     for (size_t i = send_set.find_first(); i != BitSet::npos;
          i = send_set.find_next(i)) {
         assert(!send_blocked_.test(i));
@@ -240,11 +243,9 @@ void IFMapUpdateSender::SendUpdate(BitSet send_set, BitSet *blocked_set) {
             continue;
         }
         message_->SetReceiverInMsg(client->identifier());
-        // Close the message to save the document as string
-        message_->Close();
 
         // Send the string version of the message to the client.
-        send_result = client->SendUpdate(message_->c_str());
+        send_result = client->SendUpdate(message_->get_string());
 
         // Keep track of all the clients whose buffers are full. 
         if (!send_result) {
@@ -4,6 +4,8 @@
 
 #include "ifmap/ifmap_uuid_mapper.h"
 
+#include <boost/uuid/uuid_io.hpp>
+
 #include "db/db.h"
 #include "db/db_table_partition.h"
 #include "ifmap/ifmap_node.h"
@@ -25,39 +27,79 @@ void IFMapUuidMapper::SetUuid(uint64_t ms_long, uint64_t ls_long,
     }
 }
 
-std::string IFMapUuidMapper::UuidToString(const boost::uuids::uuid &id) {   
+std::string IFMapUuidMapper::UuidToString(const boost::uuids::uuid &id) {
     std::stringstream uuid_str;
     uuid_str << id;
     return uuid_str.str();
 }
 
-std::string IFMapUuidMapper::Add(uint64_t ms_long, uint64_t ls_long,
-                                 IFMapNode *node) {
+static int HexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool IFMapUuidMapper::StringToUuid(const std::string &uuid_str,
+                                   boost::uuids::uuid *uuid) {
+    if (uuid_str.size() != 36) {
+        return false;
+    }
+    size_t pos = 0;
+    for (int i = 0; i < 16; i++) {
+        if (pos == 8 || pos == 13 || pos == 18 || pos == 23) {
+            if (uuid_str[pos] != '-') {
+                return false;
+            }
+            pos++;
+        }
+        int hi = HexDigit(uuid_str[pos]);
+        int lo = HexDigit(uuid_str[pos + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        uuid->data[i] = (hi << 4) | lo;
+        pos += 2;
+    }
+    return true;
+}
+
+boost::uuids::uuid IFMapUuidMapper::Add(uint64_t ms_long, uint64_t ls_long,
+                                        IFMapNode *node) {
     boost::uuids::uuid uu_id;
     SetUuid(ms_long, ls_long, uu_id);
-    std::string uuid_str = UuidToString(uu_id);
-    uuid_node_map_.insert(std::make_pair(uuid_str, node));
-    return uuid_str;
+    uuid_node_map_.insert(std::make_pair(uu_id, node));
+    return uu_id;
 }
 
-void IFMapUuidMapper::Delete(const std::string &uuid_str) {
-    uuid_node_map_.erase(uuid_str);
+void IFMapUuidMapper::Delete(const boost::uuids::uuid &uuid) {
+    uuid_node_map_.erase(uuid);
 }
 
-IFMapNode *IFMapUuidMapper::Find(const std::string &uuid_str) {
-    UuidNodeMap::iterator loc = uuid_node_map_.find(uuid_str);
+IFMapNode *IFMapUuidMapper::Find(const boost::uuids::uuid &uuid) {
+    UuidNodeMap::iterator loc = uuid_node_map_.find(uuid);
     if (loc != uuid_node_map_.end()) {
-        return loc->second;;
+        return loc->second;
     }
     return NULL;
 }
 
-bool IFMapUuidMapper::Exists(const std::string &uuid_str) {
-    UuidNodeMap::iterator loc = uuid_node_map_.find(uuid_str);
-    if (loc != uuid_node_map_.end()) {
-        return true;
+IFMapNode *IFMapUuidMapper::Find(const std::string &uuid_str) {
+    boost::uuids::uuid uuid;
+    if (!StringToUuid(uuid_str, &uuid)) {
+        return NULL;
     }
-    return false;
+    return Find(uuid);
+}
+
+bool IFMapUuidMapper::Exists(const std::string &uuid_str) {
+    return (Find(uuid_str) != NULL);
 }
 
 void IFMapUuidMapper::PrintAllMappedEntries() {
@@ -65,7 +107,8 @@ void IFMapUuidMapper::PrintAllMappedEntries() {
     for (UuidNodeMap::iterator iter = uuid_node_map_.begin();
          iter != uuid_node_map_.end(); ++iter) {
         IFMapNode *node = iter->second;
-        std::cout << iter->first << " : " << node->ToString() << std::endl;
+        std::cout << UuidToString(iter->first) << " : " << node->ToString()
+                  << std::endl;
     }
 }
 
@@ -102,7 +145,7 @@ void IFMapVmUuidMapper::VmNodeProcess(DBTablePartBase *partition,
     assert(tname.compare("virtual-machine") == 0);
 
     if (!IsFeasible(vm_node)) {
-        std::string vm_uuid;
+        boost::uuids::uuid vm_uuid;
         bool val = NodeToUuid(vm_node, &vm_uuid);
 
         // Its possible that the add came without any properties i.e no object
@@ -126,7 +169,7 @@ void IFMapVmUuidMapper::VmNodeProcess(DBTablePartBase *partition,
                                                         (object);
         if (vm->IsPropertySet(autogen::VirtualMachine::ID_PERMS)) {
             autogen::UuidType uuid = vm->id_perms().uuid;
-            std::string vm_uuid = 
+            boost::uuids::uuid vm_uuid =
                 uuid_mapper_.Add(uuid.uuid_mslong, uuid.uuid_lslong, vm_node);
 
             // Insert into the node-uuid-map
@@ -134,13 +177,12 @@ void IFMapVmUuidMapper::VmNodeProcess(DBTablePartBase *partition,
 
             // Check if there were any vm-reg's for this VM whose processing we
             // had deferred since the vm-node did not exist then.
-            std::string vr_name;
-            bool exists = PendingVmRegExists(vm_uuid, &vr_name);
-            if (exists) {
+            PendingVmRegMap::iterator loc = pending_vmreg_map_.find(vm_uuid);
+            if (loc != pending_vmreg_map_.end()) {
                 bool subscribe = true;
-                ifmap_server_->ProcessVmSubscribe(vr_name, vm_node->name(),
+                ifmap_server_->ProcessVmSubscribe(loc->second, vm_node->name(),
                                                   subscribe);
-                pending_vmreg_map_.erase(vm_uuid);
+                pending_vmreg_map_.erase(loc);
             }
         }
     }
@@ -158,18 +200,28 @@ void IFMapVmUuidMapper::PrintAllUuidMapperEntries() {
     uuid_mapper_.PrintAllMappedEntries();
 }
 
+// A vm-reg whose uuid does not parse can never match a config vm-node, so it
+// is not kept as pending.
 void IFMapVmUuidMapper::ProcessVmRegAsPending(std::string vm_uuid,
         std::string vr_name, bool subscribe) {
+    boost::uuids::uuid uuid;
+    if (!IFMapUuidMapper::StringToUuid(vm_uuid, &uuid)) {
+        return;
+    }
     if (subscribe) {
-        pending_vmreg_map_.insert(make_pair(vm_uuid, vr_name));
+        pending_vmreg_map_.insert(make_pair(uuid, vr_name));
     } else {
-        pending_vmreg_map_.erase(vm_uuid);
+        pending_vmreg_map_.erase(uuid);
     }
 }
 
 bool IFMapVmUuidMapper::PendingVmRegExists(const std::string &vm_uuid,
                                            std::string *vr_name) {
-    PendingVmRegMap::iterator loc = pending_vmreg_map_.find(vm_uuid);
+    boost::uuids::uuid uuid;
+    if (!IFMapUuidMapper::StringToUuid(vm_uuid, &uuid)) {
+        return false;
+    }
+    PendingVmRegMap::iterator loc = pending_vmreg_map_.find(uuid);
     if (loc != pending_vmreg_map_.end()) {
         *vr_name = loc->second;
         return true;
@@ -177,11 +229,19 @@ bool IFMapVmUuidMapper::PendingVmRegExists(const std::string &vm_uuid,
     return false;
 }
 
+void IFMapVmUuidMapper::CleanupPendingVmRegEntry(const std::string &vm_uuid) {
+    boost::uuids::uuid uuid;
+    if (IFMapUuidMapper::StringToUuid(vm_uuid, &uuid)) {
+        pending_vmreg_map_.erase(uuid);
+    }
+}
+
 void IFMapVmUuidMapper::PrintAllPendingVmRegEntries() {
     std::cout << "Printing all pending vm-reg entries - VM-UUID : VR-FQN\n";
     for (PendingVmRegMap::iterator iter = pending_vmreg_map_.begin();
          iter != pending_vmreg_map_.end(); ++iter) {
-        std::cout << iter->first << " : " << iter->second << std::endl;
+        std::cout << IFMapUuidMapper::UuidToString(iter->first) << " : "
+                  << iter->second << std::endl;
     }
 }
 
@@ -192,7 +252,8 @@ bool IFMapVmUuidMapper::IsFeasible(IFMapNode *node) {
     return true;
 }
 
-bool IFMapVmUuidMapper::NodeToUuid(IFMapNode *vm_node, std::string *vm_uuid) {
+bool IFMapVmUuidMapper::NodeToUuid(IFMapNode *vm_node,
+                                   boost::uuids::uuid *vm_uuid) {
     NodeUuidMap::iterator loc = node_uuid_map_.find(vm_node);
     if (loc != node_uuid_map_.end()) {
         *vm_uuid = loc->second;
@@ -214,7 +275,8 @@ void IFMapVmUuidMapper::PrintAllNodeUuidMappedEntries() {
     for (NodeUuidMap::iterator iter = node_uuid_map_.begin();
          iter != node_uuid_map_.end(); ++iter) {
         IFMapNode *node = iter->first;
-        std::cout << node->ToString() << " : " << iter->second << std::endl;
+        std::cout << node->ToString() << " : "
+                  << IFMapUuidMapper::UuidToString(iter->second) << std::endl;
     }
 }
 
@@ -6,8 +6,9 @@
 #define __IFMAP_UUID_MAPPER_H__
 
 #include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/uuid/uuid.hpp>
-#include <boost/uuid/uuid_io.hpp>
 
 #include "db/db_table.h"
 
@@ -20,25 +21,36 @@ class IFMapNode;
 class IFMapServer;
 class IFMapServerTable;
 
-// Maintains a mapping of [uuid, node]
+// Maintains a mapping of [uuid, node]. The maps are keyed by the 128-bit
+// uuid value; the string form is only parsed at the agent (xmpp) boundary and
+// only formatted for introspect.
 class IFMapUuidMapper {
 public:
-    typedef std::map<std::string, IFMapNode *> UuidNodeMap;
+    typedef boost::hash<boost::uuids::uuid> UuidHash;
+    typedef boost::unordered_map<boost::uuids::uuid, IFMapNode *, UuidHash>
+        UuidNodeMap;
     typedef UuidNodeMap::size_type Sz_t;
 
-    std::string Add(uint64_t ms_long, uint64_t ls_long, IFMapNode *node);
-    void Delete(const std::string &uuid_str);
+    boost::uuids::uuid Add(uint64_t ms_long, uint64_t ls_long,
+                           IFMapNode *node);
+    void Delete(const boost::uuids::uuid &uuid);
+    IFMapNode *Find(const boost::uuids::uuid &uuid);
     IFMapNode *Find(const std::string &uuid_str);
     bool Exists(const std::string &uuid_str);
     void PrintAllMappedEntries();
     Sz_t Size() { return uuid_node_map_.size(); }
 
+    static void SetUuid(uint64_t ms_long, uint64_t ls_long,
+                        boost::uuids::uuid &uu_id);
+    // Parses the canonical 8-4-4-4-12 hex form. Returns false on any other
+    // input.
+    static bool StringToUuid(const std::string &uuid_str,
+                             boost::uuids::uuid *uuid);
+    static std::string UuidToString(const boost::uuids::uuid &id);
+
 private:
     friend class ShowIFMapUuidToNodeMapping;
 
-    void SetUuid(uint64_t ms_long, uint64_t ls_long, boost::uuids::uuid &uu_id);
-    std::string UuidToString(const boost::uuids::uuid &id);
-
     UuidNodeMap uuid_node_map_;
 };
 
@@ -46,12 +58,13 @@ class IFMapVmUuidMapper {
 public:
     // Store [vm-uuid, vr-name] from the vm-reg request
     // ADD: vm-reg-request, DELETE: vm-node add/xmpp-not-ready
-    typedef std::map<std::string, std::string> PendingVmRegMap;
+    typedef boost::unordered_map<boost::uuids::uuid, std::string,
+                                 IFMapUuidMapper::UuidHash> PendingVmRegMap;
     // Store [vm-node, vm-uuid]. Used to clean-up uuid_mapper_'s 'vm-uuid'
     // entry when the vm-node becomes InFeasible. The objects would be gone by
     // then and the uuid would not be available from the node.
     // ADD: config vm-node add, DELETE: config vm-node delete
-    typedef std::map<IFMapNode *, std::string> NodeUuidMap;
+    typedef boost::unordered_map<IFMapNode *, boost::uuids::uuid> NodeUuidMap;
 
     explicit IFMapVmUuidMapper(DB *db, IFMapServer *server);
     ~IFMapVmUuidMapper();
@@ -78,12 +91,10 @@ public:
     PendingVmRegMap::size_type PendingVmRegCount() {
         return pending_vmreg_map_.size();
     }
-    void CleanupPendingVmRegEntry(const std::string &vm_uuid) {
-        pending_vmreg_map_.erase(vm_uuid);
-    }
+    void CleanupPendingVmRegEntry(const std::string &vm_uuid);
     void PrintAllPendingVmRegEntries();
 
-    bool NodeToUuid(IFMapNode *vm_node, std::string *vm_uuid);
+    bool NodeToUuid(IFMapNode *vm_node, boost::uuids::uuid *vm_uuid);
     bool NodeProcessed(IFMapNode *node);
     NodeUuidMap::size_type NodeUuidMapCount() {
         return node_uuid_map_.size();
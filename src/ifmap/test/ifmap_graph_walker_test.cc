@@ -233,6 +233,51 @@ TEST_F(IFMapGraphWalkerTest, Cli2Vn2Vm2Add) {
     TASK_UTIL_EXPECT_EQ(c2.NodeKeyCount("virtual-machine-interface"), 1);
 }
 
+// Unsubscribe the VMs of both clients back to back, so that the interest of
+// both clients is recomputed in the same walker batch.
+TEST_F(IFMapGraphWalkerTest, Cli2Vn2Vm2Remove) {
+    string content =
+        FileRead("controller/src/ifmap/testdata/cli2_vn2_vm2_add.xml");
+    assert(content.size() != 0);
+    parser_->Receive(&db_, content.c_str(), content.size(), 0);
+    task_util::WaitForIdle();
+
+    IFMapClientMock
+        c1("default-global-system-config:a1s27.contrail.juniper.net");
+    server_.AddClient(&c1);
+    server_.ProcessVmSubscribe(
+        "default-global-system-config:a1s27.contrail.juniper.net",
+        "0af0866c-08c9-49ae-856b-0f4a58179920", true, 1);
+    IFMapClientMock
+        c2("default-global-system-config:a1s28.contrail.juniper.net");
+    server_.AddClient(&c2);
+    server_.ProcessVmSubscribe(
+        "default-global-system-config:a1s28.contrail.juniper.net",
+        "0d9dd007-b25a-4d86-bf68-dc0e85e317e3", true, 1);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(c1.NodeKeyCount("virtual-network"), 1);
+    TASK_UTIL_EXPECT_EQ(c2.NodeKeyCount("virtual-network"), 1);
+
+    server_.ProcessVmSubscribe(
+        "default-global-system-config:a1s27.contrail.juniper.net",
+        "0af0866c-08c9-49ae-856b-0f4a58179920", false, 1);
+    server_.ProcessVmSubscribe(
+        "default-global-system-config:a1s28.contrail.juniper.net",
+        "0d9dd007-b25a-4d86-bf68-dc0e85e317e3", false, 1);
+    task_util::WaitForIdle();
+
+    TASK_UTIL_EXPECT_EQ(c1.NodeKeyCount("virtual-network"), 0);
+    TASK_UTIL_EXPECT_EQ(c1.NodeKeyCount("virtual-machine"), 0);
+    TASK_UTIL_EXPECT_EQ(c1.NodeKeyCount("virtual-machine-interface"), 0);
+    TASK_UTIL_EXPECT_TRUE(c1.NodeExists("virtual-router",
+        "default-global-system-config:a1s27.contrail.juniper.net"));
+    TASK_UTIL_EXPECT_EQ(c2.NodeKeyCount("virtual-network"), 0);
+    TASK_UTIL_EXPECT_EQ(c2.NodeKeyCount("virtual-machine"), 0);
+    TASK_UTIL_EXPECT_EQ(c2.NodeKeyCount("virtual-machine-interface"), 0);
+    TASK_UTIL_EXPECT_TRUE(c2.NodeExists("virtual-router",
+        "default-global-system-config:a1s28.contrail.juniper.net"));
+}
+
 TEST_F(IFMapGraphWalkerTest, Cli1Vn2Np2Add) {
     string content = 
         FileRead("controller/src/ifmap/testdata/cli1_vn2_np2_add.xml");
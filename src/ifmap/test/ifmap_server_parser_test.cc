@@ -1695,6 +1695,87 @@ TEST_F(IFMapServerParserTest, ServerParser16InParts) {
     EXPECT_TRUE(LinkLookup(vr1, vm1) != NULL);
 }
 
+// Same as ServerParser except that the message is fed to the stream parser
+// in small chunks, so that tags and result items straddle chunk boundaries.
+TEST_F(IFMapServerParserTest, ServerParserStreamed) {
+    IFMapTable *table = IFMapTable::FindTable(&db_, "virtual-network");
+
+    string message =
+        FileRead("controller/src/ifmap/testdata/server_parser_test.xml");
+    assert(message.size() != 0);
+    IFMapServerParser::Stream stream(parser_, &db_, 0);
+    const size_t kChunkSize = 7;
+    size_t offset = 0;
+    for (; offset + kChunkSize < message.size(); offset += kChunkSize) {
+        EXPECT_TRUE(stream.Feed(message.data() + offset, kChunkSize));
+    }
+    EXPECT_TRUE(stream.Finish(message.data() + offset,
+                              message.size() - offset));
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, table->Size());
+
+    IFMapNode *vn1 = NodeLookup("virtual-network", "vn1");
+    EXPECT_TRUE(vn1 != NULL);
+    IFMapNode *vn = NodeLookup("virtual-network", "vn2");
+    EXPECT_TRUE(vn == NULL);
+    vn = NodeLookup("virtual-network", "vn5");
+    EXPECT_TRUE(vn == NULL);
+}
+
+// Feed a large message one chunk at a time and verify that every
+// resultItem is parsed, whatever the chunk size.
+TEST_F(IFMapServerParserTest, ServerParserStreamedChunkSizes) {
+    string message =
+        FileRead("controller/src/ifmap/testdata/cli2_vn3_vm6_np2_add.xml");
+    assert(message.size() != 0);
+
+    size_t chunk_sizes[] = { 1, 13, 512, 4096, message.size() };
+    for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(size_t); i++) {
+        IFMapServerParser::Stream stream(parser_, &db_, 0);
+        size_t offset = 0;
+        for (; offset + chunk_sizes[i] < message.size();
+             offset += chunk_sizes[i]) {
+            EXPECT_TRUE(stream.Feed(message.data() + offset, chunk_sizes[i]));
+        }
+        EXPECT_TRUE(stream.Finish(message.data() + offset,
+                                  message.size() - offset));
+        EXPECT_EQ(173, stream.item_count());
+        task_util::WaitForIdle();
+    }
+    EXPECT_TRUE(NodeLookup("virtual-network",
+        "default-domain:default-project:ip-fabric") != NULL);
+}
+
+// A message that ends in the middle of a result element is rejected and
+// none of the items that preceded the truncation are applied.
+TEST_F(IFMapServerParserTest, ServerParserTruncated) {
+    IFMapTable *table = IFMapTable::FindTable(&db_, "virtual-network");
+
+    string message =
+        FileRead("controller/src/ifmap/testdata/server_parser_test.xml");
+    assert(message.size() != 0);
+    size_t pos = message.find("</updateResult>");
+    assert(pos != string::npos);
+    EXPECT_FALSE(parser_->Receive(&db_, message.data(), pos, 0));
+    task_util::WaitForIdle();
+    EXPECT_EQ(0, table->Size());
+    EXPECT_TRUE(NodeLookup("virtual-network", "vn1") == NULL);
+
+    // A stream that is never finished does not enqueue anything either.
+    {
+        IFMapServerParser::Stream stream(parser_, &db_, 0);
+        EXPECT_TRUE(stream.Feed(message.data(), pos));
+        EXPECT_LT(0, stream.item_count());
+    }
+    task_util::WaitForIdle();
+    EXPECT_EQ(0, table->Size());
+
+    EXPECT_TRUE(parser_->Receive(&db_, message.data(), message.size(), 0));
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, table->Size());
+    EXPECT_TRUE(NodeLookup("virtual-network", "vn1") != NULL);
+}
+
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -10,11 +10,15 @@
 #include "control-node/control_node.h"
 #include "db/db.h"
 #include "db/db_graph.h"
+#include "db/db_table_partition.h"
 #include "io/event_manager.h"
 #include "ifmap/ifmap_client.h"
+#include "ifmap/ifmap_exporter.h"
+#include "ifmap/ifmap_link.h"
 #include "ifmap/ifmap_link_table.h"
 #include "ifmap/ifmap_server_parser.h"
 #include "ifmap/ifmap_table.h"
+#include "ifmap/ifmap_update.h"
 #include "ifmap/ifmap_update_queue.h"
 #include "ifmap/test/ifmap_client_mock.h"
 #include "ifmap/test/ifmap_test_util.h"
@@ -74,6 +78,46 @@ class IFMapServerTest : public ::testing::Test {
         return content;
     }
 
+    static bool HasClientBit(const IFMapState *state, size_t index) {
+        return (state != NULL &&
+                (state->interest().test(index) ||
+                 state->advertised().test(index)));
+    }
+
+    // Counts the nodes and links whose interest or advertised sets include
+    // the client with the given index.
+    void CountClientBits(size_t index, int *nodes, int *links) {
+        IFMapExporter *exporter = server_.exporter();
+        *nodes = 0;
+        for (DB::iterator iter = db_.lower_bound("__ifmap__");
+             iter != db_.end(); ++iter) {
+            DBTable *table = static_cast<DBTable *>(iter->second);
+            if (table->name().find("__ifmap__") != 0) {
+                break;
+            }
+            DBTablePartition *partition =
+                static_cast<DBTablePartition *>(table->GetTablePartition(0));
+            for (DBEntryBase *entry = partition->GetFirst(); entry;
+                 entry = partition->GetNext(entry)) {
+                IFMapNode *node = static_cast<IFMapNode *>(entry);
+                if (HasClientBit(exporter->NodeStateLookup(node), index)) {
+                    (*nodes)++;
+                }
+            }
+        }
+
+        *links = 0;
+        DBTablePartition *partition = static_cast<DBTablePartition *>(
+            exporter->link_table()->GetTablePartition(0));
+        for (DBEntryBase *entry = partition->GetFirst(); entry;
+             entry = partition->GetNext(entry)) {
+            IFMapLink *link = static_cast<IFMapLink *>(entry);
+            if (HasClientBit(exporter->LinkStateLookup(link), index)) {
+                (*links)++;
+            }
+        }
+    }
+
     DB db_;
     DBGraph db_graph_;
     EventManager evm_;
@@ -170,6 +214,57 @@ TEST_F(IFMapServerTest, ClientUnregister) {
     delete c1;
 }
 
+// Deleting a client clears its bits on every node and link, and leaves the
+// bits of a client that shares part of its graph untouched.
+TEST_F(IFMapServerTest, ClientGraphCleanup) {
+    IFMapClientMock *c1 = new IFMapClientMock("orange");
+    IFMapClientMock *c2 = new IFMapClientMock("blue");
+    server_.AddClient(c1);
+    server_.AddClient(c2);
+
+    IFMapVRouterLink(&db_, "orange", "net0");
+    IFMapVRouterLink(&db_, "blue", "net0");
+
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_TRUE(server_.queue()->empty());
+    TASK_UTIL_EXPECT_EQ(7, c1->count());
+    TASK_UTIL_EXPECT_EQ(7, c2->count());
+
+    int c1_nodes, c1_links, c2_nodes, c2_links;
+    CountClientBits(c1->index(), &c1_nodes, &c1_links);
+    CountClientBits(c2->index(), &c2_nodes, &c2_links);
+    EXPECT_LT(0, c1_nodes);
+    EXPECT_LT(0, c1_links);
+    EXPECT_LT(0, c2_nodes);
+    EXPECT_LT(0, c2_links);
+
+    // Both vrouters share virtual-network net0.
+    IFMapTable *table = IFMapTable::FindTable(&db_, "virtual-network");
+    IFMapNode *net0 = table->FindNode("net0");
+    ASSERT_TRUE(net0 != NULL);
+    IFMapNodeState *state = server_.exporter()->NodeStateLookup(net0);
+    EXPECT_TRUE(HasClientBit(state, c1->index()));
+    EXPECT_TRUE(HasClientBit(state, c2->index()));
+
+    int c1_index = c1->index();
+    server_.DeleteClient(c1);
+    task_util::WaitForIdle();
+
+    int nodes, links;
+    CountClientBits(c1_index, &nodes, &links);
+    EXPECT_EQ(0, nodes);
+    EXPECT_EQ(0, links);
+    CountClientBits(c2->index(), &nodes, &links);
+    EXPECT_EQ(c2_nodes, nodes);
+    EXPECT_EQ(c2_links, links);
+    EXPECT_TRUE(HasClientBit(state, c2->index()));
+
+    server_.DeleteClient(c2);
+    task_util::WaitForIdle();
+    delete c2;
+    delete c1;
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     LoggingInit();
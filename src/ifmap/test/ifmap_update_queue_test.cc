@@ -141,6 +141,95 @@ TEST_F(IFMapUpdateQueueTest, Basic) {
     delete(u4);
 }
 
+// Many clients repeatedly block on different updates and then catch up with
+// the tail marker. Client kClients never blocks and stays in the tail marker.
+TEST_F(IFMapUpdateQueueTest, ClientFlap) {
+    static const int kClients = 2000;
+    static const int kUpdates = 4;
+    static const int kRounds = 5;
+    IFMapTable::RequestKey key;
+
+    vector<DBEntry *> nodes;
+    vector<IFMapUpdate *> updates;
+    for (int i = 0; i < kUpdates; i++) {
+        key.id_name = string(1, 'a' + i);
+        nodes.push_back(tbl_->AllocEntry(&key));
+        updates.push_back(CreateUpdate(nodes.back()));
+    }
+
+    for (int i = 0; i <= kClients; i++) {
+        queue_->Join(i);
+    }
+    for (int i = 0; i < kUpdates; i++) {
+        queue_->Enqueue(updates[i]);
+    }
+
+    for (int round = 0; round < kRounds; round++) {
+        // Every client ends up with a marker of its own after one of the
+        // updates.
+        for (int i = 0; i < kClients; i++) {
+            IFMapMarker *marker = queue_->GetMarker(i);
+            ASSERT_TRUE(marker != NULL);
+            BitSet bs;
+            bs.set(i);
+            IFMapUpdate *update = updates[(i + round) % kUpdates];
+            if (marker != queue_->tail_marker() && marker->mask == bs) {
+                queue_->MoveMarkerAfter(marker, update);
+            } else {
+                queue_->MarkerSplitAfter(marker, update, bs);
+            }
+        }
+        EXPECT_EQ(kUpdates + 1 + kClients, queue_->size());
+        EXPECT_EQ(1U, queue_->tail_marker()->mask.count());
+        for (int i = 0; i < kClients; i++) {
+            IFMapMarker *marker = queue_->GetMarker(i);
+            ASSERT_TRUE(marker != NULL);
+            EXPECT_NE(queue_->tail_marker(), marker);
+            EXPECT_EQ(1U, marker->mask.count());
+            EXPECT_TRUE(marker->mask.test(i));
+        }
+
+        // Merge them all back into the tail marker.
+        for (int i = 0; i < kClients; i++) {
+            BitSet bs;
+            bs.set(i);
+            queue_->MarkerMerge(queue_->tail_marker(), queue_->GetMarker(i),
+                                bs);
+        }
+        EXPECT_EQ(kUpdates + 1, queue_->size());
+        EXPECT_EQ(kClients + 1U, queue_->tail_marker()->mask.count());
+        for (int i = 0; i < kClients; i++) {
+            EXPECT_EQ(queue_->tail_marker(), queue_->GetMarker(i));
+        }
+    }
+
+    for (int i = 0; i < kUpdates; i++) {
+        queue_->Dequeue(updates[i]);
+        delete updates[i];
+        delete nodes[i];
+    }
+    EXPECT_EQ(1, queue_->size());
+
+    // Half of the clients go away and come back.
+    for (int i = 0; i < kClients; i += 2) {
+        queue_->Leave(i);
+        EXPECT_TRUE(queue_->GetMarker(i) == NULL);
+    }
+    EXPECT_EQ(kClients / 2 + 1U, queue_->tail_marker()->mask.count());
+    for (int i = 0; i < kClients; i += 2) {
+        queue_->Join(i);
+    }
+    EXPECT_EQ(kClients + 1U, queue_->tail_marker()->mask.count());
+
+    for (int i = 0; i <= kClients; i++) {
+        queue_->Leave(i);
+    }
+    EXPECT_TRUE(queue_->tail_marker()->mask.empty());
+    EXPECT_TRUE(queue_->GetMarker(0) == NULL);
+    EXPECT_TRUE(queue_->GetMarker(kClients) == NULL);
+    EXPECT_TRUE(queue_->GetMarker(kClients + 1) == NULL);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     bool success = RUN_ALL_TESTS();
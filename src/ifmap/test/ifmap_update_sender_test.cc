@@ -4,14 +4,18 @@
 
 #include "ifmap/ifmap_update_sender.h"
 
+#include <boost/ptr_container/ptr_vector.hpp>
+
 #include "base/logging.h"
 #include "base/task.h"
 #include "base/test/task_test_util.h"
+#include "base/util.h"
 #include "db/db.h"
 #include "db/db_graph.h"
 #include "db/db_table.h"
 #include "io/event_manager.h"
 #include "ifmap/ifmap_client.h"
+#include "ifmap/ifmap_encoder.h"
 #include "ifmap/ifmap_exporter.h"
 #include "ifmap/ifmap_link_table.h"
 #include "ifmap/ifmap_node.h"
@@ -27,7 +31,8 @@ using namespace std;
 class TestClient : public IFMapClient {
 public:
     TestClient(const string &addr)
-        : identifier_(addr), send_success_(true), send_update_cnt_(0) {
+        : identifier_(addr), send_success_(true), send_update_cnt_(0),
+          verbose_(true) {
     }
 
     virtual const string &identifier() const {
@@ -35,12 +40,17 @@ public:
     }
 
     virtual bool SendUpdate(const std::string &msg) {
-        cout << "Sending " << endl << msg << endl;
+        if (verbose_) {
+            cout << "Sending " << endl << msg << endl;
+        }
+        last_msg_ = msg;
         send_update_cnt_++;
         return send_success_;
     }
 
     int get_send_update_cnt() { return send_update_cnt_; }
+    const string &last_msg() const { return last_msg_; }
+    void set_verbose(bool verbose) { verbose_ = verbose; }
 
     // Control if you want to block or continue sending
     void set_send_success(bool succ) { send_success_ = succ; }
@@ -49,6 +59,8 @@ private:
     string identifier_;
     bool send_success_;
     int send_update_cnt_;
+    bool verbose_;
+    string last_msg_;
 };
 
 struct IFMapUpdateDeleter {
@@ -164,6 +176,78 @@ TEST_F(IFMapUpdateSenderTest, BasicQTraversal) {
     queue_->Leave(c0.index());
 }
 
+// Send the same updates to a large number of clients. The message is encoded
+// once and each client gets the same body with its own envelope.
+TEST_F(IFMapUpdateSenderTest, ManyClients) {
+    static const int kClientCount = 1000;
+    static const int kMessageCount = 4;
+    boost::ptr_vector<TestClient> clients;
+    BitSet cli_bs;
+
+    for (int i = 0; i < kClientCount; i++) {
+        TestClient *client = new TestClient("c" + integerToString(i));
+        client->set_verbose(false);
+        clients.push_back(client);
+        server_.ClientRegister(client);
+        cli_bs.set(client->index());
+        queue_->Join(client->index());
+    }
+
+    for (int i = 0; i < kMessageCount * IFMapMessage::kObjectsPerMessage;
+         i++) {
+        string name = "u" + integerToString(i);
+        IFMapUpdate *update = CreateUpdate(name.c_str(), true);
+        update->AdvertiseOr(cli_bs);
+        queue_->Enqueue(update);
+    }
+
+    sender_->QueueActive();
+    task_util::WaitForIdle();
+
+    TASK_UTIL_EXPECT_EQ(1, queue_->size());
+    TASK_UTIL_EXPECT_TRUE(queue_->GetLast() == queue_->tail_marker());
+
+    size_t body_offset = clients[0].last_msg().find("<config>");
+    ASSERT_NE(string::npos, body_offset);
+    string body = clients[0].last_msg().substr(body_offset);
+    for (int i = 0; i < kClientCount; i++) {
+        TestClient &client = clients[i];
+        EXPECT_EQ(kMessageCount, client.get_send_update_cnt());
+        string to = "to=\"" + client.identifier() + "/config\"";
+        EXPECT_NE(string::npos, client.last_msg().find(to));
+        EXPECT_EQ(body, client.last_msg().substr(body_offset +
+            client.identifier().size() - clients[0].identifier().size()));
+        queue_->Leave(client.index());
+    }
+}
+
+// The client identifier is escaped in the "to" attribute of the envelope.
+TEST_F(IFMapUpdateSenderTest, ReceiverEscaped) {
+    TestClient c0("a&b<c>d\"e'f");
+    c0.set_verbose(false);
+    server_.ClientRegister(&c0);
+
+    IFMapUpdate *u1 = CreateUpdate("u1", true);
+    BitSet cli_bs;
+    cli_bs.set(c0.index());
+    u1->AdvertiseOr(cli_bs);
+    queue_->Join(c0.index());
+    queue_->Enqueue(u1);
+
+    sender_->SendActive(c0.index());
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, c0.get_send_update_cnt());
+
+    EXPECT_NE(string::npos, c0.last_msg().find(
+        "to=\"a&amp;b&lt;c&gt;d&quot;e&apos;f/config\""));
+    pugi::xml_document doc;
+    ASSERT_TRUE(doc.load(c0.last_msg().c_str()));
+    EXPECT_EQ(c0.identifier() + "/config",
+              string(doc.child("iq").attribute("to").value()));
+    EXPECT_TRUE(doc.child("iq").child("config"));
+    queue_->Leave(c0.index());
+}
+
 TEST_F(IFMapUpdateSenderTest, QTraversalNoInterest) {
     TestClient c0("c0");
     TestClient c1("c1");
@@ -823,6 +823,27 @@ TEST_F(IFMapVmUuidMapperTest, CfgaddSubCfgdelUnsub) {
 TEST_F(IFMapVmUuidMapperTest, VmAddNoProp) {
 }
 
+// The string form is only parsed at the xmpp boundary. Make sure that it
+// round-trips with the form printed for introspect.
+TEST_F(IFMapVmUuidMapperTest, UuidString) {
+    boost::uuids::uuid uuid, parsed;
+    IFMapUuidMapper::SetUuid(7154778764020240001ULL, 13082342935312119001ULL,
+                             uuid);
+    string uuid_str = IFMapUuidMapper::UuidToString(uuid);
+    EXPECT_EQ(36, uuid_str.size());
+    EXPECT_TRUE(IFMapUuidMapper::StringToUuid(uuid_str, &parsed));
+    EXPECT_TRUE(uuid == parsed);
+
+    EXPECT_FALSE(IFMapUuidMapper::StringToUuid("", &parsed));
+    EXPECT_FALSE(IFMapUuidMapper::StringToUuid(
+        "2d308482-c7b3-4e05-af14-e732b7b5011", &parsed));
+    EXPECT_FALSE(IFMapUuidMapper::StringToUuid(
+        "2d308482-c7b3-4e05-af14-e732b7b5011g", &parsed));
+    EXPECT_FALSE(IFMapUuidMapper::StringToUuid(
+        "2d308482xc7b3-4e05-af14-e732b7b50117", &parsed));
+    EXPECT_FALSE(vm_uuid_mapper_->VmNodeExists("no-such-uuid"));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     LoggingInit();
@@ -3,15 +3,81 @@
  */
 
 #include "io/event_manager.h"
+
+#include <pthread.h>
+#include <boost/scoped_ptr.hpp>
+#include <tbb/task_scheduler_init.h>
+
 #include "base/logging.h"
+#include "base/task.h"
 #include "io/io_log.h"
 
 using namespace boost::asio;
 
 SandeshTraceBufferPtr IOTraceBuf(SandeshTraceBufferCreate(IO_TRACE_BUF, 1000));
 
+//
+// A thread that runs an io_service until it is stopped. Sessions enqueue
+// reader tasks from the AsyncHandlers, so the thread joins the TBB
+// scheduler the same way the thread that calls EventManager::Run does.
+//
+class EventManager::SessionThread {
+public:
+    SessionThread() : work_(new io_service::work(io_service_)) {
+    }
+
+    void Start() {
+        int res = pthread_create(&thread_id_, NULL, &ThreadRun, this);
+        assert(res == 0);
+    }
+
+    void Stop() {
+        work_.reset();
+        io_service_.stop();
+    }
+
+    void Join() {
+        int res = pthread_join(thread_id_, NULL);
+        assert(res == 0);
+    }
+
+    boost::asio::io_service *io_service() { return &io_service_; }
+
+private:
+    static void *ThreadRun(void *objp) {
+        SessionThread *obj = reinterpret_cast<SessionThread *>(objp);
+        obj->Run();
+        return NULL;
+    }
+
+    void Run() {
+        tbb::task_scheduler_init init(TaskScheduler::GetThreadCount() + 1);
+        boost::system::error_code ec;
+        io_service_.run(ec);
+        if (ec) {
+            EVENT_MANAGER_LOG_ERROR("io_service run failed: " << ec.message());
+        }
+    }
+
+    boost::asio::io_service io_service_;
+    boost::scoped_ptr<io_service::work> work_;
+    pthread_t thread_id_;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionThread);
+};
+
 EventManager::EventManager() {
     shutdown_ = false;
+    session_index_ = 0;
+}
+
+EventManager::~EventManager() {
+    for (std::vector<SessionThread *>::iterator iter =
+         session_threads_.begin(); iter != session_threads_.end(); ++iter) {
+        (*iter)->Stop();
+        (*iter)->Join();
+    }
+    STLDeleteValues(&session_threads_);
 }
 
 void EventManager::Shutdown() {
@@ -19,6 +85,27 @@ void EventManager::Shutdown() {
 
     // TODO: make sure that are no users of this event manager.
     io_service_.stop();
+    for (std::vector<SessionThread *>::iterator iter =
+         session_threads_.begin(); iter != session_threads_.end(); ++iter) {
+        (*iter)->Stop();
+    }
+}
+
+void EventManager::StartSessionThreads(int count) {
+    assert(session_threads_.empty());
+    for (int idx = 0; idx < count; idx++) {
+        SessionThread *thread = new SessionThread();
+        session_threads_.push_back(thread);
+        thread->Start();
+    }
+}
+
+io_service *EventManager::session_io_service() {
+    if (session_threads_.empty()) {
+        return &io_service_;
+    }
+    size_t idx = session_index_.fetch_and_increment();
+    return session_threads_[idx % session_threads_.size()]->io_service();
 }
 
 void EventManager::Run() {
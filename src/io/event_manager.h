@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <vector>
 #include <boost/asio/io_service.hpp>
+#include <tbb/atomic.h>
 #include <tbb/spin_mutex.h>
 
 #include "base/util.h"
@@ -18,9 +20,16 @@
 // Poll directly or indirectly after having started a ServerThread (which
 // calls Run).
 //
+// Optionally, the EventManager also owns a pool of session threads, each
+// running an io_service of its own. TcpServer places the socket of every
+// new session on one of them, so that socket reads and writes of different
+// sessions are handled in parallel. Everything else, including listening
+// sockets and timers, stays on io_service().
+//
 class EventManager {
 public:
     EventManager();
+    ~EventManager();
 
     // Run until shutdown.
     void Run();
@@ -33,12 +42,27 @@ public:
 
     void Shutdown();
 
+    // Start count session threads. Must be called before any TcpServer
+    // creates a session. With no session threads, all sessions use
+    // io_service().
+    void StartSessionThreads(int count);
+
     boost::asio::io_service *io_service() { return &io_service_; }
 
+    // The io_service for the socket of a new session. Session threads are
+    // assigned in round robin order.
+    boost::asio::io_service *session_io_service();
+
+    size_t session_thread_count() const { return session_threads_.size(); }
+
 private:
+    class SessionThread;
+
     boost::asio::io_service io_service_;
     bool shutdown_;
     tbb::spin_mutex mutex_;
+    std::vector<SessionThread *> session_threads_;
+    tbb::atomic<size_t> session_index_;
 
     DISALLOW_COPY_AND_ASSIGN(EventManager);
 };
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "io/tcp_buffer_pool.h"
+
+#include <cassert>
+#include <new>
+
+using namespace std;
+
+TcpBufferPool::TcpBufferPool(size_t max_free)
+    : free_count_(0), max_free_(max_free) {
+}
+
+TcpBufferPool::~TcpBufferPool() {
+    for (FreeMap::iterator iter = free_map_.begin();
+         iter != free_map_.end(); ++iter) {
+        for (vector<Header *>::iterator it = iter->second.begin();
+             it != iter->second.end(); ++it) {
+            Delete(*it);
+        }
+    }
+}
+
+TcpBufferPool::Header *TcpBufferPool::Allocate(size_t size) {
+    {
+        tbb::spin_mutex::scoped_lock lock(mutex_);
+        FreeMap::iterator loc = free_map_.find(size);
+        if (loc != free_map_.end() && !loc->second.empty()) {
+            Header *header = loc->second.back();
+            loc->second.pop_back();
+            free_count_--;
+            return header;
+        }
+    }
+
+    uint8_t *raw = new uint8_t[sizeof(Header) + size];
+    Header *header = new(raw) Header();
+    header->owner = NULL;
+    header->size = size;
+    return header;
+}
+
+void TcpBufferPool::Free(Header *header) {
+    assert(!header->node.is_linked());
+    header->owner = NULL;
+    {
+        tbb::spin_mutex::scoped_lock lock(mutex_);
+        if (free_count_ < max_free_) {
+            free_map_[header->size].push_back(header);
+            free_count_++;
+            return;
+        }
+    }
+    Delete(header);
+}
+
+size_t TcpBufferPool::free_count() const {
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    return free_count_;
+}
+
+void TcpBufferPool::Delete(Header *header) {
+    header->~Header();
+    delete [] reinterpret_cast<uint8_t *>(header);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __TCP_BUFFER_POOL_H__
+#define __TCP_BUFFER_POOL_H__
+
+#include <map>
+#include <vector>
+#include <boost/intrusive/list.hpp>
+#include <tbb/spin_mutex.h>
+
+#include "base/util.h"
+
+//
+// TcpBufferPool
+//
+// Recycles the receive buffers of the sessions of a TcpServer, so that a
+// busy session does not go to the heap for every read.
+//
+// Every buffer is preceded by a Header that is used to link it into the
+// owner's list of outstanding buffers. The Header is found from the data
+// pointer, so a buffer can be released in constant time no matter how many
+// are outstanding.
+//
+// The pool is shared by the server and its sessions since a session can
+// outlive the server it was created by.
+//
+class TcpBufferPool {
+public:
+    static const size_t kMaxFreeBuffers = 256;
+
+    struct Header {
+        boost::intrusive::list_member_hook<> node;
+        const void *owner;
+        size_t size;
+
+        uint8_t *data() { return reinterpret_cast<uint8_t *>(this + 1); }
+        static Header *FromData(const uint8_t *data) {
+            return reinterpret_cast<Header *>(const_cast<uint8_t *>(data)) - 1;
+        }
+    };
+    typedef boost::intrusive::member_hook<
+        Header,
+        boost::intrusive::list_member_hook<>,
+        &Header::node
+    > MemberHook;
+    typedef boost::intrusive::list<Header, MemberHook> List;
+
+    explicit TcpBufferPool(size_t max_free = kMaxFreeBuffers);
+    ~TcpBufferPool();
+
+    // Returns a buffer of the given size. The contents are not initialized.
+    Header *Allocate(size_t size);
+
+    // Returns the buffer to the pool, or to the heap if the pool is full.
+    void Free(Header *header);
+
+    size_t free_count() const;
+
+private:
+    typedef std::map<size_t, std::vector<Header *> > FreeMap;
+
+    static void Delete(Header *header);
+
+    mutable tbb::spin_mutex mutex_;
+    FreeMap free_map_;
+    size_t free_count_;
+    size_t max_free_;
+
+    DISALLOW_COPY_AND_ASSIGN(TcpBufferPool);
+};
+
+#endif // __TCP_BUFFER_POOL_H__
@@ -4,6 +4,8 @@
 
 #include "io/tcp_message_write.h"
 
+#include <algorithm>
+
 #include "base/util.h"
 #include "base/logging.h"
 #include "io/tcp_session.h"
@@ -13,6 +15,8 @@ using namespace boost::asio;
 using namespace boost::system;
 using tbb::mutex;
 
+const int TcpMessageWriter::kDefaultBufferSize;
+
 TcpMessageWriter::TcpMessageWriter(Socket *socket, TcpSession *session) :
     socket_(socket), offset_(0), session_(session) {
 }
@@ -28,14 +32,10 @@ TcpMessageWriter::~TcpMessageWriter() {
 int TcpMessageWriter::Send(const uint8_t *data, size_t len, error_code &ec) {
     int wrote = 0;
 
-    // Update socket write call statistics.
-    session_->stats_.write_calls++;
     session_->stats_.write_bytes += len;
 
-    session_->server_->stats_.write_calls++;
-    session_->server_->stats_.write_bytes += len;
-
     if (buffer_queue_.empty()) {
+        UpdateWriteStats();
         wrote = socket_->write_some(boost::asio::buffer(data, len), ec);
         if (TcpSession::IsSocketErrorHard(ec)) return -1;
         assert(wrote >= 0);
@@ -55,11 +55,15 @@ int TcpMessageWriter::Send(const uint8_t *data, size_t len, error_code &ec) {
     return wrote;
 }
 
+// Update socket write call statistics.
+void TcpMessageWriter::UpdateWriteStats() {
+    session_->stats_.write_calls++;
+}
+
 void TcpMessageWriter::DeferWrite() {
 
     // Update socket write block count.
     session_->stats_.write_blocked++;
-    session_->server_->stats_.write_blocked++;
     socket_->async_write_some(
         boost::asio::null_buffers(), 
         boost::bind(&TcpMessageWriter::HandleWriteReady, this,
@@ -77,8 +81,7 @@ void TcpMessageWriter::HandleWriteReady(TcpSessionPtr session_ptr,
 
     // Update socket write block time.
     uint64_t blocked_usecs = UTCTimestampUsec() - block_start_time;
-    session_->stats_.write_blocked_duration_usecs += blocked_usecs;
-    session_->server_->stats_.write_blocked_duration_usecs += blocked_usecs;
+    session_->stats_.UpdateWriteBlockedDuration(blocked_usecs);
 
     if (TcpSession::IsSocketErrorHard(error)) {
         goto done;
@@ -90,28 +93,32 @@ void TcpMessageWriter::HandleWriteReady(TcpSessionPtr session_ptr,
     if (session_->IsClosedLocked()) return;
 
     while (!buffer_queue_.empty()) {
-        boost::asio::mutable_buffer head = buffer_queue_.front();
-        const uint8_t *data = buffer_cast<const uint8_t *>(head) + offset_;
-        int remaining = buffer_size(head) - offset_;
+        // Gather the pending buffers into a single write.
+        size_t remaining = 0;
+        write_buffers_.clear();
+        for (BufferQueue::const_iterator iter = buffer_queue_.begin();
+             iter != buffer_queue_.end() &&
+             write_buffers_.size() < (size_t) kMaxWriteBuffers; ++iter) {
+            size_t offset = write_buffers_.empty() ? offset_ : 0;
+            write_buffers_.push_back(
+                buffer(iter->data + offset, iter->size - offset));
+            remaining += iter->size - offset;
+        }
+
         error_code ec;
-        int wrote = socket_->write_some(buffer(data, remaining), ec);
+        UpdateWriteStats();
+        size_t wrote = socket_->write_some(write_buffers_, ec);
         if (TcpSession::IsSocketErrorHard(ec)) {
             lock.release();
             if (!cb_.empty()) cb_(ec);
             return;
         }
-        assert(wrote >= 0);
+        BufferConsume(wrote);
         if (wrote != remaining) {
-            offset_ += wrote;
             DeferWrite();
             return;
-        } else {
-            offset_ = 0;
-            DeleteBuffer(head);
-            buffer_queue_.pop_front();
         }
     }
-    buffer_queue_.clear();
 
 done:
     lock.release();
@@ -124,17 +131,47 @@ done:
     return;
 }
 
+// Copy data to the pending queue. Fill up the last buffer before starting
+// a new one.
 void TcpMessageWriter::BufferAppend(const uint8_t *src, int bytes) {
-    u_int8_t *data = new u_int8_t[bytes];
-    memcpy(data, src, bytes);
-    mutable_buffer buffer = mutable_buffer(data, bytes);
+    if (!buffer_queue_.empty()) {
+        PendingBuffer &tail = buffer_queue_.back();
+        int count = std::min(bytes, (int) (tail.capacity - tail.size));
+        memcpy(tail.data + tail.size, src, count);
+        tail.size += count;
+        src += count;
+        bytes -= count;
+    }
+    if (bytes == 0) {
+        return;
+    }
+
+    PendingBuffer buffer;
+    buffer.capacity = std::max(bytes, kDefaultBufferSize);
+    buffer.data = new uint8_t[buffer.capacity];
+    buffer.size = bytes;
+    memcpy(buffer.data, src, bytes);
     buffer_queue_.push_back(buffer);
 }
 
-void TcpMessageWriter::DeleteBuffer(mutable_buffer buffer) {
-    const uint8_t *data = buffer_cast<const uint8_t *>(buffer);
-    delete[] data;
-    return;
+// Remove the given number of written bytes from the head of the queue.
+void TcpMessageWriter::BufferConsume(size_t bytes) {
+    while (bytes > 0) {
+        PendingBuffer &head = buffer_queue_.front();
+        size_t avail = head.size - offset_;
+        if (bytes < avail) {
+            offset_ += bytes;
+            return;
+        }
+        bytes -= avail;
+        offset_ = 0;
+        DeleteBuffer(head);
+        buffer_queue_.pop_front();
+    }
+}
+
+void TcpMessageWriter::DeleteBuffer(const PendingBuffer &buffer) {
+    delete[] buffer.data;
 }
 
 void TcpMessageWriter::RegisterNotification(SendReadyCb cb) {
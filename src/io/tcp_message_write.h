@@ -5,7 +5,8 @@
 #ifndef __MESSAGE_WRITE_H__
 #define __MESSAGE_WRITE_H__
 
-#include <list>
+#include <deque>
+#include <vector>
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/asio/buffer.hpp>
@@ -18,10 +19,21 @@ using namespace boost::system;
 
 class TcpSession;
 
+//
+// TcpMessageWriter
+//
+// Writes messages to a non-blocking socket. A message is written directly
+// if nothing is pending. Otherwise, or if the write is partial, the rest is
+// copied to the pending queue. Pending data is packed into buffers of at
+// least kDefaultBufferSize so that a burst of small messages takes up a few
+// buffers, and the queue is drained with gather writes of up to
+// kMaxWriteBuffers buffers each.
+//
 class TcpMessageWriter {
 public:
     typedef boost::asio::ip::tcp::socket Socket;
     static const int kDefaultBufferSize = 4 * 1024;
+    static const int kMaxWriteBuffers = 64;
     explicit TcpMessageWriter(Socket *, TcpSession *session);
     ~TcpMessageWriter();
 
@@ -33,14 +45,22 @@ public:
 
 private:
     typedef boost::intrusive_ptr<TcpSession> TcpSessionPtr;
-    typedef std::list<boost::asio::mutable_buffer> BufferQueue;
+    struct PendingBuffer {
+        uint8_t *data;
+        size_t size;
+        size_t capacity;
+    };
+    typedef std::deque<PendingBuffer> BufferQueue;
     void BufferAppend(const uint8_t *data, int len);
-    void DeleteBuffer(boost::asio::mutable_buffer buffer); 
+    void BufferConsume(size_t bytes);
+    void DeleteBuffer(const PendingBuffer &buffer);
+    void UpdateWriteStats();
     void DeferWrite();
     void HandleWriteReady(TcpSessionPtr session_ref, const error_code &ec,
                           uint64_t block_start_time);
 
     BufferQueue buffer_queue_;
+    std::vector<boost::asio::const_buffer> write_buffers_;
     SendReadyCb cb_;
     Socket *socket_;
     int offset_;
@@ -10,6 +10,7 @@
 
 #include "base/logging.h"
 #include "io/event_manager.h"
+#include "io/tcp_buffer_pool.h"
 #include "io/tcp_session.h"
 #include "io/io_log.h"
 
@@ -17,7 +18,7 @@ using namespace boost::asio::ip;
 using namespace std;
 
 TcpServer::TcpServer(EventManager *evm)
-    : evm_(evm) {
+    : evm_(evm), buffer_pool_(new TcpBufferPool()) {
     refcount_ = 0;
     TcpServerManager::AddServer(this);
 }
@@ -118,11 +119,14 @@ void TcpServer::Shutdown() {
 
 // Close and remove references from all sessions. The application code must
 // make sure it no longer holds any references to these sessions.
+//
+// The counters of a session are folded into the server totals once it is
+// closed, so that no reads or writes are lost, and only if DeleteSession
+// has not already done so.
 void TcpServer::ClearSessions() {
     tbb::mutex::scoped_lock lock(mutex_);
-    SessionSet refs;
+    SessionSet refs(session_ref_);
     session_map_.clear();
-    refs.swap(session_ref_);
     lock.release();
 
     for (SessionSet::iterator iter = refs.begin(), next = iter;
@@ -131,12 +135,23 @@ void TcpServer::ClearSessions() {
         TcpSession *session = iter->get();
         session->Close();
     }
+
+    lock.acquire(mutex_);
+    for (SessionSet::iterator iter = refs.begin(); iter != refs.end();
+         ++iter) {
+        SessionSet::iterator loc = session_ref_.find(*iter);
+        if (loc == session_ref_.end())
+            continue;
+        stats_.Add((*loc)->GetSocketStats());
+        session_ref_.erase(loc);
+    }
+    lock.release();
     refs.clear();
     cond_var_.notify_all();
 }
 
 TcpSession *TcpServer::CreateSession() {
-    Socket *socket = new Socket(*evm_->io_service());
+    Socket *socket = new Socket(*evm_->session_io_service());
     TcpSession *session = AllocSession(socket);
     {
         tbb::mutex::scoped_lock lock(mutex_);
@@ -173,7 +188,11 @@ void TcpServer::DeleteSession(TcpSession *session) {
     {
         tbb::mutex::scoped_lock lock(mutex_);
         assert(session->refcount_);
-        session_ref_.erase(TcpSessionPtr(session));
+        SessionSet::iterator iter = session_ref_.find(TcpSessionPtr(session));
+        if (iter != session_ref_.end()) {
+            stats_.Add(session->GetSocketStats());
+            session_ref_.erase(iter);
+        }
         if (session_ref_.empty()) {
             cond_var_.notify_all();
         }
@@ -196,7 +215,9 @@ void TcpServer::AsyncAccept() {
     if (acceptor_ == NULL) {
         return;
     }
-    so_accept_.reset(new Socket(*evm_->io_service()));
+    // The acceptor stays on the main io_service. The accepted socket is
+    // registered with the io_service of the session thread it lands on.
+    so_accept_.reset(new Socket(*evm_->session_io_service()));
     acceptor_->async_accept(*so_accept_.get(),
         boost::bind(&TcpServer::AcceptHandlerInternal, this,
             TcpServerPtr(this), boost::asio::placeholders::error));
@@ -375,6 +396,39 @@ void TcpServer::Connect(TcpSession *session, Endpoint remote) {
                     TcpSessionPtr(session), boost::asio::placeholders::error));
 }
 
+void TcpServer::SocketStats::Add(const SocketStats &rhs) {
+    read_calls += rhs.read_calls;
+    read_bytes += rhs.read_bytes;
+    write_calls += rhs.write_calls;
+    write_bytes += rhs.write_bytes;
+    write_blocked += rhs.write_blocked;
+    write_blocked_duration_usecs += rhs.write_blocked_duration_usecs;
+    for (int i = 0; i < kBlockedHistogramBuckets; i++) {
+        write_blocked_histogram[i] += rhs.write_blocked_histogram[i];
+    }
+}
+
+void TcpServer::SocketStats::UpdateWriteBlockedDuration(uint64_t usecs) {
+    write_blocked_duration_usecs += usecs;
+    int bucket = 0;
+    for (uint64_t limit = 100; bucket < kBlockedHistogramBuckets - 1 &&
+         usecs >= limit; limit *= 10) {
+        bucket++;
+    }
+    write_blocked_histogram[bucket]++;
+}
+
+TcpServer::SocketStats TcpServer::GetSocketStats() const {
+    SocketStats stats;
+    tbb::mutex::scoped_lock lock(mutex_);
+    stats.Add(stats_);
+    for (SessionSet::const_iterator iter = session_ref_.begin();
+         iter != session_ref_.end(); ++iter) {
+        stats.Add((*iter)->GetSocketStats());
+    }
+    return stats;
+}
+
 void TcpServer::SocketStats::GetRxStats(TcpServerSocketStats &socket_stats) const {
     socket_stats.calls = read_calls;
     socket_stats.bytes = read_bytes;
@@ -384,7 +438,7 @@ void TcpServer::SocketStats::GetRxStats(TcpServerSocketStats &socket_stats) cons
 }
 
 void TcpServer::GetRxSocketStats(TcpServerSocketStats &socket_stats) const {
-    stats_.GetRxStats(socket_stats);
+    GetSocketStats().GetRxStats(socket_stats);
 }
 
 void TcpServer::SocketStats::GetTxStats(TcpServerSocketStats &socket_stats) const {
@@ -402,10 +456,19 @@ void TcpServer::SocketStats::GetTxStats(TcpServerSocketStats &socket_stats) cons
                      write_blocked_duration_usecs/
                      write_blocked);
     }
+    socket_stats.blocked_duration_histogram.assign(write_blocked_histogram,
+        write_blocked_histogram + kBlockedHistogramBuckets);
 }
 
 void TcpServer::GetTxSocketStats(TcpServerSocketStats &socket_stats) const {
-    stats_.GetTxStats(socket_stats);
+    GetSocketStats().GetTxStats(socket_stats);
+}
+
+void TcpServer::GetRxTxSocketStats(TcpServerSocketStats &rx_socket_stats,
+                                   TcpServerSocketStats &tx_socket_stats) const {
+    SocketStats stats = GetSocketStats();
+    stats.GetRxStats(rx_socket_stats);
+    stats.GetTxStats(tx_socket_stats);
 }
 
 //
@@ -10,12 +10,14 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/intrusive_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <tbb/mutex.h>
 #include <tbb/compat/condition_variable>
 
 #include "base/util.h"
 
 class EventManager;
+class TcpBufferPool;
 class TcpSession;
 class TcpServerSocketStats;
 
@@ -23,6 +25,7 @@ class TcpServer {
   public:
     typedef boost::asio::ip::tcp::endpoint Endpoint;
     typedef boost::asio::ip::tcp::socket Socket;
+    typedef boost::shared_ptr<TcpBufferPool> BufferPoolPtr;
 
     explicit TcpServer(EventManager *evm);
     virtual ~TcpServer();
@@ -55,6 +58,11 @@ class TcpServer {
     int GetPort() const;
 
     struct SocketStats {
+        // Times the writes were blocked, in buckets of [0, 100us),
+        // [100us, 1ms), [1ms, 10ms), [10ms, 100ms), [100ms, 1s) and 1s or
+        // more.
+        static const int kBlockedHistogramBuckets = 6;
+
         SocketStats() {
             read_calls = 0;
             read_bytes = 0;
@@ -62,8 +70,13 @@ class TcpServer {
             write_bytes = 0;
             write_blocked = 0;
             write_blocked_duration_usecs = 0;
+            for (int i = 0; i < kBlockedHistogramBuckets; i++) {
+                write_blocked_histogram[i] = 0;
+            }
         }
 
+        void Add(const SocketStats &rhs);
+        void UpdateWriteBlockedDuration(uint64_t usecs);
         void GetRxStats(TcpServerSocketStats &socket_stats) const;
         void GetTxStats(TcpServerSocketStats &socket_stats) const;
 
@@ -73,8 +86,13 @@ class TcpServer {
         tbb::atomic<uint64_t> write_bytes;
         tbb::atomic<uint64_t> write_blocked;
         tbb::atomic<uint64_t> write_blocked_duration_usecs;
+        tbb::atomic<uint64_t> write_blocked_histogram[kBlockedHistogramBuckets];
     };
-    const SocketStats &GetSocketStats() const { return stats_; }
+
+    // The statistics of the server are the sum of those of its sessions.
+    // They are computed when read, so that the sessions do not contend on
+    // shared counters on every read and write.
+    SocketStats GetSocketStats() const;
 
     //
     // Return the number of tcp sessions in the map
@@ -85,6 +103,9 @@ class TcpServer {
 
     EventManager *event_manager() { return evm_; }
 
+    // Receive buffers of all the sessions of this server.
+    const BufferPoolPtr &buffer_pool() const { return buffer_pool_; }
+
     // Returns true if any of the sessions on this server has read available
     // data.
     bool HasSessionReadAvailable() const;
@@ -97,6 +118,10 @@ class TcpServer {
 
     void GetRxSocketStats(TcpServerSocketStats &socket_stats) const;
     void GetTxSocketStats(TcpServerSocketStats &socket_stats) const;
+    // Receive and transmit statistics from a single walk of the sessions,
+    // so that the two are consistent with each other.
+    void GetRxTxSocketStats(TcpServerSocketStats &rx_socket_stats,
+                            TcpServerSocketStats &tx_socket_stats) const;
 
   protected:
     // Create a session object.
@@ -115,7 +140,6 @@ class TcpServer {
 
   private:
     friend class TcpSession;
-    friend class TcpMessageWriter;
     friend void intrusive_ptr_add_ref(TcpServer *server);
     friend void intrusive_ptr_release(TcpServer *server);
     typedef boost::intrusive_ptr<TcpServer> TcpServerPtr;
@@ -142,8 +166,10 @@ class TcpServer {
     void OnSessionClose(TcpSession *session);
     void SetName(Endpoint local_endpoint);
 
+    // Statistics of the sessions that have been deleted.
     SocketStats stats_;
     EventManager *evm_;
+    BufferPoolPtr buffer_pool_;
     // mutex protects the session maps
     mutable tbb::mutex mutex_;
     tbb::interface5::condition_variable cond_var_;
@@ -6,7 +6,6 @@
 
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
-#include <boost/scoped_array.hpp>
 #include <boost/asio/detail/socket_option.hpp>
 
 #include "base/logging.h"
@@ -21,6 +20,8 @@ using namespace boost::asio;
 using namespace boost::system;
 using namespace std;
 
+const int TcpSession::kDefaultBufferSize;
+const int TcpSession::kMaxBufferSize;
 int TcpSession::reader_task_id_ = -1;
 
 class TcpSession::Reader : public Task {
@@ -50,9 +51,12 @@ TcpSession::TcpSession(
       socket_(socket),
       read_on_connect_(async_read_ready),
       buffer_size_(kDefaultBufferSize),
+      buffer_pool_(server ? server->buffer_pool() :
+                   TcpServer::BufferPoolPtr(new TcpBufferPool())),
       established_(false),
       closed_(false),
       direction_(ACTIVE),
+      read_buffer_size_(kDefaultBufferSize),
       writer_(new TcpMessageWriter(socket, this)) {
     refcount_ = 0;
     writer_->RegisterNotification(
@@ -64,40 +68,26 @@ TcpSession::TcpSession(
     name_ = "-";
 }
 
-TcpSession::~TcpSession() {
-    assert(!established_);
-    for (BufferQueue::iterator iter = buffer_queue_.begin();
-         iter != buffer_queue_.end(); ++iter) {
-        DeleteBuffer(*iter);
+struct TcpSessionBufferDisposer {
+    explicit TcpSessionBufferDisposer(TcpBufferPool *pool) : pool(pool) { }
+    void operator()(TcpBufferPool::Header *header) {
+        pool->Free(header);
     }
-    buffer_queue_.clear();
-}
+    TcpBufferPool *pool;
+};
 
-mutable_buffer TcpSession::AllocateBuffer() {
-    u_int8_t *data = new u_int8_t[buffer_size_];
-    mutable_buffer buffer = mutable_buffer(data, buffer_size_);
-    {
-        tbb::mutex::scoped_lock lock(mutex_);
-        buffer_queue_.push_back(buffer);
-    }
-    return buffer;
+TcpSession::~TcpSession() {
+    assert(!established_);
+    buffer_queue_.clear_and_dispose(
+        TcpSessionBufferDisposer(buffer_pool_.get()));
 }
 
-void TcpSession::DeleteBuffer(mutable_buffer buffer) {
-    uint8_t *data = buffer_cast<uint8_t *>(buffer);
-    delete[] data;
-}
-
-static int BufferCmp(const mutable_buffer &lhs, const const_buffer &rhs) {
-    const uint8_t *lp = buffer_cast<uint8_t *>(lhs);
-    const uint8_t *rp = buffer_cast<const uint8_t *>(rhs);
-    if (lp < rp) {
-        return -1;
-    }
-    if (lp > rp) {
-        return 1;
-    }
-    return 0;
+// Requires: lock must be held
+mutable_buffer TcpSession::AllocateBufferLocked() {
+    TcpBufferPool::Header *header = buffer_pool_->Allocate(read_buffer_size_);
+    header->owner = this;
+    buffer_queue_.push_back(*header);
+    return mutable_buffer(header->data(), header->size);
 }
 
 void TcpSession::ReleaseBuffer(Buffer buffer) {
@@ -105,25 +95,41 @@ void TcpSession::ReleaseBuffer(Buffer buffer) {
     ReleaseBufferLocked(buffer);
 }
 
+// Requires: lock must be held
 void TcpSession::ReleaseBufferLocked(Buffer buffer) {
-    for (BufferQueue::iterator iter = buffer_queue_.begin();
-         iter != buffer_queue_.end(); ++iter) {
-        if (BufferCmp(*iter, buffer) == 0) {
-            DeleteBuffer(*iter);
-            buffer_queue_.erase(iter);
-            return;
+    TcpBufferPool::Header *header =
+        TcpBufferPool::Header::FromData(BufferData(buffer));
+    assert(header->owner == this);
+    buffer_queue_.erase(buffer_queue_.iterator_to(*header));
+    buffer_pool_->Free(header);
+}
+
+//
+// Use a larger buffer for the next read if this one was filled up and a
+// smaller one, but never below buffer_size_, if less than a quarter of it
+// was used.
+//
+// Requires: lock must be held
+//
+void TcpSession::AdjustBufferSizeLocked(size_t size,
+                                        size_t bytes_transferred) {
+    if (bytes_transferred == size) {
+        if (read_buffer_size_ < kMaxBufferSize) {
+            read_buffer_size_ = min(read_buffer_size_ * 2, kMaxBufferSize);
+        }
+    } else if (bytes_transferred < size / 4) {
+        if (read_buffer_size_ > buffer_size_) {
+            read_buffer_size_ = max(read_buffer_size_ / 2, buffer_size_);
         }
     }
-    assert(false);
 }
 
 void TcpSession::AsyncReadStart() {
-    mutable_buffer buffer = AllocateBuffer();
     tbb::mutex::scoped_lock lock(mutex_);
     if (!established_) {
-        ReleaseBufferLocked(buffer);
         return;
     }
+    mutable_buffer buffer = AllocateBufferLocked();
     socket_->async_read_some(mutable_buffers_1(buffer),
         boost::bind(&TcpSession::AsyncReadHandler, TcpSessionPtr(this), buffer,
                     boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
@@ -317,8 +323,7 @@ void TcpSession::AsyncReadHandler(
     // Update read statistics.
     session->stats_.read_calls++;
     session->stats_.read_bytes += bytes_transferred;
-    session->server_->stats_.read_calls++;
-    session->server_->stats_.read_bytes += bytes_transferred;
+    session->AdjustBufferSizeLocked(buffer_size(buffer), bytes_transferred);
 
     Buffer rdbuf(buffer_cast<const uint8_t *>(buffer), bytes_transferred);
     Reader *task = new Reader(
@@ -377,6 +382,13 @@ int TcpMessageReader::AllocBufferSize(int length) {
     return bufsize;
 }
 
+uint8_t *TcpMessageReader::ScratchBuffer(int size) {
+    if (scratch_.size() < (size_t) size) {
+        scratch_.resize(AllocBufferSize(size));
+    }
+    return &scratch_[0];
+}
+
 uint8_t *TcpMessageReader::BufferConcat(uint8_t *data, Buffer buffer,
                                         int msglength) {
     uint8_t *dst = data;
@@ -465,8 +477,8 @@ void TcpMessageReader::OnRead(Buffer buffer) {
                 queue_.push_back(buffer);
                 return;
             }
-            boost::scoped_array<uint8_t> data(new uint8_t[kHeaderLenSize]);
-            Buffer header = PullUp(data.get(), buffer, kHeaderLenSize);
+            Buffer header = PullUp(ScratchBuffer(kHeaderLenSize), buffer,
+                                   kHeaderLenSize);
             assert(TcpSession::BufferSize(header) == (size_t) kHeaderLenSize);
 
             msglength = MsgLength(header, 0);
@@ -485,12 +497,11 @@ void TcpMessageReader::OnRead(Buffer buffer) {
         }
 
         // concat the buffers into a contiguous message.
-        boost::scoped_array<uint8_t>
-            data(new uint8_t[AllocBufferSize(msglength)]);
-        BufferConcat(data.get(), buffer, msglength);
+        uint8_t *data = BufferConcat(ScratchBuffer(msglength), buffer,
+                                     msglength);
         assert(remain_ == -1);
         // Receive the message
-        callback_(data.get(), msglength);
+        callback_(data, msglength);
     }
 
     int avail = size - offset_;
@@ -650,5 +661,7 @@ void TcpSession::GetTxSocketStats(TcpServerSocketStats &socket_stats) const {
 }
 
 void TcpSession::SetBufferSize(int buffer_size) {
+    tbb::mutex::scoped_lock lock(mutex_);
     buffer_size_ = buffer_size;
+    read_buffer_size_ = buffer_size;
 }
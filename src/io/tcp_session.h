@@ -7,6 +7,7 @@
 
 #include <list>
 #include <deque>
+#include <vector>
 
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/io_service.hpp>
@@ -21,6 +22,7 @@
 #include <tbb/compat/condition_variable>
 #endif
 #include "base/util.h"
+#include "io/tcp_buffer_pool.h"
 #include "io/tcp_server.h"
 
 class EventManager;
@@ -30,12 +32,15 @@ class TcpMessageWriter;
 
 // TcpSession
 //
-// Concurrency: the session is created by the event manager thread, which
-// also invokes the AsyncHandlers. ReleaseBuffer and Send will typically be
-// invoked by a different thread.
+// Concurrency: the session is created by the event manager thread. The
+// AsyncHandlers are invoked by the thread that runs the io_service of the
+// socket, which is one of the EventManager session threads when these are
+// enabled. ReleaseBuffer and Send will typically be invoked by a different
+// thread.
 class TcpSession {
   public:
     static const int kDefaultBufferSize = 4 * 1024;
+    static const int kMaxBufferSize = 64 * 1024;
 
     enum Event {
         EVENT_NONE,
@@ -68,6 +73,8 @@ class TcpSession {
 
     virtual std::string ToString() const { return name_; }
 
+    // Sets the size of the receive buffers. The session uses larger
+    // buffers, up to kMaxBufferSize, as long as reads keep filling them up.
     void SetBufferSize(int buffer_size);
 
     // Getters and setters
@@ -156,7 +163,7 @@ class TcpSession {
     friend class TcpMessageWriter;
     friend void intrusive_ptr_add_ref(TcpSession *session);
     friend void intrusive_ptr_release(TcpSession *session);
-    typedef std::list<boost::asio::mutable_buffer> BufferQueue;
+    typedef TcpBufferPool::List BufferQueue;
 
     class Reader;
 
@@ -167,7 +174,9 @@ class TcpSession {
     static void AsyncWriteHandler(TcpSessionPtr session,
                                   const boost::system::error_code &error);
 
+    boost::asio::mutable_buffer AllocateBufferLocked();
     void ReleaseBufferLocked(Buffer buffer);
+    void AdjustBufferSizeLocked(size_t size, size_t bytes_transferred);
     void CloseInternal(bool callObserver);
     void SetEstablished(Endpoint remote, Direction dir);
 
@@ -178,8 +187,6 @@ class TcpSession {
     }
     void SetName();
 
-    boost::asio::mutable_buffer AllocateBuffer();
-    void DeleteBuffer(boost::asio::mutable_buffer buffer);
     void WriteReadyInternal(const boost::system::error_code &);
 
     static int reader_task_id_;
@@ -188,6 +195,7 @@ class TcpSession {
     boost::scoped_ptr<Socket> socket_;
     bool read_on_connect_;
     int buffer_size_;
+    TcpServer::BufferPoolPtr buffer_pool_;
 
     // Protects session state and buffer queue.
     mutable tbb::mutex mutex_;
@@ -197,7 +205,8 @@ class TcpSession {
     bool closed_;               // Close has been called.
     Endpoint remote_;           // Remote end-point
     Direction direction_;       // direction (active, passive)
-    BufferQueue buffer_queue_;
+    BufferQueue buffer_queue_;  // Outstanding receive buffers
+    int read_buffer_size_;      // Size of the next receive buffer
     /**************** end protected by mutex_ ****************/
 
     // Protects observer manipulation and invocation. When this lock is
@@ -256,11 +265,17 @@ private:
 
     int AllocBufferSize(int length);
 
+    // Returns a buffer of at least size bytes to pull up a header or a
+    // message that straddles read buffers. The buffer is kept for the
+    // next message instead of being allocated for every one.
+    uint8_t *ScratchBuffer(int size);
+
     TcpSession *session_;
     ReceiveCallback callback_;
     BufferQueue queue_;
     int offset_;
     int remain_;
+    std::vector<uint8_t> scratch_;
 
     DISALLOW_COPY_AND_ASSIGN(TcpMessageReader);
 };
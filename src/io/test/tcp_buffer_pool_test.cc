@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "io/tcp_buffer_pool.h"
+
+#include "base/logging.h"
+#include "testing/gunit.h"
+
+class TcpBufferPoolTest : public ::testing::Test {
+protected:
+    TcpBufferPoolTest() : pool_(4) {
+    }
+
+    TcpBufferPool pool_;
+};
+
+TEST_F(TcpBufferPoolTest, Header) {
+    TcpBufferPool::Header *header = pool_.Allocate(1024);
+    EXPECT_EQ(1024, header->size);
+    EXPECT_TRUE(header->owner == NULL);
+    EXPECT_FALSE(header->node.is_linked());
+    EXPECT_EQ(header, TcpBufferPool::Header::FromData(header->data()));
+    memset(header->data(), 0xff, header->size);
+    pool_.Free(header);
+}
+
+// Buffers are recycled by size.
+TEST_F(TcpBufferPoolTest, Recycle) {
+    TcpBufferPool::Header *small = pool_.Allocate(1024);
+    TcpBufferPool::Header *large = pool_.Allocate(4096);
+    pool_.Free(small);
+    pool_.Free(large);
+    EXPECT_EQ(2, pool_.free_count());
+
+    EXPECT_EQ(large, pool_.Allocate(4096));
+    EXPECT_EQ(small, pool_.Allocate(1024));
+    EXPECT_EQ(0, pool_.free_count());
+
+    TcpBufferPool::Header *other = pool_.Allocate(1024);
+    EXPECT_NE(small, other);
+    EXPECT_EQ(1024, other->size);
+
+    pool_.Free(small);
+    pool_.Free(large);
+    pool_.Free(other);
+}
+
+// The pool holds on to at most max_free buffers.
+TEST_F(TcpBufferPoolTest, MaxFree) {
+    std::vector<TcpBufferPool::Header *> headers;
+    for (int i = 0; i < 8; i++) {
+        headers.push_back(pool_.Allocate(512));
+    }
+    for (int i = 0; i < 8; i++) {
+        pool_.Free(headers[i]);
+    }
+    EXPECT_EQ(4, pool_.free_count());
+}
+
+// The owner keeps its outstanding buffers in an intrusive list and can
+// release them in any order.
+TEST_F(TcpBufferPoolTest, List) {
+    TcpBufferPool::List list;
+    std::vector<const uint8_t *> data;
+    for (int i = 0; i < 4; i++) {
+        TcpBufferPool::Header *header = pool_.Allocate(256);
+        list.push_back(*header);
+        data.push_back(header->data());
+    }
+
+    const int order[] = { 2, 0, 3, 1 };
+    for (int i = 0; i < 4; i++) {
+        TcpBufferPool::Header *header =
+            TcpBufferPool::Header::FromData(data[order[i]]);
+        EXPECT_TRUE(header->node.is_linked());
+        list.erase(list.iterator_to(*header));
+        pool_.Free(header);
+        EXPECT_EQ(3 - i, list.size());
+    }
+    EXPECT_EQ(4, pool_.free_count());
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
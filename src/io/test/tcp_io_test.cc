@@ -315,6 +315,48 @@ TEST_F(EchoServerTest, SendAfterClose) {
     TASK_UTIL_ASSERT_NE(0, server_->GetSession()->GetTotal());
 }
 
+// Small messages sent while the socket is blocked are written out in a few
+// gather writes rather than one write per message.
+TEST_F(EchoServerTest, BlockedSmallMessages) {
+    server_->Initialize(0);
+    task_util::WaitForIdle();
+    thread_->Start();
+    int port = server_->GetPort();
+    ASSERT_LT(0, port);
+
+    client_->CreateSession();
+    client_->EchoServer::ConnectTest(port);
+    TASK_UTIL_ASSERT_TRUE((server_->GetSession() != NULL));
+    TASK_UTIL_ASSERT_TRUE(client_->GetSession()->IsEstablished());
+
+    // Stop the scheduler so that the server stops reading and the client
+    // stays blocked until all the messages are queued.
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Stop();
+
+    char msg[4096];
+    memset(msg, 0xcd, sizeof(msg));
+    int total = 0;
+    bool res = true;
+    while (res) {
+        res = client_->Send((const u_int8_t *) msg, sizeof(msg), NULL);
+        total += sizeof(msg);
+    }
+
+    static const int kMessages = 1000;
+    const TcpServer::SocketStats &stats =
+        client_->GetSession()->GetSocketStats();
+    uint64_t write_calls = stats.write_calls;
+    for (int i = 0; i < kMessages; i++) {
+        client_->Send((const u_int8_t *) msg, 100, NULL);
+        total += 100;
+    }
+    scheduler->Start();
+    TASK_UTIL_ASSERT_EQ(total, server_->GetSession()->GetTotal());
+    TASK_UTIL_ASSERT_TRUE(client_->GetSession()->called);
+    EXPECT_GT(kMessages / 10, stats.write_calls - write_calls);
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -12,6 +12,7 @@
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/placeholders.hpp>
 #include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 
 #include "testing/gunit.h"
 
@@ -79,6 +80,7 @@ public:
     }
 
     EchoSession *GetSession() const { return session_; }
+    void SessionReset() { session_ = NULL; }
 
 private:
     EchoSession *session_;
@@ -281,12 +283,132 @@ TEST_F(EchoServerTest, Connect) {
     TcpServerManager::DeleteServer(client);
     client = NULL;
 }
+// The server statistics are the sum of those of its sessions, including
+// the ones that have been deleted.
+TEST_F(EchoServerTest, SocketStats) {
+    server_->Initialize(0);
+    task_util::WaitForIdle();
+    thread_->Start();		// Must be called after initialization
+
+    static const size_t kClients = 4;
+    const char msg[] = "Test Message";
+    boost::ptr_vector<TcpLocalClient> clients;
+    for (size_t i = 0; i < kClients; i++) {
+        clients.push_back(new TcpLocalClient(server_->GetPort()));
+        TASK_UTIL_EXPECT_TRUE(clients.back().Connect());
+        clients.back().Send((const u_int8_t *) msg, sizeof(msg));
+        u_int8_t data[1024];
+        EXPECT_EQ((int) sizeof(msg), clients.back().Recv(data, sizeof(data)));
+    }
+    TASK_UTIL_EXPECT_EQ(kClients, server_->GetSessionCount());
+
+    TcpServer::SocketStats stats = server_->GetSocketStats();
+    EXPECT_EQ(kClients * sizeof(msg), stats.read_bytes);
+    EXPECT_EQ(kClients * sizeof(msg), stats.write_bytes);
+    EXPECT_LE(kClients, stats.read_calls);
+    EXPECT_LE(kClients, stats.write_calls);
+
+    server_->ClearSessions();
+    server_->SessionReset();
+    task_util::WaitForIdle();
+    EXPECT_EQ(0U, server_->GetSessionCount());
+    stats = server_->GetSocketStats();
+    EXPECT_EQ(kClients * sizeof(msg), stats.read_bytes);
+    EXPECT_EQ(kClients * sizeof(msg), stats.write_bytes);
+}
+
+static const size_t kEchoSize = 64;
+
+// Sends a message on each of the clients and reads back the echoes, for
+// the given number of rounds. Returns the elapsed time in usecs.
+static uint64_t EchoRounds(const vector<TcpLocalClient *> &clients,
+                           int rounds) {
+    u_int8_t msg[kEchoSize];
+    memset(msg, 0xcd, sizeof(msg));
+    uint64_t start = UTCTimestampUsec();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < clients.size(); i++) {
+            clients[i]->Send(msg, sizeof(msg));
+        }
+        for (size_t i = 0; i < clients.size(); i++) {
+            u_int8_t data[sizeof(msg)];
+            for (size_t len = 0; len < sizeof(msg); ) {
+                int rlen = clients[i]->Recv(data + len, sizeof(msg) - len);
+                EXPECT_LT(0, rlen);
+                if (rlen <= 0)
+                    return UTCTimestampUsec() - start;
+                len += rlen;
+            }
+        }
+    }
+    return UTCTimestampUsec() - start;
+}
+
+// Echo messages on many sessions at once, spread over the session threads,
+// against a baseline of as many messages echoed on a single session. Both
+// times are logged. Run with --gtest_also_run_disabled_tests; gtest reports
+// the elapsed time.
+TEST_F(EchoServerTest, DISABLED_PerfMultiSession) {
+    static const int kSessionThreads = 4;
+    evm_->StartSessionThreads(kSessionThreads);
+    server_->Initialize(0);
+    task_util::WaitForIdle();
+    thread_->Start();		// Must be called after initialization
+
+    static const int kClients = 32;
+    static const int kRounds = 20000;
+    boost::ptr_vector<TcpLocalClient> clients;
+    vector<TcpLocalClient *> multi;
+    for (int i = 0; i <= kClients; i++) {
+        clients.push_back(new TcpLocalClient(server_->GetPort()));
+        TASK_UTIL_EXPECT_TRUE(clients.back().Connect());
+        if (i < kClients)
+            multi.push_back(&clients.back());
+    }
+    vector<TcpLocalClient *> single(1, &clients.back());
+    TASK_UTIL_EXPECT_EQ((size_t) kClients + 1, server_->GetSessionCount());
+
+    uint64_t baseline = EchoRounds(single, kClients * kRounds);
+    uint64_t elapsed = EchoRounds(multi, kRounds);
+    LOG(DEBUG, "Single session " << baseline << " usecs, " << kClients
+        << " sessions " << elapsed << " usecs");
+
+    // The counters are updated on the session threads.
+    TASK_UTIL_EXPECT_EQ(2U * kClients * kRounds * kEchoSize,
+                        server_->GetSocketStats().read_bytes);
+    TASK_UTIL_EXPECT_EQ(2U * kClients * kRounds * kEchoSize,
+                        server_->GetSocketStats().write_bytes);
+}
+
+TEST(SocketStatsTest, BlockedHistogram) {
+    TcpServer::SocketStats stats;
+    const uint64_t durations[] = { 50, 100, 999, 5000, 50000, 500000,
+                                   5000000, 50000000 };
+    for (size_t i = 0; i < sizeof(durations) / sizeof(durations[0]); i++) {
+        stats.UpdateWriteBlockedDuration(durations[i]);
+    }
+    const uint64_t expected[] = { 1, 2, 1, 1, 1, 2 };
+    for (int i = 0; i < TcpServer::SocketStats::kBlockedHistogramBuckets;
+         i++) {
+        EXPECT_EQ(expected[i], stats.write_blocked_histogram[i]);
+    }
+    EXPECT_EQ(55556149U, stats.write_blocked_duration_usecs);
+
+    TcpServer::SocketStats total;
+    total.Add(stats);
+    total.Add(stats);
+    EXPECT_EQ(4U, total.write_blocked_histogram[1]);
+    EXPECT_EQ(2 * 55556149U, total.write_blocked_duration_usecs);
+}
+
 using boost::asio::mutable_buffer;
 
 class ReaderTest : public TcpMessageReader {
 public:
-    ReaderTest(TcpSession *session, ReceiveCallback callback)
-        : TcpMessageReader(session, callback) {
+    ReaderTest(TcpSession *session, ReceiveCallback callback,
+               int max_message_size)
+        : TcpMessageReader(session, callback),
+          max_message_size_(max_message_size) {
     }
 
     virtual const int GetHeaderLenSize() {
@@ -294,7 +416,7 @@ public:
     }
 
     virtual const int GetMaxMessageSize() {
-        return kMaxMessageSize;
+        return max_message_size_;
     }
 
     // Extract the total BGP message length. This is a 2 byte field after the
@@ -313,12 +435,13 @@ public:
 
 private:
     static const int kHeaderLenSize = 18;
-    static const int kMaxMessageSize = 4096;
+    int max_message_size_;
 };
 
 class ReaderTestSession : public TcpSession {
   public:
-    ReaderTestSession(TcpServer *server, Socket *socket);
+    ReaderTestSession(TcpServer *server, Socket *socket,
+                      int max_message_size = 4096);
 
     void Read(Buffer buffer) {
         OnRead(buffer);
@@ -353,10 +476,12 @@ class ReaderTestSession : public TcpSession {
     int release_count_;
 };
 
-ReaderTestSession::ReaderTestSession(TcpServer *server, Socket *socket)
+ReaderTestSession::ReaderTestSession(TcpServer *server, Socket *socket,
+                                     int max_message_size)
     : TcpSession(server, socket),
       reader_(new ReaderTest(this,
-              boost::bind(&ReaderTestSession::ReceiveMsg, this, _1, _2))),
+              boost::bind(&ReaderTestSession::ReceiveMsg, this, _1, _2),
+              max_message_size)),
       release_count_(0) {
 }
 
@@ -415,6 +540,66 @@ TEST_F(ReaderUnitTest, StreamRead) {
     TASK_UTIL_EXPECT_EQ(buf_list.size(), (size_t) session_.release_count());
 }
 
+class LargeReaderUnitTest : public ::testing::Test {
+protected:
+    static const int kMessageSize = 60000;
+    static const int kReadSize = 4096;
+
+    LargeReaderUnitTest() :
+        session_(NULL, NULL, 65535) {}
+
+    // Build a stream of count messages and cut it up in kReadSize reads.
+    void BuildStream(int count, vector<mutable_buffer> *buf_list) {
+        stream_.resize(count * kMessageSize);
+        for (int i = 0; i < count; i++) {
+            CreateFakeMessage(&stream_[i * kMessageSize], kMessageSize);
+        }
+        for (size_t offset = 0; offset < stream_.size(); offset += kReadSize) {
+            size_t size = min(stream_.size() - offset, (size_t) kReadSize);
+            buf_list->push_back(mutable_buffer(&stream_[offset], size));
+        }
+    }
+
+    ReaderTestSession session_;
+    vector<uint8_t> stream_;
+};
+
+// Messages much larger than a read buffer.
+TEST_F(LargeReaderUnitTest, StreamRead) {
+    vector<mutable_buffer> buf_list;
+    BuildStream(4, &buf_list);
+    for (size_t i = 0; i < buf_list.size(); i++) {
+        session_.Read(buf_list[i]);
+    }
+
+    int count = 0;
+    for (vector<int>::const_iterator iter = session_.begin();
+         iter != session_.end(); ++iter) {
+        EXPECT_EQ(kMessageSize, *iter);
+        count++;
+    }
+    EXPECT_EQ(4, count);
+    EXPECT_EQ(buf_list.size(), (size_t) session_.release_count());
+}
+
+// Reassembly cost of 4KB reads of large messages. Run with
+// --gtest_also_run_disabled_tests; gtest reports the elapsed time.
+TEST_F(LargeReaderUnitTest, DISABLED_PerfStreamRead) {
+    static const int kRounds = 1000;
+    vector<mutable_buffer> buf_list;
+    BuildStream(16, &buf_list);
+
+    SetLoggingDisabled(true);
+    for (int round = 0; round < kRounds; round++) {
+        for (size_t i = 0; i < buf_list.size(); i++) {
+            session_.Read(buf_list[i]);
+        }
+    }
+    SetLoggingDisabled(false);
+
+    EXPECT_EQ(kRounds * 16, session_.end() - session_.begin());
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -41,7 +41,7 @@ using ::testing::TestWithParam;
 using ::testing::ValuesIn;
 using ::testing::Combine;
 
-typedef std::tr1::tuple<int, int, int, bool> TestParams;
+typedef std::tr1::tuple<int, int, int, bool, int> TestParams;
 static char **gargv;
 static int    gargc;
 
@@ -216,6 +216,7 @@ protected:
 
     virtual void SetUp() {
         InitParams();
+        evm_->StartSessionThreads(io_threads_);
         thread_.reset(new ServerThread(evm_.get()));
         for (int i = 0; i < max_num_servers_; i++) {
             server_.push_back(new EchoServer(evm_.get()));
@@ -226,7 +227,8 @@ protected:
         std::cout << "Num Servers " << max_num_servers_ 
             << " Num Connections " << max_num_connections_ 
             << " Maximum packet size " << max_packet_size_
-            << " Is blocking " << blocking_ << std::endl;
+            << " Is blocking " << blocking_
+            << " IO threads " << io_threads_ << std::endl;
         for (int i = 0; i < max_num_connections_; i++) {
             uint32_t server = 0;
             uint32_t client = 0;
@@ -403,6 +405,7 @@ protected:
         max_num_connections_ = std::tr1::get<1>(GetParam());
         max_packet_size_ = std::tr1::get<2>(GetParam());
         blocking_ = std::tr1::get<3>(GetParam());
+        io_threads_ = std::tr1::get<4>(GetParam());
     }
 
     bool verify_rx() {
@@ -436,6 +439,7 @@ protected:
     int max_num_connections_;
     int max_packet_size_;
     int blocking_;
+    int io_threads_;
 };
 
 TEST_P(EchoServerTest, Basic) {
@@ -513,6 +517,35 @@ TEST_P(EchoServerTest, ServerShutdown) {
     }
 }
 
+//
+// Every client session sends kMessages messages back to back. The time it
+// takes until the servers have received all of them is reported, so that
+// runs with different numbers of IO threads can be compared.
+//
+TEST_P(EchoServerTest, Throughput) {
+    static const int kMessages = 100;
+    uint64_t start = UTCTimestampUsec();
+    uint64_t total = 0;
+    for (int i = 0; i < kMessages; i++) {
+        BOOST_FOREACH(SessionMatrix::value_type mapref, session_matrix_) {
+            if (!mapref.first->IsEstablished()) {
+                continue;
+            }
+
+            // Whatever the socket does not take right away is buffered by
+            // the session and sent later on.
+            mapref.first->Send((const u_int8_t *) msg, max_packet_size_, NULL);
+            EchoSession *session = static_cast<EchoSession *>(mapref.first);
+            session->increment_sent(max_packet_size_);
+            total += max_packet_size_;
+        }
+    }
+    TASK_UTIL_ASSERT_TRUE(verify_rx());
+    uint64_t elapsed = UTCTimestampUsec() - start;
+    std::cout << "IO threads " << io_threads_ << ": " << total
+        << " bytes in " << elapsed << " usecs" << std::endl;
+}
+
 TEST_P(EchoServerTest, ClientDisconnect) {
     for (int i = 0; i < 10; i++) {
         uint32_t server = rand() % max_num_servers_;
@@ -539,9 +572,11 @@ static vector<int> n_servers = boost::assign::list_of(64);
 static vector<int> n_connections = boost::assign::list_of(32);
 static vector<int> n_sizes = boost::assign::list_of(4094);
 static vector<bool> n_blk_nonblk = boost::assign::list_of(false);
+static vector<int> n_io_threads = boost::assign::list_of(0)(4);
 
 static void process_command_line_args(int argc, char **argv) {
     int servers = 1, connections = 1, size = 128, blocking = false;
+    int io_threads = 0;
     options_description desc("Allowed options");
     bool cmd_line_arg_set = false;
     desc.add_options()
@@ -550,6 +585,7 @@ static void process_command_line_args(int argc, char **argv) {
         ("connections", value<int>(), "set number of connectios")
         ("blocking", value<bool>(), "Are the connections blocking")
         ("size", value<int>(), "Size of message")
+        ("io-threads", value<int>(), "Number of session IO threads")
         ;
 
     variables_map vm;
@@ -581,6 +617,11 @@ static void process_command_line_args(int argc, char **argv) {
         cmd_line_arg_set = true;
     }
 
+    if (vm.count("io-threads")) {
+        io_threads = vm["io-threads"].as<int>();
+        cmd_line_arg_set = true;
+    }
+
 
     if (cmd_line_arg_set) {
         n_servers.clear();
@@ -591,6 +632,8 @@ static void process_command_line_args(int argc, char **argv) {
         n_sizes.push_back(size);
         n_blk_nonblk.clear();
         n_blk_nonblk.push_back(blocking);
+        n_io_threads.clear();
+        n_io_threads.push_back(io_threads);
     }
 }
 
@@ -609,7 +652,8 @@ static vector<int> GetTestParam() {
     Combine(ValuesIn(GetTestParam()), \
             ValuesIn(n_connections),  \
             ValuesIn(n_sizes),        \
-            ValuesIn(n_blk_nonblk))
+            ValuesIn(n_blk_nonblk),   \
+            ValuesIn(n_io_threads))
 
 INSTANTIATE_TEST_CASE_P(TcpStressTestWithParams, EchoServerTest, 
                         COMBINE_PARAMS);
@@ -138,6 +138,32 @@ class EchoClient : public UDPServer
         bool client_rx_done_;
 };
 
+// Counts the datagrams it receives, reading the socket in batches.
+class FloodServer : public UDPServer
+{
+  public:
+    explicit FloodServer(EventManager *evm) : UDPServer(evm) {
+        rx_packets_ = 0;
+        rx_bytes_ = 0;
+    }
+    void HandleReceive(boost::asio::const_buffer recv_buffer,
+            udp::endpoint remote_endpoint, std::size_t bytes_transferred,
+            const boost::system::error_code& error) {
+        if (!error) {
+            rx_packets_++;
+            rx_bytes_ += bytes_transferred;
+        }
+        DeallocateBuffer(recv_buffer);
+    }
+
+    int GetRxPackets() const { return rx_packets_; }
+    int GetRxBytes() const { return rx_bytes_; }
+
+  private:
+    tbb::atomic<int> rx_packets_;
+    tbb::atomic<int> rx_bytes_;
+};
+
 class EchoServerTest : public ::testing::Test
 {
     protected:
@@ -218,6 +244,90 @@ TEST_F(EchoServerTest, Basic)
     TASK_UTIL_ASSERT_EQ (client_->GetRxBytes(), server_->GetTxBytes());
 }
 
+class FloodServerTest : public ::testing::Test
+{
+  protected:
+    FloodServerTest() : socket_(io_service_) { }
+
+    virtual void SetUp() {
+        evm_.reset(new EventManager());
+        server_.reset(new FloodServer(evm_.get()));
+        thread_.reset(new ServerThread(evm_.get()));
+        server_->Initialize(0);
+        server_->SetReceiveBatchSize(UDPServer::kMaxReceiveBatch);
+        server_->StartReceive();
+        boost::system::error_code ec;
+        endpoint_ = udp::endpoint(
+            boost::asio::ip::address::from_string("127.0.0.1", ec),
+            server_->GetLocalEndpointPort());
+        socket_.open(udp::v4());
+    }
+
+    virtual void TearDown() {
+        socket_.close();
+        server_->Shutdown();
+        evm_->Shutdown();
+        thread_->Join();
+        task_util::WaitForIdle();
+    }
+
+    void Send(int count, size_t size) {
+        std::vector<uint8_t> data(size, 0xab);
+        for (int i = 0; i < count; i++) {
+            socket_.send_to(boost::asio::buffer(data), endpoint_);
+        }
+    }
+
+    boost::asio::io_service io_service_;
+    udp::socket socket_;
+    udp::endpoint endpoint_;
+    std::auto_ptr<ServerThread> thread_;
+    std::auto_ptr<FloodServer> server_;
+    std::auto_ptr<EventManager> evm_;
+};
+
+// Datagrams that are queued on the socket are read in a single batch.
+TEST_F(FloodServerTest, Batch)
+{
+    Send(UDPServer::kMaxReceiveBatch, 100);
+    thread_->Start();
+    TASK_UTIL_EXPECT_EQ(UDPServer::kMaxReceiveBatch, server_->GetRxPackets());
+    EXPECT_EQ(UDPServer::kMaxReceiveBatch * 100, server_->GetRxBytes());
+
+    const UDPServer::ReceiveStats &stats = server_->GetReceiveStats();
+    EXPECT_EQ(UDPServer::kMaxReceiveBatch, stats.packets);
+#ifdef __linux__
+    EXPECT_EQ(1, stats.calls);
+    EXPECT_EQ(1, stats.batch_histogram[UDPServer::kReceiveBatchBuckets - 1]);
+#endif
+
+    // The server keeps reading after the batch.
+    Send(1, 100);
+    TASK_UTIL_EXPECT_EQ(UDPServer::kMaxReceiveBatch + 1,
+                        server_->GetRxPackets());
+}
+
+// Flood the server. Run with --gtest_also_run_disabled_tests; gtest reports
+// the elapsed time.
+TEST_F(FloodServerTest, DISABLED_Flood)
+{
+    const int kPackets = 1000000;
+    const int kWindow = 4096;
+    thread_->Start();
+    for (int sent = 0; sent < kPackets; sent += 256) {
+        Send(256, 64);
+        // Pace the sender so that the socket buffer does not overflow.
+        while (sent - server_->GetRxPackets() > kWindow) {
+            usleep(100);
+        }
+    }
+    TASK_UTIL_EXPECT_EQ(kPackets, server_->GetRxPackets());
+
+    const UDPServer::ReceiveStats &stats = server_->GetReceiveStats();
+    EXPECT_EQ(kPackets, stats.packets);
+    EXPECT_LE(uint64_t(stats.calls), uint64_t(stats.packets));
+}
+
 TEST_F(EchoServerBranchTest, Basic)
 {
     TestCreation();
@@ -1,6 +1,9 @@
 /*
  * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
  */
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstring>
 #include <boost/bind.hpp>
 #include <base/logging.h>
 #include "udp_server.h"
@@ -9,11 +12,22 @@
 using namespace boost::asio;
 using boost::asio::ip::udp;
 
+UDPServer::ReceiveStats::ReceiveStats()
+{
+    calls = 0;
+    packets = 0;
+    for (int i = 0; i < kReceiveBatchBuckets; i++) {
+        batch_histogram[i] = 0;
+    }
+}
+
 UDPServer::UDPServer (boost::asio::io_service& io_service, int buffer_size):
     socket_ (io_service),
     buffer_size_ (buffer_size), 
     state_ (Uninitialized),
-    evm_(0)
+    evm_(0),
+    receive_batch_size_(1),
+    receive_pending_(false)
 {
 }
 
@@ -21,7 +35,9 @@ UDPServer::UDPServer (EventManager *evm, int buffer_size):
     socket_ (*(evm->io_service ())),
     buffer_size_ (buffer_size), 
     state_ (Uninitialized),
-    evm_(evm)
+    evm_(evm),
+    receive_batch_size_(1),
+    receive_pending_(false)
 {
 }
 
@@ -35,9 +51,10 @@ void UDPServer::SetName (udp::endpoint ep)
 
 UDPServer::~UDPServer()
 {
-    while (!pbuf_.empty()) {
-        delete[] pbuf_.back();
-        pbuf_.pop_back();
+    while (!buffers_.empty()) {
+        TcpBufferPool::Header *header = &buffers_.front();
+        buffers_.pop_front();
+        pool_.Free(header);
     }
     Reset();
 }
@@ -104,6 +121,12 @@ void UDPServer::Initialize (udp::endpoint local_endpoint)
         state_ = SocketBindFailed;
         return;
     }
+    // Batched sends must not block the event manager thread.
+    socket_.non_blocking(true, error);
+    if (error) {
+        TCP_SERVER_LOG_ERROR(this, TCP_DIR_NA, "udp socket non_blocking: "
+            << error.message());
+    }
     SetName (local_endpoint);
     state_ = OK;
     // StartReceive ();
@@ -117,9 +140,12 @@ udp::endpoint UDPServer::GetLocalEndPoint ()
 
 mutable_buffer UDPServer::AllocateBuffer (std::size_t s)
 {
-    u_int8_t *p = new u_int8_t[s];
-    pbuf_.push_back (p);
-    return mutable_buffer (p, s);
+    TcpBufferPool::Header *header = pool_.Allocate(s);
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        buffers_.push_back(*header);
+    }
+    return mutable_buffer (header->data(), s);
 }
 
 mutable_buffer UDPServer::AllocateBuffer ()
@@ -129,12 +155,14 @@ mutable_buffer UDPServer::AllocateBuffer ()
 
 void UDPServer::DeallocateBuffer (boost::asio::const_buffer &buffer)
 {
-    const u_int8_t *p = buffer_cast<const uint8_t *>(buffer);
-    std::vector<u_int8_t *>::iterator f = std::find(pbuf_.begin(),
-        pbuf_.end(), p);
-    if (f != pbuf_.end())
-        pbuf_.erase(f);
-    delete[] p;
+    TcpBufferPool::Header *header = TcpBufferPool::Header::FromData(
+        buffer_cast<const uint8_t *>(buffer));
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        assert(header->node.is_linked());
+        buffers_.erase(buffers_.iterator_to(*header));
+    }
+    pool_.Free(header);
 }
 
 void UDPServer::StartSend(udp::endpoint &ep, std::size_t bytes_to_send,
@@ -153,9 +181,98 @@ void UDPServer::StartSend(udp::endpoint &ep, std::size_t bytes_to_send,
     }
 }
 
+std::size_t UDPServer::SendBatch(const std::vector<udp::endpoint> &endpoints,
+    const std::vector<boost::asio::const_buffer> &buffers,
+    boost::system::error_code &error)
+{
+    assert(endpoints.size() == buffers.size());
+    error = boost::system::error_code();
+    if (state_ != OK) {
+        TCP_SERVER_LOG_ERROR(this, TCP_DIR_NA,
+            "error udp socket SendBatch: state==" << state_);
+        error = boost::asio::error::bad_descriptor;
+        return 0;
+    }
+
+    std::size_t sent = 0;
+#ifdef __linux__
+    struct mmsghdr msgs[kMaxSendBatch];
+    struct iovec iovs[kMaxSendBatch];
+    while (sent < buffers.size()) {
+        int count = std::min(buffers.size() - sent, (std::size_t) kMaxSendBatch);
+        memset(msgs, 0, sizeof(msgs[0]) * count);
+        for (int i = 0; i < count; i++) {
+            const boost::asio::const_buffer &buffer = buffers[sent + i];
+            const udp::endpoint &ep = endpoints[sent + i];
+            iovs[i].iov_base =
+                const_cast<void *>(buffer_cast<const void *>(buffer));
+            iovs[i].iov_len = buffer_size(buffer);
+            msgs[i].msg_hdr.msg_name = const_cast<sockaddr *>(ep.data());
+            msgs[i].msg_hdr.msg_namelen = ep.size();
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int ret = sendmmsg(socket_.native_handle(), msgs, count, 0);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            error = boost::asio::error::would_block;
+            break;
+        }
+        if (ret <= 0) {
+            error = boost::system::error_code(errno,
+                boost::asio::error::get_system_category());
+            TCP_SERVER_LOG_ERROR(this, TCP_DIR_NA,
+                "error udp socket sendmmsg: " << strerror(errno));
+            break;
+        }
+        sent += ret;
+    }
+#else
+    for (; sent < buffers.size(); sent++) {
+        socket_.send_to(const_buffers_1(buffers[sent]), endpoints[sent], 0,
+                        error);
+        if (error == boost::asio::error::would_block) {
+            break;
+        }
+        if (error) {
+            TCP_SERVER_LOG_ERROR(this, TCP_DIR_NA,
+                "error udp socket send_to: " << error.message());
+            break;
+        }
+    }
+#endif
+    return sent;
+}
+
+void UDPServer::AsyncWaitWritable(WritableHandler handler)
+{
+    socket_.async_send(null_buffers(), boost::bind(handler,
+        boost::asio::placeholders::error));
+}
+
+void UDPServer::SetReceiveBatchSize(int size)
+{
+    assert(size > 0 && size <= kMaxReceiveBatch);
+    receive_batch_size_ = size;
+    batch_buffers_.resize(size);
+    batch_endpoints_.resize(size);
+    batch_bytes_.resize(size);
+    batch_truncated_.resize(size);
+}
+
 void UDPServer::StartReceive()
 {
-    if (state_ == OK) {
+    if (state_ == OK && receive_batch_size_ > 1) {
+        // A handler may restart the receive while a batch is delivered.
+        if (receive_pending_)
+            return;
+        receive_pending_ = true;
+        socket_.async_receive(null_buffers(),
+            boost::bind(&UDPServer::HandleReceiveBatch, this,
+            boost::asio::placeholders::error));
+    } else if (state_ == OK) {
         mutable_buffer             b = AllocateBuffer ();
         boost::asio::const_buffer  buffer (buffer_cast<const uint8_t*>(b),
                                         buffer_size(b));
@@ -173,11 +290,108 @@ void UDPServer::StartReceive()
 void UDPServer::HandleReceiveInternal (boost::asio::const_buffer recv_buffer,
     std::size_t bytes_transferred, const boost::system::error_code& error)
 {
+    if (!error.value())
+        UpdateReceiveStats(1);
     HandleReceive (recv_buffer, remote_endpoint_, bytes_transferred, error);
     if (!error.value())
         StartReceive();
 }
 
+void UDPServer::HandleReceiveBatch(const boost::system::error_code& error)
+{
+    receive_pending_ = false;
+    if (error) {
+        if (error != boost::asio::error::operation_aborted) {
+            TCP_SERVER_LOG_ERROR(this, TCP_DIR_NA,
+                "error reading udp socket " << error);
+        }
+        return;
+    }
+    if (state_ != OK)
+        return;
+
+    int count = ReceiveBatch();
+    if (count > 0)
+        UpdateReceiveStats(count);
+
+    // The buffers are handed over to HandleReceive.
+    for (int i = 0; i < count; i++) {
+        const uint8_t *data = buffer_cast<const uint8_t *>(batch_buffers_[i]);
+        boost::asio::const_buffer buffer(data,
+                                         buffer_size(batch_buffers_[i]));
+        batch_buffers_[i] = mutable_buffer();
+        boost::system::error_code ec;
+        if (batch_truncated_[i])
+            ec = boost::asio::error::message_size;
+        HandleReceive(buffer, batch_endpoints_[i], batch_bytes_[i], ec);
+    }
+    StartReceive();
+}
+
+// Read the datagrams available on the socket, up to receive_batch_size_,
+// into the batch buffers. Buffers that are not used are kept for the next
+// batch. Returns the number of datagrams read.
+int UDPServer::ReceiveBatch()
+{
+    for (int i = 0; i < receive_batch_size_; i++) {
+        if (buffer_size(batch_buffers_[i]) == 0)
+            batch_buffers_[i] = AllocateBuffer();
+    }
+
+#ifdef __linux__
+    struct mmsghdr msgs[kMaxReceiveBatch];
+    struct iovec iovs[kMaxReceiveBatch];
+    memset(msgs, 0, sizeof(msgs[0]) * receive_batch_size_);
+    for (int i = 0; i < receive_batch_size_; i++) {
+        iovs[i].iov_base = buffer_cast<void *>(batch_buffers_[i]);
+        iovs[i].iov_len = buffer_size(batch_buffers_[i]);
+        msgs[i].msg_hdr.msg_name = batch_endpoints_[i].data();
+        msgs[i].msg_hdr.msg_namelen = batch_endpoints_[i].capacity();
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int count = recvmmsg(socket_.native_handle(), msgs, receive_batch_size_,
+                         MSG_DONTWAIT, NULL);
+    if (count < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            TCP_SERVER_LOG_ERROR(this, TCP_DIR_NA,
+                "error udp socket recvmmsg: " << strerror(errno));
+        }
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        batch_endpoints_[i].resize(msgs[i].msg_hdr.msg_namelen);
+        batch_bytes_[i] = msgs[i].msg_len;
+        batch_truncated_[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+    }
+    return count;
+#else
+    int count = 0;
+    for (; count < receive_batch_size_; count++) {
+        boost::system::error_code ec;
+        if (socket_.available(ec) == 0 || ec)
+            break;
+        batch_bytes_[count] = socket_.receive_from(
+            mutable_buffers_1(batch_buffers_[count]),
+            batch_endpoints_[count], 0, ec);
+        batch_truncated_[count] = (ec == boost::asio::error::message_size);
+        if (ec && !batch_truncated_[count])
+            break;
+    }
+    return count;
+#endif
+}
+
+void UDPServer::UpdateReceiveStats(int count)
+{
+    int bucket = 0;
+    while (bucket < kReceiveBatchBuckets - 1 && (count >> (bucket + 1)))
+        bucket++;
+    rx_stats_.calls++;
+    rx_stats_.packets += count;
+    rx_stats_.batch_histogram[bucket]++;
+}
+
 void UDPServer::HandleReceive (boost::asio::const_buffer recv_buffer,
     udp::endpoint remote_endpoint, std::size_t bytes_transferred,
     const boost::system::error_code& error)
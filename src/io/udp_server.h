@@ -2,8 +2,12 @@
  * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
  */
 #include <boost/asio.hpp>
+#include <boost/function.hpp>
 #include <io/event_manager.h>
 #include <boost/intrusive_ptr.hpp>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+#include "io/tcp_buffer_pool.h"
 using boost::asio::ip::udp;
 using boost::asio::mutable_buffer;
 
@@ -19,6 +23,17 @@ public:
     typedef boost::intrusive_ptr<UDPServer> UDPServerPtr;
 
     static const int kDefaultBufferSize = 4 * 1024;
+    static const int kMaxSendBatch = 64;
+    static const int kMaxReceiveBatch = 64;
+    static const int kReceiveBatchBuckets = 7;
+
+    struct ReceiveStats {
+        ReceiveStats();
+        tbb::atomic<uint64_t> calls;
+        tbb::atomic<uint64_t> packets;
+        // Number of receive calls that returned [2^i, 2^(i+1)) datagrams.
+        tbb::atomic<uint64_t> batch_histogram[kReceiveBatchBuckets];
+    };
 
     explicit UDPServer (EventManager *evm, int buffer_size=kDefaultBufferSize);
     explicit UDPServer (boost::asio::io_service &io_service,
@@ -35,12 +50,29 @@ public:
     //tx-rx
     void StartSend(udp::endpoint &ep, std::size_t bytes_to_send,
             mutable_buffer buffer);
+    // Send a batch of packets, with one system call per kMaxSendBatch
+    // packets where the platform allows it. The buffers only need to be
+    // valid for the duration of the call. Returns the number of packets sent.
+    // The socket does not block: if the send buffer fills up, error is set
+    // to would_block and the caller may resend the rest once
+    // AsyncWaitWritable calls back.
+    std::size_t SendBatch(const std::vector<udp::endpoint> &endpoints,
+            const std::vector<boost::asio::const_buffer> &buffers,
+            boost::system::error_code &error);
+    typedef boost::function<void(const boost::system::error_code &)>
+        WritableHandler;
+    void AsyncWaitWritable(WritableHandler handler);
     virtual void HandleReceive (
             boost::asio::const_buffer recv_buffer, 
             udp::endpoint remote_endpoint,
             std::size_t bytes_transferred,
             const boost::system::error_code& error);
     void StartReceive();
+    // Read up to size datagrams, with a single system call where the
+    // platform allows it, each time the socket becomes readable instead of
+    // posting a read per datagram. Must be called before StartReceive.
+    void SetReceiveBatchSize(int size);
+    const ReceiveStats &GetReceiveStats() const { return rx_stats_; }
     virtual void HandleSend (boost::asio::const_buffer send_buffer,
             udp::endpoint remote_endpoint, std::size_t bytes_transferred,
             const boost::system::error_code& error);
@@ -52,7 +84,7 @@ public:
     int GetLocalEndpointPort();
 
 
-    //buffers
+    //buffers. Buffers are recycled, and can be deallocated from any thread.
     mutable_buffer AllocateBuffer();
     mutable_buffer AllocateBuffer(std::size_t s);
     void DeallocateBuffer (boost::asio::const_buffer &buffer);
@@ -67,6 +99,9 @@ private:
             boost::asio::const_buffer recv_buffer, 
             std::size_t bytes_transferred,
             const boost::system::error_code& error);
+    void HandleReceiveBatch(const boost::system::error_code& error);
+    int ReceiveBatch();
+    void UpdateReceiveStats(int count);
     DISALLOW_COPY_AND_ASSIGN(UDPServer);
     boost::asio::ip::udp::socket socket_;
     int buffer_size_;
@@ -74,5 +109,14 @@ private:
     EventManager *evm_;
     std::string name_;
     udp::endpoint remote_endpoint_;
-    std::vector<u_int8_t *> pbuf_;
+    TcpBufferPool pool_;
+    tbb::mutex mutex_;
+    TcpBufferPool::List buffers_;
+    int receive_batch_size_;
+    bool receive_pending_;
+    std::vector<mutable_buffer> batch_buffers_;
+    std::vector<udp::endpoint> batch_endpoints_;
+    std::vector<std::size_t> batch_bytes_;
+    std::vector<bool> batch_truncated_;
+    ReceiveStats rx_stats_;
 };
@@ -78,93 +78,116 @@ public:
         tbb::atomic<uint32_t> chunk_q;
     };
 
-    void JsonInsert(std::vector<query_column> &columns,
+    // Output type of each column of the table being queried. Built once
+    // per query so that rows are jsonified with a single lookup per cell.
+    enum JsonColType {
+        JSON_COL_STRING,
+        JSON_COL_IPV4,
+        JSON_COL_DOUBLE,
+        JSON_COL_UINT64
+    };
+    typedef std::map<std::string, JsonColType> JsonSchemaT;
+
+    static void JsonSchemaBuild(const std::vector<query_column> &columns,
+            JsonSchemaT &schema) {
+        for (size_t j = 0; j < columns.size(); j++) {
+            JsonColType type;
+            if (columns[j].datatype == "string" ||
+                columns[j].datatype == "uuid") {
+                type = JSON_COL_STRING;
+            } else if (columns[j].datatype == "ipv4") {
+                type = JSON_COL_IPV4;
+            } else if (columns[j].datatype == "double") {
+                type = JSON_COL_DOUBLE;
+            } else {
+                type = JSON_COL_UINT64;
+            }
+            schema.insert(std::make_pair(columns[j].name, type));
+        }
+    }
+
+    void JsonInsert(const JsonSchemaT &schema,
             rapidjson::Document& dd,
             std::pair<const string,string> * map_it) {
 
-        bool found = false;
-        for (size_t j = 0; j < columns.size(); j++)
-        {
-            if (0 == map_it->first.compare(0,5,string("COUNT"))) {
+        JsonColType type;
+        if (0 == map_it->first.compare(0,5,string("COUNT"))) {
+            type = JSON_COL_UINT64;
+        } else {
+            JsonSchemaT::const_iterator it = schema.find(map_it->first);
+            assert(it != schema.end());
+            type = it->second;
+        }
+
+        switch (type) {
+        case JSON_COL_STRING: {
+                rapidjson::Value val(rapidjson::kStringType);
+                val.SetString(map_it->second.c_str(), map_it->second.size());
+                dd.AddMember(map_it->first.c_str(), val, dd.GetAllocator());
+            }
+            break;
+        case JSON_COL_IPV4: {
+                rapidjson::Value val(rapidjson::kStringType);
+                char str[INET_ADDRSTRLEN];
+                uint32_t ipaddr = 0;
+
+                stringToInteger(map_it->second, ipaddr);
+                ipaddr = htonl(ipaddr);
+                inet_ntop(AF_INET, &(ipaddr), str, INET_ADDRSTRLEN);
+                map_it->second = str;
+
+                val.SetString(map_it->second.c_str(), map_it->second.size());
+                dd.AddMember(map_it->first.c_str(), val, dd.GetAllocator());
+            }
+            break;
+        case JSON_COL_DOUBLE: {
+                rapidjson::Value val(rapidjson::kNumberType);
+                double dval = (double) strtod(map_it->second.c_str(), NULL);
+                val.SetDouble(dval);
+                dd.AddMember(map_it->first.c_str(), val, dd.GetAllocator());
+            }
+            break;
+        case JSON_COL_UINT64: {
                 rapidjson::Value val(rapidjson::kNumberType);
                 unsigned long num = 0;
                 stringToInteger(map_it->second, num);
                 val.SetUint64(num);
                 dd.AddMember(map_it->first.c_str(), val, dd.GetAllocator());
-                found = true;
-            } else if (columns[j].name == map_it->first) {
-                // find out type and convert
-                if (columns[j].datatype == "string" || 
-                    columns[j].datatype == "uuid")
-                {
-                    rapidjson::Value val(rapidjson::kStringType);
-                    val.SetString(map_it->second.c_str());
-                    dd.AddMember(map_it->first.c_str(), val, dd.GetAllocator());
-                } else if (columns[j].datatype == "ipv4") {
-                    rapidjson::Value val(rapidjson::kStringType);
-                    char str[INET_ADDRSTRLEN];
-                    uint32_t ipaddr = 0;
-
-                    stringToInteger(map_it->second, ipaddr);
-                    ipaddr = htonl(ipaddr);
-                    inet_ntop(AF_INET, &(ipaddr), str, INET_ADDRSTRLEN);
-                    map_it->second = str;
-
-                    val.SetString(map_it->second.c_str(), map_it->second.size());
-                    dd.AddMember(map_it->first.c_str(), val, dd.GetAllocator());
-
-                } else if (columns[j].datatype == "double") {
-                    rapidjson::Value val(rapidjson::kNumberType);
-                    double dval = (double) strtod(map_it->second.c_str(), NULL);
-                    val.SetDouble(dval);
-                    dd.AddMember(map_it->first.c_str(), val, dd.GetAllocator());
-                } else {
-                    rapidjson::Value val(rapidjson::kNumberType);
-                    unsigned long num = 0;
-                    stringToInteger(map_it->second, num);
-                    val.SetUint64(num);
-                    dd.AddMember(map_it->first.c_str(), val, dd.GetAllocator());
-                }
-                found = true;
             }
+            break;
         }
-        assert(found);    
     }
 
     void QueryJsonify(const string& table, bool map_output,
         const BufferT* raw_res, const OutRowMultimapT* raw_mres, QEOutputT* raw_json) {
 
-        vector<OutRowT>::iterator res_it;
-
-        std::vector<query_column>  columns;
+        const std::vector<query_column> *columns = NULL;
 
         if (!table.size()) return;
-        bool found = false;
         for(size_t i = 0; i < g_viz_constants._TABLES.size(); i++)
         {
             if (g_viz_constants._TABLES[i].name == table) {
-                found = true;
-                columns = g_viz_constants._TABLES[i].schema.columns;
+                columns = &g_viz_constants._TABLES[i].schema.columns;
             }
         }
-        if (!found) {
+        if (!columns) {
             if (g_viz_constants.OBJECT_VALUE_TABLE == table) {
-                found = true;
-                columns = g_viz_constants._OBJECT_TABLE_SCHEMA.columns; 
+                columns = &g_viz_constants._OBJECT_TABLE_SCHEMA.columns; 
             }
         }
-        if (!found) {
+        if (!columns) {
             for (std::map<std::string, objtable_info>::const_iterator it =
                     g_viz_constants._OBJECT_TABLES.begin();
                     it != g_viz_constants._OBJECT_TABLES.end(); it++) {
                 if (it->first == table) {
-                    found = true;
-                    columns = g_viz_constants._OBJECT_TABLE_SCHEMA.columns;
+                    columns = &g_viz_constants._OBJECT_TABLE_SCHEMA.columns;
                 }
             }
         }
-        assert(found || map_output);
+        assert(columns || map_output);
 
+        raw_json->reserve(raw_json->size() +
+            (map_output ? raw_mres->size() : raw_res->size()));
         if (map_output) {
             OutRowMultimapT::const_iterator mres_it;
             for (mres_it = raw_mres->begin(); mres_it != raw_mres->end(); ++mres_it) {
@@ -173,6 +196,9 @@ public:
                 raw_json->push_back(jstr);
             }
         } else {
+            JsonSchemaT schema;
+            JsonSchemaBuild(*columns, schema);
+
             QEOpServerProxy::BufferT* raw_result = 
                 const_cast<QEOpServerProxy::BufferT*>(raw_res);
             QEOpServerProxy::BufferT::iterator res_it;
@@ -184,7 +210,7 @@ public:
                 for (map_it = (*res_it).first.begin(); 
                      map_it != (*res_it).first.end(); ++map_it) {
                     // search for column name in the schema
-                    JsonInsert(columns, dd, &(*map_it));
+                    JsonInsert(schema, dd, &(*map_it));
                 }
                 rapidjson::StringBuffer sb;
                 rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
@@ -52,6 +52,70 @@ bool PostProcessingQuery::sort_field_comparator(
     return false;
 }
 
+bool PostProcessingQuery::sorted_row_comparator(
+        const QEOpServerProxy::ResultRowT& lhs,
+        const QEOpServerProxy::ResultRowT& rhs) {
+    if (sorting_type == ASCENDING) {
+        return sort_field_comparator(lhs, rhs);
+    }
+    return sort_field_comparator(rhs, lhs);
+}
+
+// Heap entries are (input index, row index). The heap keeps the row that
+// comes first in the sort order on top; ties go to the earlier input.
+struct PostProcessingQuery::SortedMergeCmp {
+    typedef std::pair<size_t, size_t> Cursor;
+
+    SortedMergeCmp(PostProcessingQuery *pq,
+            const std::vector<const QEOpServerProxy::BufferT *>& inputs) :
+        pq_(pq), inputs_(inputs) {
+    }
+    bool operator()(const Cursor& lhs, const Cursor& rhs) const {
+        const QEOpServerProxy::ResultRowT& lrow =
+            (*inputs_[lhs.first])[lhs.second];
+        const QEOpServerProxy::ResultRowT& rrow =
+            (*inputs_[rhs.first])[rhs.second];
+        if (pq_->sorted_row_comparator(rrow, lrow)) return true;
+        if (pq_->sorted_row_comparator(lrow, rrow)) return false;
+        return lhs.first > rhs.first;
+    }
+
+    PostProcessingQuery *pq_;
+    const std::vector<const QEOpServerProxy::BufferT *>& inputs_;
+};
+
+void PostProcessingQuery::sorted_merge(
+        const std::vector<const QEOpServerProxy::BufferT *>& inputs,
+        QEOpServerProxy::BufferT& output, size_t max_rows) {
+    size_t total_rows = 0;
+    std::vector<SortedMergeCmp::Cursor> heap;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        total_rows += inputs[i]->size();
+        if (inputs[i]->size()) {
+            heap.push_back(std::make_pair(i, 0));
+        }
+    }
+    if (max_rows && max_rows < total_rows) {
+        total_rows = max_rows;
+    }
+    QE_TRACE(DEBUG, "Merging results between " << inputs.size() <<
+            " vectors with final vector size:" << total_rows);
+    output.reserve(output.size() + total_rows);
+
+    SortedMergeCmp cmp(this, inputs);
+    std::make_heap(heap.begin(), heap.end(), cmp);
+    for (size_t count = 0; count < total_rows && !heap.empty(); count++) {
+        std::pop_heap(heap.begin(), heap.end(), cmp);
+        SortedMergeCmp::Cursor& cursor = heap.back();
+        output.push_back((*inputs[cursor.first])[cursor.second]);
+        if (++cursor.second < inputs[cursor.first]->size()) {
+            std::push_heap(heap.begin(), heap.end(), cmp);
+        } else {
+            heap.pop_back();
+        }
+    }
+}
+
 bool PostProcessingQuery::flowseries_merge_processing(
         const QEOpServerProxy::BufferT *raw_result,
         QEOpServerProxy::BufferT* merged_result, 
@@ -209,52 +273,27 @@ bool PostProcessingQuery::merge_processing(
 
     // Check if the result has to be sorted
     if (sorted) {
-        QEOpServerProxy::BufferT *merged_result = &output;
-        const QEOpServerProxy::BufferT *raw_result1 = &(input);
+        std::vector<const QEOpServerProxy::BufferT *> sorted_inputs;
 
         if (result_.get() == NULL) {
-            size_t merged_result_size = merged_result->size();
-            merged_result->reserve(merged_result_size + raw_result1->size());
-            copy(raw_result1->begin(), raw_result1->end(), 
-                 std::back_inserter(*merged_result));
-            if (merged_result_size) { 
-                if (sorting_type == ASCENDING) {
-                    std::inplace_merge(merged_result->begin(), 
-                        merged_result->begin() + merged_result_size,
-                        merged_result->end(),
-                        boost::bind(&PostProcessingQuery::sort_field_comparator, 
-                                    this, _1, _2));
-                } else {
-                    std::inplace_merge(merged_result->rbegin(),
-                        merged_result->rbegin() + raw_result1->size(),
-                        merged_result->rend(),
-                        boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                    this, _1, _2));
-                }
+            // Only the first limit rows of the accumulated result can make
+            // it to the final result, unless flow records still have to be
+            // uniquified in final_merge_processing.
+            size_t max_rows = 0;
+            if (limit && mquery->table() != g_viz_constants.FLOW_TABLE) {
+                max_rows = limit;
             }
-
+            QEOpServerProxy::BufferT merged_result;
+            sorted_inputs.push_back(&output);
+            sorted_inputs.push_back(&input);
+            sorted_merge(sorted_inputs, merged_result, max_rows);
+            output.swap(merged_result);
             goto sort_done;
         }
 
-        QEOpServerProxy::BufferT *raw_result2 = result_.get();
-        size_t size1 = raw_result1->size();
-        size_t size2 = raw_result2->size();
-        QE_TRACE(DEBUG, "Merging results from vectors of size:" <<
-                size1 << " and " << size2);
-        merged_result->reserve(raw_result1->size() + raw_result2->size());
-        if (sorting_type == ASCENDING) {
-            std::merge(raw_result1->begin(), raw_result1->end(), 
-                raw_result2->begin(), raw_result2->end(),
-                std::back_inserter(*merged_result),
-                boost::bind(&PostProcessingQuery::sort_field_comparator, 
-                            this, _1, _2)); 
-        } else {
-            std::merge(raw_result1->rbegin(), raw_result1->rend(), 
-                raw_result2->rbegin(), raw_result2->rend(),
-                std::back_inserter(*merged_result),
-                boost::bind(&PostProcessingQuery::sort_field_comparator, 
-                            this, _1, _2)); 
-        }
+        sorted_inputs.push_back(&input);
+        sorted_inputs.push_back(result_.get());
+        sorted_merge(sorted_inputs, output, 0);
     } 
 
 sort_done:
@@ -385,37 +424,11 @@ const std::vector<boost::shared_ptr<QEOpServerProxy::BufferT> >& inputs,
     } else {  // For non-flow-record queries
         // Check if the result has to be sorted
         if (sorted) {
-            QEOpServerProxy::BufferT *merged_result = &output;
-            size_t final_vector_size = 0;
-            for (size_t i = 0; i < inputs.size(); i++)
-                final_vector_size += inputs[i]->size();
-        
-            QE_TRACE(DEBUG, "Merging results between " << inputs.size() 
-                    << " vectors with final vector size:" << final_vector_size);
-
-            merged_result->reserve(final_vector_size);
-
-            for (size_t i = 0; i < inputs.size(); i++)
-            {
-                QEOpServerProxy::BufferT *raw_result = inputs[i].get();
-                if (sorting_type == ASCENDING) {
-                    QEOpServerProxy::BufferT::iterator
-                        current_result_end = merged_result->end();
-                    copy(raw_result->begin(), raw_result->end(), 
-                        std::back_inserter(*merged_result));
-                    std::inplace_merge(merged_result->begin(),
-                    current_result_end, merged_result->end(),
-    boost::bind(&PostProcessingQuery::sort_field_comparator, this, _1, _2)); 
-                } else {
-                    QEOpServerProxy::BufferT::reverse_iterator
-                        current_result_end = merged_result->rbegin();
-                    copy(raw_result->begin(), raw_result->end(), 
-                        std::back_inserter(*merged_result));
-                    std::inplace_merge(merged_result->rbegin(),
-                    current_result_end, merged_result->rend(),
-    boost::bind(&PostProcessingQuery::sort_field_comparator, this, _1, _2)); 
-                }
+            std::vector<const QEOpServerProxy::BufferT *> sorted_inputs;
+            for (size_t i = 0; i < inputs.size(); i++) {
+                sorted_inputs.push_back(inputs[i].get());
             }
+            sorted_merge(sorted_inputs, output, limit > 0 ? limit : 0);
         }
     }
    
@@ -508,13 +521,15 @@ query_status_t PostProcessingQuery::process_query() {
     }
     if (filter_list.size() != 0)
     {
-        QEOpServerProxy::BufferT filtered_table;
+        // Surviving rows are compacted in place, so no copy of the
+        // result is made
+        size_t filtered_size = 0;
         // do filter operation
         QE_TRACE(DEBUG, "Doing filter operation");
         for (size_t i = 0; i < raw_result->size(); i++)
         {
             bool delete_row = false;
-            QEOpServerProxy::ResultRowT row = (*raw_result)[i];
+            QEOpServerProxy::ResultRowT& row = (*raw_result)[i];
 
             for (size_t j = 0; j < filter_list.size(); j++)
             {
@@ -581,6 +596,9 @@ query_status_t PostProcessingQuery::process_query() {
                         // upsupported filter operation
                         QE_LOG(ERROR, "Unsupported filter operation: " <<
                                filter_list[j].op);
+                        // The rows seen so far are already compacted in
+                        // place, so the result is no longer usable
+                        raw_result->clear();
                         return QUERY_FAILURE;
                 }
                 if (delete_row == true)
@@ -591,31 +609,38 @@ query_status_t PostProcessingQuery::process_query() {
             {
                 QE_TRACE(DEBUG, "filter out entry #:" << i);
             } else {
-                filtered_table.push_back(row);
+                if (filtered_size != i) {
+                    std::swap((*raw_result)[filtered_size], row);
+                }
+                filtered_size++;
             }
         }
-        *raw_result = filtered_table;
+        raw_result->resize(filtered_size);
     }
 
+    // If the flow series query is parallelized, we should apply the limit 
+    // only after the result from all the tasks are merged 
+    // (@ final_merge_processing).
+    bool apply_limit = (mquery->table() != g_viz_constants.FLOW_SERIES_TABLE ||
+        (mquery->table() == g_viz_constants.FLOW_SERIES_TABLE && 
+        !mquery->is_query_parallelized())) && limit;
+
     // Check if the result has to be sorted
     if (sorted) {
-        if (sorting_type == ASCENDING) {
-            std::sort(raw_result->begin(), raw_result->end(), 
-                      boost::bind(&PostProcessingQuery::sort_field_comparator, 
-                                  this, _1, _2)); 
+        // Only order the rows that survive the limit
+        if (apply_limit && raw_result->size() > (size_t)limit) {
+            std::partial_sort(raw_result->begin(),
+                raw_result->begin() + limit, raw_result->end(),
+                boost::bind(&PostProcessingQuery::sorted_row_comparator,
+                            this, _1, _2));
         } else {
-            std::sort(raw_result->rbegin(), raw_result->rend(), 
-                      boost::bind(&PostProcessingQuery::sort_field_comparator,
-                                  this, _1, _2));
+            std::sort(raw_result->begin(), raw_result->end(),
+                boost::bind(&PostProcessingQuery::sorted_row_comparator,
+                            this, _1, _2));
         }
     }
 
-    // If the flow series query is parallelized, we should apply the limit 
-    // only after the result from all the tasks are merged 
-    // (@ final_merge_processing).
-    if ((mquery->table() != g_viz_constants.FLOW_SERIES_TABLE || 
-        (mquery->table() == g_viz_constants.FLOW_SERIES_TABLE && 
-        !mquery->is_query_parallelized())) && limit) {
+    if (apply_limit) {
         QE_TRACE(DEBUG, "Apply Limit [" << limit << "]");
         if (raw_result->size() > (size_t)limit) {
             raw_result->resize(limit);
@@ -1201,7 +1201,7 @@ int AnalyticsQuery::stat_table_index() {
         string nm = g_viz_constants.STAT_VT_PREFIX + "." + 
                 g_viz_constants._STAT_TABLES[i].stat_type + "." +
                 g_viz_constants._STAT_TABLES[i].stat_attr;
-        if (nm == this->table_) 
+        if (nm == table())
             return i;
     }
     assert(!is_stat_table_query());
@@ -681,6 +681,10 @@ public:
     bool sort_field_comparator(const QEOpServerProxy::ResultRowT& lhs,
                                const QEOpServerProxy::ResultRowT& rhs);
 
+    // compare rows in the order requested by sorting_type
+    bool sorted_row_comparator(const QEOpServerProxy::ResultRowT& lhs,
+                               const QEOpServerProxy::ResultRowT& rhs);
+
     // compare flow records based on UUID
     static bool flow_record_comparator(const QEOpServerProxy::ResultRowT& lhs,
                                        const QEOpServerProxy::ResultRowT& rhs);
@@ -693,6 +697,12 @@ const std::vector<boost::shared_ptr<QEOpServerProxy::BufferT> >& inputs,
                         QEOpServerProxy::BufferT& output);
 private:
     typedef std::map<uint64_t, QEOpServerProxy::ResultRowT> fcid_rrow_map_t;
+    struct SortedMergeCmp;
+    // k-way merge of already sorted inputs, appended to output.
+    // Stops after max_rows rows when max_rows is non-zero.
+    void sorted_merge(
+                const std::vector<const QEOpServerProxy::BufferT *>& inputs,
+                QEOpServerProxy::BufferT& output, size_t max_rows);
     bool flowseries_merge_processing(
                 const QEOpServerProxy::BufferT *raw_result,
                 QEOpServerProxy::BufferT *merged_result,
@@ -11,19 +11,128 @@ bool query_result_unit_t::operator<(const query_result_unit_t& rhs) const
     {
         GenDb::DbDataValueVec::const_iterator it = info.begin();
         GenDb::DbDataValueVec::const_iterator jt = rhs.info.begin();
-        for (; it != info.end(), jt != rhs.info.end(); it++, jt++) {
+        for (; it != info.end() && jt != rhs.info.end(); it++, jt++) {
             if (*it < *jt) {
                 return true;
             } else if (*jt < *it) {
                 return false;
             }
         }
-        return false;
+        // A prefix sorts first, so that equivalence stays transitive
+        return (info.size() < rhs.info.size());
     }
 
     return (timestamp < rhs.timestamp);
 }
 
+typedef std::vector<query_result_unit_t> QueryResultT;
+
+// Cursor into one sub-query result for the k-way union: (input, position).
+// The heap keeps the smallest current element on top.
+struct UnionCursorCmp {
+    typedef std::pair<size_t, size_t> Cursor;
+
+    explicit UnionCursorCmp(const std::vector<const QueryResultT *>& inputs) :
+        inputs_(inputs) {
+    }
+    bool operator()(const Cursor& lhs, const Cursor& rhs) const {
+        return (*inputs_[rhs.first])[rhs.second] <
+            (*inputs_[lhs.first])[lhs.second];
+    }
+
+    const std::vector<const QueryResultT *>& inputs_;
+};
+
+// Single pass union of all sorted sub-query results. As with chained
+// set_union, an element appears max(count in any input) times.
+static void kway_union(const std::vector<const QueryResultT *>& inputs,
+        QueryResultT& output) {
+    std::vector<UnionCursorCmp::Cursor> heap;
+    size_t max_size = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (inputs[i]->size()) {
+            heap.push_back(std::make_pair(i, 0));
+            max_size = std::max(max_size, inputs[i]->size());
+        }
+    }
+    output.reserve(max_size);
+
+    UnionCursorCmp cmp(inputs);
+    std::make_heap(heap.begin(), heap.end(), cmp);
+    std::vector<UnionCursorCmp::Cursor> equal;
+    while (!heap.empty()) {
+        const query_result_unit_t& value =
+            (*inputs[heap.front().first])[heap.front().second];
+
+        // Pull every input whose current element equals value
+        equal.clear();
+        do {
+            std::pop_heap(heap.begin(), heap.end(), cmp);
+            equal.push_back(heap.back());
+            heap.pop_back();
+        } while (!heap.empty() &&
+                 !(value < (*inputs[heap.front().first])[heap.front().second]));
+
+        size_t max_run = 0;
+        for (size_t i = 0; i < equal.size(); i++) {
+            const QueryResultT& input = *inputs[equal[i].first];
+            size_t run = 0;
+            while (equal[i].second + run < input.size() &&
+                   !(value < input[equal[i].second + run])) {
+                run++;
+            }
+            max_run = std::max(max_run, run);
+            equal[i].second += run;
+        }
+        output.insert(output.end(), max_run, value);
+
+        for (size_t i = 0; i < equal.size(); i++) {
+            if (equal[i].second < inputs[equal[i].first]->size()) {
+                heap.push_back(equal[i]);
+                std::push_heap(heap.begin(), heap.end(), cmp);
+            }
+        }
+    }
+}
+
+// Intersection of two sorted results, keeping min(count) of each element
+// like set_intersection. When large is much bigger than small, each element
+// of small is located in large with an exponential (galloping) search so the
+// cost is O(|small| log |large|) instead of O(|small| + |large|).
+static const size_t kGallopRatio = 16;
+
+static void gallop_intersection(const QueryResultT& small,
+        const QueryResultT& large, QueryResultT& output) {
+    if (large.size() < kGallopRatio * small.size()) {
+        set_intersection(small.begin(), small.end(),
+                large.begin(), large.end(),
+                std::back_inserter(output));
+        return;
+    }
+
+    QueryResultT::const_iterator lit = large.begin();
+    for (QueryResultT::const_iterator sit = small.begin();
+         sit != small.end() && lit != large.end(); ++sit) {
+        size_t step = 1;
+        QueryResultT::const_iterator lo = lit;
+        while ((size_t)(large.end() - lo) > step && *(lo + step) < *sit) {
+            lo += step;
+            step <<= 1;
+        }
+        QueryResultT::const_iterator hi =
+            (size_t)(large.end() - lo) > step ? lo + step + 1 : large.end();
+        lit = std::lower_bound(lo, hi, *sit);
+        if (lit != large.end() && !(*sit < *lit)) {
+            output.push_back(*sit);
+            ++lit;
+        }
+    }
+}
+
+static bool result_size_less(const QueryUnit *lhs, const QueryUnit *rhs) {
+    return lhs->query_result.size() < rhs->query_result.size();
+}
+
 void SetOperationUnit::or_operation()
 {
     if (sub_queries.size() == 0)
@@ -33,23 +142,23 @@ void SetOperationUnit::or_operation()
     }
 
     // with one query no need to do any operation
-    query_result = sub_queries[0]->query_result;
-
-    for (unsigned int i = 1; i < sub_queries.size(); i++)
+    if (sub_queries.size() == 1)
     {
-        std::vector<query_result_unit_t> tmp_query_result;
-
-        QE_TRACE(DEBUG, "UNION between tables of sizes " << 
-                query_result.size() << " and " <<
-                sub_queries[i]->query_result.size());
-        set_union(query_result.begin(), query_result.end(),
-                sub_queries[i]->query_result.begin(), 
-                sub_queries[i]->query_result.end(),
-                std::back_inserter(tmp_query_result));
+        query_result = sub_queries[0]->query_result;
+        return;
+    }
 
-        query_result = tmp_query_result;    // keep the result in output var
-        QE_TRACE(DEBUG, "Resulting size of set " << query_result.size());
+    std::vector<const QueryResultT *> inputs;
+    for (unsigned int i = 0; i < sub_queries.size(); i++)
+    {
+        inputs.push_back(&sub_queries[i]->query_result);
     }
+
+    QE_TRACE(DEBUG, "UNION between " << sub_queries.size() << " tables");
+    QueryResultT tmp_query_result;
+    kway_union(inputs, tmp_query_result);
+    query_result.swap(tmp_query_result);
+    QE_TRACE(DEBUG, "Resulting size of set " << query_result.size());
 }
 
 void SetOperationUnit::and_operation()
@@ -60,22 +169,25 @@ void SetOperationUnit::and_operation()
         return;
     }
 
+    // Intersect starting from the smallest result, so that the running
+    // result only shrinks and galloping can skip through the large ones
+    std::vector<QueryUnit *> ordered(sub_queries);
+    std::stable_sort(ordered.begin(), ordered.end(), result_size_less);
+
     // with one query no need to do any operation
-    query_result = sub_queries[0]->query_result;
+    query_result = ordered[0]->query_result;
 
-    for (unsigned int i = 1; i < sub_queries.size(); i++)
+    for (unsigned int i = 1; i < ordered.size() && !query_result.empty(); i++)
     {
-        std::vector<query_result_unit_t> tmp_query_result;
+        QueryResultT tmp_query_result;
 
         QE_TRACE(DEBUG, "INT between tables of sizes " << 
                 query_result.size() << " and " <<
-                sub_queries[i]->query_result.size());
-        set_intersection(query_result.begin(), query_result.end(),
-                sub_queries[i]->query_result.begin(), 
-                sub_queries[i]->query_result.end(),
-                std::back_inserter(tmp_query_result));
+                ordered[i]->query_result.size());
+        gallop_intersection(query_result, ordered[i]->query_result,
+                tmp_query_result);
 
-        query_result = tmp_query_result;    // keep the result in output var
+        query_result.swap(tmp_query_result);    // keep the result in output var
         QE_TRACE(DEBUG, "Resulting size of set " << query_result.size());
     }
 }
@@ -32,9 +32,10 @@ StatsSelect::Jsonify(const std::map<std::string, StatVal>&  uniks,
                 it!= uniks.end(); it++) {
             switch (it->second.which()) {
                 case QEOpServerProxy::STRING : {
-                        string mapit = boost::get<string>(it->second);
+                        // uniks outlives dd, so the value is not copied
+                        const string& mapit = boost::get<string>(it->second);
                         rapidjson::Value val(rapidjson::kStringType);
-                        val.SetString(mapit.c_str());
+                        val.SetString(mapit.c_str(), mapit.size());
                         dd.AddMember(it->first.c_str(), val, dd.GetAllocator());              
                     }
                     break;
@@ -396,14 +397,22 @@ void StatsSelect::MergeAggRow(QEOpServerProxy::AggRowT &arows,
 
 }
 
-namespace boost {
-   std::size_t hash_value(const StatsSelect::StatVal&); 
-}
+// Hash each alternative by its native type; formatting every value to a
+// string here dominated LoadRow for large stats queries.
+struct StatValHasher : public boost::static_visitor<std::size_t> {
+    std::size_t operator()(const boost::blank&) const {
+        return 0;
+    }
+    template <typename T>
+    std::size_t operator()(const T& val) const {
+        return boost::hash<T>()(val);
+    }
+};
 
 std::size_t boost::hash_value(const StatsSelect::StatVal& sv) {
-    std::ostringstream ostr;
-    ostr << sv;
-    return boost::hash_value(ostr.str());
+    std::size_t seed = sv.which();
+    boost::hash_combine(seed, boost::apply_visitor(StatValHasher(), sv));
+    return seed;
 }
 
 bool StatsSelect::LoadRow(boost::uuids::uuid u,
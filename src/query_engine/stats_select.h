@@ -98,4 +98,8 @@ private:
     std::set<std::string> sum_cols_;
 
 };
+
+namespace boost {
+   std::size_t hash_value(const StatsSelect::StatVal&);
+}
 #endif
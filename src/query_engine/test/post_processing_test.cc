@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "testing/gunit.h"
+#include "base/logging.h"
+
+#include "query.h"
+#include "analytics_query_mock.h"
+
+using ::testing::Return;
+using ::testing::AnyNumber;
+
+class PostProcessingQueryTest : public ::testing::Test {
+public:
+    typedef QEOpServerProxy::BufferT BufferT;
+
+    virtual void SetUp() {
+        EXPECT_CALL(aqmock_, table())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(g_viz_constants.COLLECTOR_GLOBAL_TABLE));
+        EXPECT_CALL(aqmock_, is_object_table_query())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(false));
+        EXPECT_CALL(aqmock_, is_stat_table_query())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(false));
+        EXPECT_CALL(aqmock_, is_flow_query())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(false));
+        EXPECT_CALL(aqmock_, is_query_parallelized())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(false));
+
+        std::map<std::string, std::string> json_api_data;
+        pq_.reset(new PostProcessingQuery(json_api_data, &aqmock_));
+        pq_->sorted = true;
+        pq_->sorting_type = ASCENDING;
+        pq_->sort_fields.push_back(
+            sort_field_t(g_viz_constants.TIMESTAMP, "long"));
+    }
+
+    virtual void TearDown() {
+        pq_.reset();
+    }
+
+    static QEOpServerProxy::ResultRowT MakeRow(int ts,
+                                               const std::string &source) {
+        QEOpServerProxy::OutRowT cmap;
+        cmap.insert(std::make_pair(g_viz_constants.TIMESTAMP,
+                                   integerToString(ts)));
+        cmap.insert(std::make_pair(g_viz_constants.SOURCE, source));
+        return std::make_pair(cmap, QEOpServerProxy::MetadataT());
+    }
+
+    static boost::shared_ptr<BufferT> MakeBuffer(const std::string &ts_list,
+                                                 const std::string &source) {
+        boost::shared_ptr<BufferT> buffer(new BufferT);
+        std::istringstream ss(ts_list);
+        int ts;
+        while (ss >> ts) {
+            buffer->push_back(MakeRow(ts, source));
+        }
+        return buffer;
+    }
+
+    static std::string Timestamps(const BufferT &buffer) {
+        std::ostringstream ss;
+        for (BufferT::const_iterator it = buffer.begin(); it != buffer.end();
+             ++it) {
+            if (it != buffer.begin()) {
+                ss << " ";
+            }
+            ss << it->first.find(g_viz_constants.TIMESTAMP)->second;
+        }
+        return ss.str();
+    }
+
+    static std::string Sources(const BufferT &buffer) {
+        std::string sources;
+        for (BufferT::const_iterator it = buffer.begin(); it != buffer.end();
+             ++it) {
+            sources += it->first.find(g_viz_constants.SOURCE)->second;
+        }
+        return sources;
+    }
+
+    // Runs process_query on rows handed over by the select stage.
+    query_status_t ProcessQuery(boost::shared_ptr<BufferT> rows) {
+        std::map<std::string, std::string> json_select;
+        json_select.insert(std::make_pair(std::string("select_fields"),
+            std::string("[\"MessageTS\", \"Source\"]")));
+        aqmock_.selectquery_ = new SelectQuery(&aqmock_, json_select);
+        aqmock_.selectquery_->result_->swap(*rows);
+        query_status_t status = pq_->process_query();
+        delete aqmock_.selectquery_;
+        aqmock_.selectquery_ = NULL;
+        return status;
+    }
+
+    AnalyticsQueryMock aqmock_;
+    std::auto_ptr<PostProcessingQuery> pq_;
+};
+
+// Sorted results of the parallel query instances are merged in order.
+TEST_F(PostProcessingQueryTest, FinalMerge) {
+    std::vector<boost::shared_ptr<BufferT> > inputs;
+    inputs.push_back(MakeBuffer("1 4 7 10", "a"));
+    inputs.push_back(MakeBuffer("2 5 8", "b"));
+    inputs.push_back(MakeBuffer("", "c"));
+    inputs.push_back(MakeBuffer("3 6 9", "d"));
+    BufferT output;
+    EXPECT_TRUE(pq_->final_merge_processing(inputs, output));
+    EXPECT_EQ("1 2 3 4 5 6 7 8 9 10", Timestamps(output));
+}
+
+// The merge stops at the limit.
+TEST_F(PostProcessingQueryTest, FinalMergeLimit) {
+    pq_->limit = 5;
+    std::vector<boost::shared_ptr<BufferT> > inputs;
+    inputs.push_back(MakeBuffer("1 4 7 10", "a"));
+    inputs.push_back(MakeBuffer("2 5 8", "b"));
+    inputs.push_back(MakeBuffer("3 6 9", "c"));
+    BufferT output;
+    EXPECT_TRUE(pq_->final_merge_processing(inputs, output));
+    EXPECT_EQ("1 2 3 4 5", Timestamps(output));
+}
+
+TEST_F(PostProcessingQueryTest, FinalMergeDescending) {
+    pq_->sorting_type = DESCENDING;
+    pq_->limit = 4;
+    std::vector<boost::shared_ptr<BufferT> > inputs;
+    inputs.push_back(MakeBuffer("10 7 4 1", "a"));
+    inputs.push_back(MakeBuffer("9 6 3", "b"));
+    inputs.push_back(MakeBuffer("8 5 2", "c"));
+    BufferT output;
+    EXPECT_TRUE(pq_->final_merge_processing(inputs, output));
+    EXPECT_EQ("10 9 8 7", Timestamps(output));
+}
+
+// Rows that sort equal keep the order of their inputs.
+TEST_F(PostProcessingQueryTest, FinalMergeTies) {
+    std::vector<boost::shared_ptr<BufferT> > inputs;
+    inputs.push_back(MakeBuffer("1 2 2", "a"));
+    inputs.push_back(MakeBuffer("1 2", "b"));
+    inputs.push_back(MakeBuffer("2", "c"));
+    BufferT output;
+    EXPECT_TRUE(pq_->final_merge_processing(inputs, output));
+    EXPECT_EQ("1 1 2 2 2 2", Timestamps(output));
+    EXPECT_EQ("abaabc", Sources(output));
+}
+
+// Chunk results accumulated on a core never grow past the limit.
+TEST_F(PostProcessingQueryTest, MergeLimit) {
+    pq_->limit = 4;
+    BufferT output(*MakeBuffer("1 3 5", "a"));
+    EXPECT_TRUE(pq_->merge_processing(*MakeBuffer("2 4 6", "b"), output));
+    EXPECT_EQ("1 2 3 4", Timestamps(output));
+    EXPECT_TRUE(pq_->merge_processing(*MakeBuffer("0 7", "c"), output));
+    EXPECT_EQ("0 1 2 3", Timestamps(output));
+    EXPECT_EQ("caba", Sources(output));
+}
+
+TEST_F(PostProcessingQueryTest, MergeNoLimit) {
+    BufferT output(*MakeBuffer("1 3 5", "a"));
+    EXPECT_TRUE(pq_->merge_processing(*MakeBuffer("2 4 6", "b"), output));
+    EXPECT_TRUE(pq_->merge_processing(*MakeBuffer("", "c"), output));
+    EXPECT_EQ("1 2 3 4 5 6", Timestamps(output));
+}
+
+// Only the rows within the limit are returned, in order.
+TEST_F(PostProcessingQueryTest, ProcessQueryLimit) {
+    pq_->limit = 3;
+    EXPECT_EQ(QUERY_SUCCESS,
+              ProcessQuery(MakeBuffer("5 3 9 1 7 3", "a")));
+    EXPECT_EQ("1 3 3", Timestamps(*pq_->result_));
+}
+
+TEST_F(PostProcessingQueryTest, ProcessQueryFilter) {
+    filter_match_t filter;
+    filter.name = g_viz_constants.SOURCE;
+    filter.value = "a";
+    filter.op = EQUAL;
+    pq_->filter_list.push_back(filter);
+    pq_->limit = 2;
+
+    boost::shared_ptr<BufferT> rows(MakeBuffer("5 1", "a"));
+    BufferT more(*MakeBuffer("0 2", "b"));
+    rows->insert(rows->end(), more.begin(), more.end());
+    rows->push_back(MakeRow(3, "a"));
+    EXPECT_EQ(QUERY_SUCCESS, ProcessQuery(rows));
+    EXPECT_EQ("1 3", Timestamps(*pq_->result_));
+    EXPECT_EQ("aa", Sources(*pq_->result_));
+}
+
+// A filter that fails part way through does not leave a partially
+// filtered result behind.
+TEST_F(PostProcessingQueryTest, ProcessQueryFilterFailure) {
+    filter_match_t filter;
+    filter.name = g_viz_constants.SOURCE;
+    filter.value = "a";
+    filter.op = EQUAL;
+    pq_->filter_list.push_back(filter);
+    filter.op = PREFIX;
+    pq_->filter_list.push_back(filter);
+
+    boost::shared_ptr<BufferT> rows(MakeBuffer("1 2", "b"));
+    rows->push_back(MakeRow(3, "a"));
+    EXPECT_EQ(QUERY_FAILURE, ProcessQuery(rows));
+    EXPECT_TRUE(pq_->result_->empty());
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
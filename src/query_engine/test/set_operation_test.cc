@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "testing/gunit.h"
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "query.h"
+
+typedef std::vector<query_result_unit_t> QueryResultT;
+
+// Leaf of the WHERE tree with a precomputed, sorted result.
+class ResultUnit : public QueryUnit {
+public:
+    ResultUnit(QueryUnit *p_query, QueryUnit *m_query,
+               const QueryResultT &result) : QueryUnit(p_query, m_query) {
+        query_result = result;
+    }
+    virtual query_status_t process_query() {
+        return QUERY_SUCCESS;
+    }
+};
+
+class RootUnit : public QueryUnit {
+public:
+    RootUnit() : QueryUnit(NULL, NULL) {
+    }
+    virtual query_status_t process_query() {
+        return QUERY_SUCCESS;
+    }
+};
+
+class SetOperationTest : public ::testing::Test {
+public:
+    static query_result_unit_t MakeUnit(uint64_t ts, uint64_t id) {
+        query_result_unit_t unit;
+        unit.timestamp = ts;
+        unit.info.push_back(id);
+        return unit;
+    }
+
+    // Builds a sorted result from a list of "ts:id" pairs.
+    static QueryResultT MakeResult(const std::string &units) {
+        QueryResultT result;
+        std::istringstream ss(units);
+        uint64_t ts, id;
+        char sep;
+        while (ss >> ts >> sep >> id) {
+            result.push_back(MakeUnit(ts, id));
+        }
+        return result;
+    }
+
+    // Random sorted result of size entries drawn from range (ts, id) pairs.
+    static QueryResultT RandomResult(size_t size, uint64_t range) {
+        QueryResultT result;
+        for (size_t i = 0; i < size; i++) {
+            uint64_t value = rand() % range;
+            result.push_back(MakeUnit(value / 4, value % 4));
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    static std::string ToString(const QueryResultT &result) {
+        std::ostringstream ss;
+        for (QueryResultT::const_iterator it = result.begin();
+             it != result.end(); ++it) {
+            if (it != result.begin()) {
+                ss << " ";
+            }
+            ss << it->timestamp << ":" << boost::get<uint64_t>(it->info[0]);
+        }
+        return ss.str();
+    }
+
+    QueryResultT Run(bool intersection, const std::vector<QueryResultT> &in) {
+        RootUnit root;
+        SetOperationUnit *op = new SetOperationUnit(&root, &root);
+        op->set_operation = intersection ?
+            SetOperationUnit::INTERSECTION_OP : SetOperationUnit::UNION_OP;
+        for (size_t i = 0; i < in.size(); i++) {
+            new ResultUnit(op, &root, in[i]);
+        }
+        EXPECT_EQ(QUERY_SUCCESS, op->process_query());
+        return op->query_result;
+    }
+
+    // Chained pairwise set operations, as the result is defined.
+    static QueryResultT Reference(bool intersection,
+                                  const std::vector<QueryResultT> &in) {
+        QueryResultT result = in[0];
+        for (size_t i = 1; i < in.size(); i++) {
+            QueryResultT tmp;
+            if (intersection) {
+                std::set_intersection(result.begin(), result.end(),
+                    in[i].begin(), in[i].end(), std::back_inserter(tmp));
+            } else {
+                std::set_union(result.begin(), result.end(),
+                    in[i].begin(), in[i].end(), std::back_inserter(tmp));
+            }
+            result.swap(tmp);
+        }
+        return result;
+    }
+};
+
+TEST_F(SetOperationTest, Order) {
+    EXPECT_TRUE(MakeUnit(1, 9) < MakeUnit(2, 0));
+    EXPECT_TRUE(MakeUnit(1, 0) < MakeUnit(1, 9));
+    EXPECT_FALSE(MakeUnit(1, 9) < MakeUnit(1, 0));
+    EXPECT_FALSE(MakeUnit(1, 0) < MakeUnit(1, 0));
+}
+
+// An info vector that is a prefix of another sorts before it, so that
+// equivalence is transitive.
+TEST_F(SetOperationTest, OrderPrefix) {
+    query_result_unit_t a = MakeUnit(1, 1);
+    query_result_unit_t b = MakeUnit(1, 1);
+    b.info.push_back(uint64_t(2));
+    query_result_unit_t c = MakeUnit(1, 1);
+    c.info.push_back(uint64_t(3));
+
+    EXPECT_TRUE(a < b);
+    EXPECT_FALSE(b < a);
+    EXPECT_TRUE(a < c);
+    EXPECT_TRUE(b < c);
+
+    QueryResultT result;
+    result.push_back(c);
+    result.push_back(b);
+    result.push_back(a);
+    result.push_back(c);
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(1, result[0].info.size());
+    EXPECT_EQ(uint64_t(2), boost::get<uint64_t>(result[1].info[1]));
+    EXPECT_EQ(uint64_t(3), boost::get<uint64_t>(result[2].info[1]));
+    EXPECT_EQ(uint64_t(3), boost::get<uint64_t>(result[3].info[1]));
+
+    std::vector<QueryResultT> in;
+    in.push_back(QueryResultT(1, a));
+    in.push_back(result);
+    EXPECT_EQ(1, Run(true, in).size());
+    EXPECT_EQ(4, Run(false, in).size());
+}
+
+// An element appears in the union as many times as in the input that has
+// it the most times.
+TEST_F(SetOperationTest, Union) {
+    std::vector<QueryResultT> in;
+    in.push_back(MakeResult("1:0 3:0 3:0 5:1"));
+    in.push_back(MakeResult("2:0 3:0 5:0"));
+    in.push_back(MakeResult(""));
+    in.push_back(MakeResult("3:0 3:0 3:0 6:0"));
+    EXPECT_EQ("1:0 2:0 3:0 3:0 3:0 5:0 5:1 6:0", ToString(Run(false, in)));
+    EXPECT_EQ(ToString(Reference(false, in)), ToString(Run(false, in)));
+}
+
+// An element appears in the intersection as many times as in the input
+// that has it the fewest times.
+TEST_F(SetOperationTest, Intersection) {
+    std::vector<QueryResultT> in;
+    in.push_back(MakeResult("1:0 3:0 3:0 5:1 7:0"));
+    in.push_back(MakeResult("3:0 3:0 3:0 5:1 7:0"));
+    in.push_back(MakeResult("3:0 3:0 5:0 5:1"));
+    EXPECT_EQ("3:0 3:0 5:1", ToString(Run(true, in)));
+    EXPECT_EQ(ToString(Reference(true, in)), ToString(Run(true, in)));
+
+    in.push_back(MakeResult(""));
+    EXPECT_TRUE(Run(true, in).empty());
+}
+
+// A small result is intersected with a much larger one by galloping.
+TEST_F(SetOperationTest, IntersectionGallop) {
+    std::vector<QueryResultT> in;
+    QueryResultT large;
+    for (uint64_t ts = 0; ts < 1000; ts++) {
+        large.push_back(MakeUnit(ts, 0));
+        large.push_back(MakeUnit(ts, 1));
+    }
+    in.push_back(large);
+    in.push_back(MakeResult("0:0 0:2 17:1 500:0 500:0 998:3 999:1 1000:0"));
+    EXPECT_EQ("0:0 17:1 500:0 999:1", ToString(Run(true, in)));
+    EXPECT_EQ(ToString(Reference(true, in)), ToString(Run(true, in)));
+}
+
+TEST_F(SetOperationTest, Random) {
+    srand(1);
+    for (int iter = 0; iter < 100; iter++) {
+        std::vector<QueryResultT> in;
+        size_t terms = 2 + rand() % 6;
+        for (size_t i = 0; i < terms; i++) {
+            // Mix of small and large terms to exercise galloping
+            size_t size = (rand() % 4) ? rand() % 50 : rand() % 2000;
+            in.push_back(RandomResult(size, 1000));
+        }
+        EXPECT_EQ(ToString(Reference(false, in)), ToString(Run(false, in)));
+        EXPECT_EQ(ToString(Reference(true, in)), ToString(Run(true, in)));
+    }
+}
+
+// Union and intersection of a WHERE clause with many OR terms. Run with
+// --gtest_also_run_disabled_tests; gtest reports the elapsed time.
+TEST_F(SetOperationTest, DISABLED_ManyTerms) {
+    const size_t kTerms = 256;
+    const size_t kTermSize = 20000;
+    srand(1);
+    std::vector<QueryResultT> in;
+    for (size_t i = 0; i < kTerms; i++) {
+        in.push_back(RandomResult(kTermSize, 1 << 24));
+    }
+    QueryResultT result(Run(false, in));
+    EXPECT_EQ(Reference(false, in).size(), result.size());
+
+    std::vector<QueryResultT> and_in;
+    and_in.push_back(RandomResult(100, 1 << 16));
+    and_in.push_back(result);
+    EXPECT_EQ(Reference(true, and_in).size(), Run(true, and_in).size());
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
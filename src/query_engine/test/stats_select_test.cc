@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2014 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "testing/gunit.h"
+#include "base/logging.h"
+
+#include "query.h"
+#include "stats_select.h"
+#include "analytics_query_mock.h"
+
+using ::testing::Return;
+using ::testing::AnyNumber;
+
+class StatsSelectTest : public ::testing::Test {
+public:
+    typedef StatsSelect::MapBufT MapBufT;
+    typedef StatsSelect::StatVal StatVal;
+
+    static const uint64_t kBinUsec = 60 * 1000000ULL;
+
+    virtual void SetUp() {
+        EXPECT_CALL(aqmock_, table())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(std::string(
+                "StatTable.AnalyticsCpuState.cpu_info")));
+        EXPECT_CALL(aqmock_, is_stat_table_query())
+            .Times(AnyNumber())
+            .WillRepeatedly(Return(true));
+    }
+
+    StatsSelect *CreateStatsSelect(const std::string &fields) {
+        std::vector<std::string> select_fields;
+        std::istringstream ss(fields);
+        std::string field;
+        while (ss >> field) {
+            select_fields.push_back(field);
+        }
+        return new StatsSelect(&aqmock_, select_fields);
+    }
+
+    static std::vector<StatsSelect::StatEntry> MakeRow(
+            const std::string &module_id, uint64_t mem_virt,
+            double cpu_share) {
+        std::vector<StatsSelect::StatEntry> row(3);
+        row[0].name = "cpu_info.module_id";
+        row[0].value = module_id;
+        row[1].name = "cpu_info.mem_virt";
+        row[1].value = mem_virt;
+        row[2].name = "cpu_info.cpu_share";
+        row[2].value = cpu_share;
+        return row;
+    }
+
+    static std::string Jsonify(const MapBufT &buf) {
+        std::string json;
+        for (MapBufT::const_iterator it = buf.begin(); it != buf.end();
+             ++it) {
+            std::string jstr;
+            EXPECT_TRUE(StatsSelect::Jsonify(it->second.first,
+                                             it->second.second, jstr));
+            json += jstr + "\n";
+        }
+        return json;
+    }
+
+    StatsSelectTest() : uuid_(boost::uuids::nil_uuid()) {
+    }
+
+    AnalyticsQueryMock aqmock_;
+    boost::uuids::uuid uuid_;
+};
+
+// Values hash by type as well as by value.
+TEST_F(StatsSelectTest, Hash) {
+    EXPECT_EQ(boost::hash_value(StatVal(std::string("5"))),
+              boost::hash_value(StatVal(std::string("5"))));
+    EXPECT_EQ(boost::hash_value(StatVal(uint64_t(5))),
+              boost::hash_value(StatVal(uint64_t(5))));
+    EXPECT_NE(boost::hash_value(StatVal(std::string("5"))),
+              boost::hash_value(StatVal(uint64_t(5))));
+    EXPECT_NE(boost::hash_value(StatVal(uint64_t(5))),
+              boost::hash_value(StatVal(uint64_t(6))));
+    EXPECT_NE(boost::hash_value(StatVal(uint64_t(0))),
+              boost::hash_value(StatVal()));
+}
+
+TEST_F(StatsSelectTest, Parse) {
+    boost::scoped_ptr<StatsSelect> ss(CreateStatsSelect(
+        "cpu_info.module_id SUM(cpu_info.mem_virt) COUNT(cpu_info) T=60"));
+    EXPECT_TRUE(ss->Status());
+    EXPECT_TRUE(ss->IsMergeNeeded());
+
+    ss.reset(CreateStatsSelect("cpu_info.module_id SUM(cpu_info.inst_id)"));
+    EXPECT_FALSE(ss->Status());
+    ss.reset(CreateStatsSelect("T T=60"));
+    EXPECT_FALSE(ss->Status());
+    ss.reset(CreateStatsSelect("T cpu_info.cpu_share"));
+    EXPECT_TRUE(ss->Status());
+    EXPECT_FALSE(ss->IsMergeNeeded());
+}
+
+// Rows with the same unique columns in the same time bin are aggregated
+// into a single output row.
+TEST_F(StatsSelectTest, LoadRow) {
+    boost::scoped_ptr<StatsSelect> ss(CreateStatsSelect(
+        "cpu_info.module_id SUM(cpu_info.mem_virt) COUNT(cpu_info) T=60"));
+    ASSERT_TRUE(ss->Status());
+
+    MapBufT output;
+    EXPECT_TRUE(ss->LoadRow(uuid_, kBinUsec + 1, MakeRow("qe", 10, 0.5),
+                            output));
+    EXPECT_TRUE(ss->LoadRow(uuid_, kBinUsec + 2, MakeRow("qe", 20, 0.5),
+                            output));
+    EXPECT_TRUE(ss->LoadRow(uuid_, kBinUsec + 3, MakeRow("collector", 5, 1),
+                            output));
+    EXPECT_TRUE(ss->LoadRow(uuid_, 2 * kBinUsec, MakeRow("qe", 7, 0.5),
+                            output));
+    EXPECT_EQ(3, output.size());
+    std::string json(Jsonify(output));
+    EXPECT_NE(std::string::npos, json.find(
+        "{\"T=\":60000000,\"cpu_info.module_id\":\"qe\","
+            "\"SUM(cpu_info.mem_virt)\":30,\"COUNT(cpu_info)\":2}\n"));
+    EXPECT_NE(std::string::npos, json.find(
+        "{\"T=\":60000000,\"cpu_info.module_id\":\"collector\","
+            "\"SUM(cpu_info.mem_virt)\":5,\"COUNT(cpu_info)\":1}\n"));
+
+    // Rows are ordered by time bin first.
+    EXPECT_EQ("{\"T=\":120000000,\"cpu_info.module_id\":\"qe\","
+                  "\"SUM(cpu_info.mem_virt)\":7,\"COUNT(cpu_info)\":1}\n",
+              json.substr(json.find("{\"T=\":120000000")));
+}
+
+// Results of the chunks of a query are merged by their unique columns.
+TEST_F(StatsSelectTest, MergeChunks) {
+    boost::scoped_ptr<StatsSelect> ss(CreateStatsSelect(
+        "cpu_info.module_id SUM(cpu_info.cpu_share) COUNT(cpu_info)"));
+    ASSERT_TRUE(ss->Status());
+
+    std::vector<boost::shared_ptr<MapBufT> > chunks;
+    for (int i = 0; i < 3; i++) {
+        chunks.push_back(boost::shared_ptr<MapBufT>(new MapBufT));
+        EXPECT_TRUE(ss->LoadRow(uuid_, i, MakeRow("qe", 0, 0.25),
+                                *chunks.back()));
+    }
+    EXPECT_TRUE(ss->LoadRow(uuid_, 3, MakeRow("collector", 0, 1.5),
+                            *chunks.back()));
+
+    MapBufT merged;
+    StatsSelect::Merge(*chunks[0], merged);
+    StatsSelect::Merge(*chunks[1], merged);
+    EXPECT_EQ(1, merged.size());
+    EXPECT_EQ("{\"cpu_info.module_id\":\"qe\","
+                  "\"SUM(cpu_info.cpu_share)\":0.5,\"COUNT(cpu_info)\":2}\n",
+              Jsonify(merged));
+
+    MapBufT output;
+    ss->MergeFinal(chunks, output);
+    EXPECT_EQ(2, output.size());
+    std::string json(Jsonify(output));
+    EXPECT_NE(std::string::npos, json.find(
+        "{\"cpu_info.module_id\":\"qe\","
+            "\"SUM(cpu_info.cpu_share)\":0.75,\"COUNT(cpu_info)\":3}\n"));
+    EXPECT_NE(std::string::npos, json.find(
+        "{\"cpu_info.module_id\":\"collector\","
+            "\"SUM(cpu_info.cpu_share)\":1.5,\"COUNT(cpu_info)\":1}\n"));
+}
+
+// When sorting by an aggregate, the final merge orders the rows by the
+// aggregated value across all chunks.
+TEST_F(StatsSelectTest, MergeFinalSortByAgg) {
+    boost::scoped_ptr<StatsSelect> ss(CreateStatsSelect(
+        "cpu_info.module_id SUM(cpu_info.mem_virt)"));
+    ASSERT_TRUE(ss->Status());
+    std::vector<sort_field_t> sort_fields;
+    sort_fields.push_back(sort_field_t("SUM(cpu_info.mem_virt)", "int"));
+    ss->SetSortOrder(sort_fields);
+
+    std::vector<boost::shared_ptr<MapBufT> > chunks;
+    chunks.push_back(boost::shared_ptr<MapBufT>(new MapBufT));
+    ss->LoadRow(uuid_, 0, MakeRow("a", 50, 0), *chunks.back());
+    ss->LoadRow(uuid_, 0, MakeRow("b", 10, 0), *chunks.back());
+    ss->LoadRow(uuid_, 0, MakeRow("c", 30, 0), *chunks.back());
+    chunks.push_back(boost::shared_ptr<MapBufT>(new MapBufT));
+    ss->LoadRow(uuid_, 1, MakeRow("b", 100, 0), *chunks.back());
+
+    MapBufT output;
+    ss->MergeFinal(chunks, output);
+    EXPECT_EQ(
+        "{\"cpu_info.module_id\":\"c\",\"SUM(cpu_info.mem_virt)\":30}\n"
+        "{\"cpu_info.module_id\":\"a\",\"SUM(cpu_info.mem_virt)\":50}\n"
+        "{\"cpu_info.module_id\":\"b\",\"SUM(cpu_info.mem_virt)\":110}\n",
+        Jsonify(output));
+}
+
+// Loads and merges a large stats query. Run with
+// --gtest_also_run_disabled_tests; gtest reports the elapsed time.
+TEST_F(StatsSelectTest, DISABLED_LoadLarge) {
+    const int kModules = 1000;
+    const int kBins = 60;
+    const int kChunks = 8;
+    const int kRowsPerChunk = 200000;
+    boost::scoped_ptr<StatsSelect> ss(CreateStatsSelect(
+        "cpu_info.module_id SUM(cpu_info.mem_virt) COUNT(cpu_info) T=60"));
+    ASSERT_TRUE(ss->Status());
+
+    std::vector<boost::shared_ptr<MapBufT> > chunks;
+    for (int c = 0; c < kChunks; c++) {
+        chunks.push_back(boost::shared_ptr<MapBufT>(new MapBufT));
+        for (int i = 0; i < kRowsPerChunk; i++) {
+            uint64_t ts = ((i / kModules) % kBins) * kBinUsec;
+            ss->LoadRow(uuid_, ts,
+                MakeRow("module" + integerToString(i % kModules), 1, 0.5),
+                *chunks.back());
+        }
+    }
+
+    MapBufT output;
+    ss->MergeFinal(chunks, output);
+    EXPECT_EQ(kModules * kBins, output.size());
+
+    uint64_t count = 0;
+    for (MapBufT::const_iterator it = output.begin(); it != output.end();
+         ++it) {
+        const QEOpServerProxy::AggRowT &aggs = it->second.second;
+        count += boost::get<uint64_t>(aggs.find(std::make_pair(
+            QEOpServerProxy::COUNT, std::string("cpu_info")))->second);
+    }
+    EXPECT_EQ(uint64_t(kChunks) * kRowsPerChunk, count);
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
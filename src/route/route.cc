@@ -43,3 +43,50 @@ void Route::Sort(Compare compare, const Path *prev_front) {
         set_last_change_at_to_now();
     }
 }
+
+void Route::InsertSorted(const Path *ipath, Compare compare) {
+    Path *path = const_cast<Path *> (ipath);
+    const Path *prev_front = front();
+
+    // Go past all paths that are as good as the new one, so that the result
+    // is the same as appending the path and doing a stable sort.
+    PathList::iterator it = path_.begin();
+    while (it != path_.end() && !compare(*path, *it)) {
+        ++it;
+    }
+    path_.insert(it, *path);
+
+    // If the best path changes, update route's time stamp.
+    if (prev_front != front()) {
+        set_last_change_at_to_now();
+    }
+}
+
+void Route::RemoveSorted(const Path *ipath) {
+    Path *path = const_cast<Path *> (ipath);
+    const Path *prev_front = front();
+
+    path_.erase(path_.iterator_to(*path));
+
+    // If the best path changes, update route's time stamp.
+    if (prev_front != front()) {
+        set_last_change_at_to_now();
+    }
+}
+
+void Route::RepositionSorted(const Path *ipath, Compare compare) {
+    Path *path = const_cast<Path *> (ipath);
+    const Path *prev_front = front();
+
+    path_.erase(path_.iterator_to(*path));
+    PathList::iterator it = path_.begin();
+    while (it != path_.end() && !compare(*path, *it)) {
+        ++it;
+    }
+    path_.insert(it, *path);
+
+    // If the best path changes, update route's time stamp.
+    if (prev_front != front()) {
+        set_last_change_at_to_now();
+    }
+}
@@ -43,6 +43,18 @@ public:
     // Sort paths based on compare function.
     void Sort(Compare compare, const Path *prev_front);
 
+    // Insert a path at its position in a path list that is kept sorted with
+    // the compare function, without re-sorting the rest of the list. The
+    // caller is responsible for time stamping the path.
+    void InsertSorted(const Path *path, Compare compare);
+
+    // Remove a path from a sorted path list. The list stays sorted.
+    void RemoveSorted(const Path *path);
+
+    // Move a path whose preference has changed to its new position in a
+    // path list that is kept sorted with the compare function.
+    void RepositionSorted(const Path *path, Compare compare);
+
     const PathList &GetPathList() const {
         return path_;
     }
@@ -87,7 +87,7 @@ MetadataProxy::Shutdown() {
 
 void 
 MetadataProxy::HandleMetadataRequest(HttpSession *session, const HttpRequest *request) {
-    bool conn_close = false;
+    bool conn_close = !request->KeepAlive();
     std::string msg;
     std::string uri;
     std::string header_options;
@@ -113,9 +113,6 @@ MetadataProxy::HandleMetadataRequest(HttpSession *session, const HttpRequest *re
             continue;
         }
         if (option == "connection") {
-            std::string val = boost::to_lower_copy(it->second);
-            if (val == "close")
-                conn_close = true;
             continue;
         }
         header_options += it->first + ": " + it->second + "\r\n";
@@ -194,7 +191,11 @@ MetadataProxy::HandleMetadataResponse(HttpConnection *conn, HttpSessionPtr sessi
             goto done;
         }
 
-        if (!ec && it->second.close_req) {
+        // Once the response has been proxied, the session is closed if the
+        // request asked for it. Otherwise the response is complete and the
+        // next request on the session is handled.
+        bool response_end = false;
+        if (!ec) {
             std::stringstream str(msg);
             std::string option;
             str >> option;
@@ -202,20 +203,21 @@ MetadataProxy::HandleMetadataResponse(HttpConnection *conn, HttpSessionPtr sessi
                 str >> it->second.content_len;
             } else if (msg == "\r\n") {
                 it->second.header_end = true;
-                if (it->second.header_end && !it->second.content_len) {
-                    CloseClientSession(it->second.conn);
-                    CloseServerSession(session.get());
-                    delete_session = true;
-                    metadata_stats_.responses++;
-                }
+                response_end = !it->second.content_len;
             } else if (it->second.header_end) {
                 it->second.data_sent += msg.length();
-                if (it->second.data_sent >= it->second.content_len) {
-                    CloseClientSession(it->second.conn);
-                    CloseServerSession(session.get());
-                    delete_session = true;
-                    metadata_stats_.responses++;
-                }
+                response_end =
+                    it->second.data_sent >= it->second.content_len;
+            }
+        }
+        if (response_end) {
+            metadata_stats_.responses++;
+            if (it->second.close_req) {
+                CloseClientSession(it->second.conn);
+                CloseServerSession(session.get());
+                delete_session = true;
+            } else {
+                session->ResponseComplete();
             }
         }
     }
@@ -270,7 +272,11 @@ HttpConnection *
 MetadataProxy::GetProxyConnection(HttpSession *session, bool conn_close) {
     SessionMap::iterator it = metadata_sessions_.find(session);
     if (it != metadata_sessions_.end()) {
+        // The response to the previous request on the session is complete.
+        it->second.content_len = 0;
+        it->second.data_sent = 0;
         it->second.close_req = conn_close;
+        it->second.header_end = false;
         return it->second.conn;
     }
 
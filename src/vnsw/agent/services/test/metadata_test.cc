@@ -228,6 +228,7 @@ public:
 
         session->Send(reinterpret_cast<const u_int8_t *>(response),
                       strlen(response), NULL);
+        session->ResponseComplete();
         delete request;
     }
 